@@ -0,0 +1,273 @@
+#include <random>
+
+#include "bench/bench_utils.h"
+
+#include "common/journal.h"
+#include "trading/backtest/backtest_engine.h"
+
+// BacktestEngine over a synthetic recording: a random walk book per instrument (adds, modifies, cancels, trades
+// sweeping from the touch) journaled to --dir, then a 32 point parameter sweep of a quoting strategy on every instrument with 1 to
+// N workers, N being the number of cpus. Reports book updates per second overall and per core, and scaling
+// efficiency against 1 worker: rate(n) / (n * rate(1)). The latency columns are the time of one pass (an
+// instrument's whole recording fed to a block of 8 strategies).
+
+using namespace Bench;
+
+namespace {
+    constexpr std::size_t NUM_INSTRUMENTS = Common::ME_MAX_TICKERS;
+    constexpr std::size_t MAX_LIVE_ORDERS = 512;
+
+    // quotes clip_ on both sides edge_ ticks behind the touch, requotes when the touch moves and stops adding to a side
+    // once the position reaches max_position_. Written against the gateway interface, so the same code could run live
+    struct MarketMakerParams {
+        Common::Price edge_ = 1;
+        Common::Qty clip_ = 1;
+        int64_t max_position_ = 10;
+    };
+
+    template<typename Gateway>
+    class MarketMaker final {
+    public:
+        using Params = MarketMakerParams;
+
+        MarketMaker(const Params& params, Common::TickerId ticker_id, Gateway& gateway)
+            : params_{params}, ticker_id_{ticker_id}, gateway_{gateway} {
+        }
+
+        auto on_order_book_update(const Exchange::MEMarketUpdate&, const Trading::MarketOrderBook& book) noexcept {
+            const auto bbo = book.get_bbo();
+            if (bbo->bid_price_ == Common::Price_INVALID || bbo->ask_price_ == Common::Price_INVALID)
+                return;
+            requote(Common::Side::BUY, bbo->bid_price_ - params_.edge_, position_ < params_.max_position_);
+            requote(Common::Side::SELL, bbo->ask_price_ + params_.edge_, position_ > -params_.max_position_);
+        }
+
+        auto on_trade_update(const Exchange::MEMarketUpdate&, const Trading::MarketOrderBook&) noexcept {}
+
+        auto on_order_update(const Exchange::MEClientResponse& response) noexcept {
+            auto& quote = quotes_[response.side_ == Common::Side::BUY ? 0 : 1];
+            if (response.client_order_id_ != quote.order_id_)
+                return;
+            switch (response.type_) {
+                case Exchange::ClientResponseType::FILLED:
+                    position_ += response.side_ == Common::Side::BUY ? response.exec_qty_ : -static_cast<int64_t>(response.exec_qty_);
+                    if (!response.leaves_qty_)
+                        quote = {};
+                    break;
+                case Exchange::ClientResponseType::CANCELED:
+                case Exchange::ClientResponseType::CANCEL_REJECTED:
+                    quote = {};
+                    break;
+                default:
+                    break;
+            }
+        }
+
+    private:
+        struct Quote {
+            Common::OrderId order_id_ = Common::OrderId_INVALID;
+            Common::Price price_ = Common::Price_INVALID;
+            bool cancel_sent_ = false;
+        };
+
+        const Params params_;
+        const Common::TickerId ticker_id_;
+        Gateway& gateway_;
+        std::array<Quote, 2> quotes_;
+        int64_t position_ = 0;
+        Common::OrderId next_order_id_ = 1;
+
+        auto requote(Common::Side side, Common::Price price, bool allowed) noexcept -> void {
+            auto& quote = quotes_[side == Common::Side::BUY ? 0 : 1];
+            if (quote.order_id_ != Common::OrderId_INVALID) {
+                if ((quote.price_ != price || !allowed) && !quote.cancel_sent_) {
+                    gateway_.send_cancel(ticker_id_, side, quote.order_id_);
+                    quote.cancel_sent_ = true;
+                }
+            } else if (allowed) {
+                quote = {next_order_id_++, price, false};
+                gateway_.send_new_order(ticker_id_, side, price, params_.clip_, quote.order_id_);
+            }
+        }
+    };
+
+    using Strategy = MarketMaker<Trading::SimulatedOrderGateway>;
+
+    auto remove_journal(const std::string& dir, const std::string& name) {
+        for (uint64_t index = 0; unlink(Common::journal_segment_path(dir, name, index).c_str()) == 0; ++index);
+    }
+
+    // one book per instrument doing a random walk, bids below and asks above a mid that moves a tick at a time
+    auto record_market_data(const std::string& dir, const std::string& name, std::size_t num_events) {
+        struct Order {
+            Common::OrderId order_id_;
+            Common::Side side_;
+            Common::Price price_;
+            Common::Qty qty_;
+        };
+        struct Instrument {
+            Common::Price mid_ = 10'000;
+            std::vector<Order> live_;
+            std::vector<Common::OrderId> free_ids_;
+            Common::OrderId next_order_id_ = 1;
+        };
+
+        std::mt19937_64 rng(42);
+        std::array<Instrument, NUM_INSTRUMENTS> instruments;
+        Common::Journal<Exchange::MEMarketUpdate> journal(dir, name, 64 * 1024 * 1024);
+        std::size_t written = 0;
+        auto emit = [&](Exchange::MarketUpdateType type, Common::TickerId ticker_id, const Order& order) {
+            journal.append({type, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, 0}, static_cast<Common::Nanos>(written) * 1'000);
+            ++written;
+        };
+        auto remove = [&](Common::TickerId ticker_id, std::size_t index) {
+            auto& instrument = instruments[ticker_id];
+            emit(Exchange::MarketUpdateType::CANCEL, ticker_id, instrument.live_[index]);
+            instrument.free_ids_.push_back(instrument.live_[index].order_id_);
+            instrument.live_[index] = instrument.live_.back();
+            instrument.live_.pop_back();
+        };
+
+        while (written < num_events) {
+            const auto ticker_id = static_cast<Common::TickerId>(rng() % NUM_INSTRUMENTS);
+            auto& instrument = instruments[ticker_id];
+            auto& live = instrument.live_;
+            const auto action = rng() % 100;
+
+            if (action < 2) {
+                // mid moves, whatever it crossed is pulled
+                instrument.mid_ += rng() & 1 ? 1 : -1;
+                for (std::size_t i = 0; i < live.size();) {
+                    if (live[i].side_ == Common::Side::BUY ? live[i].price_ >= instrument.mid_ : live[i].price_ <= instrument.mid_)
+                        remove(ticker_id, i);
+                    else
+                        ++i;
+                }
+            } else if (action < 50 || live.size() < 16) {
+                if (live.size() == MAX_LIVE_ORDERS) {
+                    remove(ticker_id, rng() % live.size());
+                    continue;
+                }
+                Order order;
+                if (instrument.free_ids_.empty()) {
+                    order.order_id_ = instrument.next_order_id_++;
+                } else {
+                    order.order_id_ = instrument.free_ids_.back();
+                    instrument.free_ids_.pop_back();
+                }
+                order.side_ = rng() & 1 ? Common::Side::BUY : Common::Side::SELL;
+                const auto offset = 1 + static_cast<Common::Price>(rng() % 5);
+                order.price_ = order.side_ == Common::Side::BUY ? instrument.mid_ - offset : instrument.mid_ + offset;
+                order.qty_ = 1 + static_cast<Common::Qty>(rng() % 100);
+                live.push_back(order);
+                emit(Exchange::MarketUpdateType::ADD, ticker_id, order);
+            } else if (action < 85) {
+                remove(ticker_id, rng() % live.size());
+            } else if (action < 92) {
+                auto& order = live[rng() % live.size()];
+                order.qty_ = 1 + static_cast<Common::Qty>(rng() % 100);
+                emit(Exchange::MarketUpdateType::MODIFY, ticker_id, order);
+            } else {
+                // someone takes liquidity on a random side, big enough now and then to sweep through a few levels
+                const auto side = rng() & 1 ? Common::Side::BUY : Common::Side::SELL;
+                auto qty = 1 + static_cast<Common::Qty>(rng() % 200);
+                while (qty) {
+                    std::size_t best = live.size();
+                    for (std::size_t i = 0; i < live.size(); ++i) {
+                        if (live[i].side_ == side && (best == live.size() ||
+                            (side == Common::Side::BUY ? live[i].price_ > live[best].price_ : live[i].price_ < live[best].price_)))
+                            best = i;
+                    }
+                    if (best == live.size())
+                        break;
+                    auto& order = live[best];
+                    const auto traded = std::min(order.qty_, qty);
+                    emit(Exchange::MarketUpdateType::TRADE, ticker_id, {Common::OrderId_INVALID, side == Common::Side::BUY ? Common::Side::SELL : Common::Side::BUY, order.price_, traded});
+                    qty -= traded;
+                    if (traded == order.qty_) {
+                        remove(ticker_id, best);
+                    } else {
+                        order.qty_ -= traded;
+                        emit(Exchange::MarketUpdateType::MODIFY, ticker_id, order);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("backtest", options);
+    pin_current_thread(options.core_);
+
+    const std::string name = "bench_backtest_md";
+    remove_journal(options.dir_, name);
+    record_market_data(options.dir_, name, iterations_or(options, 2'000'000));
+    Common::Logger logger(options.dir_ + "/bench_backtest.log");
+    const Trading::RecordedMarketData data(logger, options.dir_, name);
+
+    std::vector<Strategy::Params> params;
+    for (const Common::Price edge : {0, 1, 2, 3})
+        for (const Common::Qty clip : {1, 10})
+            for (const int64_t max_position : {10, 100, 1000, 10000})
+                params.push_back({edge, clip, max_position});
+
+    const auto max_workers = std::max(1u, std::thread::hardware_concurrency());
+    double single_worker_rate = 0;
+    int64_t single_worker_pnl = 0;
+    for (std::size_t num_workers = 1; num_workers <= max_workers; ++num_workers) {
+        const auto bench_name = "workers_" + std::to_string(num_workers);
+        if (!reporter.wants(bench_name))
+            continue;
+
+        Trading::BacktestConfig config;
+        config.num_workers_ = num_workers;
+        for (std::size_t w = 0; w < num_workers; ++w)
+            config.cores_.push_back(std::max(0, usable_core(options.core_ + static_cast<int>(w))));
+
+        Trading::BacktestEngine<Strategy> engine(data, config);
+        const auto results = engine.run(params);
+        const auto& stats = engine.get_stats();
+
+        // every worker count has to come up with the same answers
+        int64_t pnl = 0;
+        std::size_t fills = 0;
+        for (const auto& result : results) {
+            pnl += result.position_.total_pnl();
+            fills += result.fills_;
+        }
+        const auto rate = stats.events_per_sec();
+        if (num_workers == 1) {
+            single_worker_rate = rate;
+            single_worker_pnl = pnl;
+        }
+
+        BenchResult result;
+        result.name_ = bench_name;
+        result.ops_ = stats.events_;
+        result.ns_per_op_ = static_cast<double>(stats.elapsed_) / static_cast<double>(stats.events_);
+        result.latency_ = stats.pass_time_;
+
+        std::size_t steals = 0;
+        for (const auto& worker : stats.workers_)
+            steals += worker.steals_;
+
+        std::stringstream note;
+        note << data.size() << " recorded updates over " << data.tickers().size() << " instruments, " << params.size() << " parameter sets, "
+             << stats.runs_ << " runs in " << stats.passes_ << " passes, " << static_cast<uint64_t>(rate) << " book updates/s, "
+             << static_cast<uint64_t>(rate / static_cast<double>(num_workers)) << " per core, "
+             << static_cast<uint64_t>(static_cast<double>(stats.strategy_events_) * 1e9 / static_cast<double>(stats.elapsed_)) << " strategy updates/s";
+        if (single_worker_rate > 0)
+            note << ", scaling efficiency " << rate / (static_cast<double>(num_workers) * single_worker_rate);
+        note << ", " << steals << " steals, " << fills << " fills, total pnl " << pnl
+             << (single_worker_pnl == pnl ? "" : " (differs from 1 worker!)");
+        if (max_workers == 1)
+            note << ", single cpu so no scaling to show";
+        result.note_ = note.str();
+        reporter.report(result);
+    }
+
+    remove_journal(options.dir_, name);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+
+#include "bench/bench_utils.h"
+
+#include "trading/order_gw/order_journal.h"
+
+// Journal<OrderEvent>: cost of append() on the hot thread, sustained events/sec until the writer thread has everything
+// in the segment files, and the startup replay of the whole journal with a cold page cache.
+
+using namespace Bench;
+
+namespace {
+    auto remove_journal(const std::string& dir, const std::string& name) {
+        for (uint64_t index = 0; unlink(Common::journal_segment_path(dir, name, index).c_str()) == 0; ++index);
+    }
+
+    // drop the segments from the page cache so replay reads them from disk like after a restart
+    auto evict_journal(const std::string& dir, const std::string& name) {
+        for (uint64_t index = 0;; ++index) {
+            const auto fd = open(Common::journal_segment_path(dir, name, index).c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+
+    auto elapsed_ns(std::chrono::steady_clock::time_point start) {
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("journal", options);
+    pin_current_thread(options.core_);
+
+    const std::string name = "bench_journal_" + std::to_string(getpid());
+    // run() makes two passes of events / 2 appends, an odd --iterations would leave the last one out
+    const auto events = std::max<std::size_t>(iterations_or(options, 10'000'000), 2) / 2 * 2;
+    remove_journal(options.dir_, name);
+
+    {
+        Trading::OrderJournal journal(options.dir_, name);
+
+        Trading::OrderEvent event{Trading::OrderEventType::NEW_SENT, 1, 0, Common::OrderId_INVALID, Common::Side::BUY, 100, 10, 10, 0};
+        const auto start = std::chrono::steady_clock::now();
+        auto result = run("append_hot_thread", events / 2, [&](std::size_t i) {
+            event.client_order_id_ = i;
+            event.seq_num_ = i + 1;
+            journal.append(event, static_cast<Common::Nanos>(i));
+        });
+        result.note_ = "hot thread stalls on a full queue:" + std::to_string(journal.hot_stalls());
+        if (reporter.wants("append_hot_thread"))
+            reporter.report(result);
+
+        // both passes of run() together appended `events`, wait for the writer to get all of them into the segments
+        while (journal.records_written() < events)
+            spin_wait();
+
+        BenchResult sustained;
+        sustained.name_ = "sustained_write";
+        sustained.ops_ = events;
+        sustained.ns_per_op_ = elapsed_ns(start) / static_cast<double>(events);
+        sustained.note_ = std::to_string(static_cast<uint64_t>(1e9 / sustained.ns_per_op_)) + " events/sec incl. msync every " +
+                          std::to_string(Common::JOURNAL_MSYNC_BATCH) + " records, syncs:" + std::to_string(journal.num_syncs());
+        if (reporter.wants("sustained_write"))
+            reporter.report(sustained);
+    }
+
+    if (reporter.wants("replay_cold")) {
+        evict_journal(options.dir_, name);
+
+        std::size_t checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        const auto replayed = Trading::OrderJournal::replay(options.dir_, name, [&checksum](const Trading::OrderJournal::Record& record) {
+            checksum += record.event_.client_order_id_;
+        });
+        const auto ns = elapsed_ns(start);
+        do_not_optimize(checksum);
+
+        BenchResult result;
+        result.name_ = "replay_cold";
+        result.ops_ = replayed.records_;
+        result.ns_per_op_ = ns / static_cast<double>(replayed.records_ ? replayed.records_ : 1);
+        result.note_ = std::to_string(replayed.records_) + " records in " + std::to_string(replayed.segments_) + " segments, " +
+                       std::to_string(ns / 1e6) + " ms" + (replayed.records_ == events ? "" : ", EXPECTED " + std::to_string(events));
+        reporter.report(result);
+    }
+
+    remove_journal(options.dir_, name);
+    return 0;
+}
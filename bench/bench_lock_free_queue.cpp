@@ -0,0 +1,107 @@
+#include <atomic>
+
+#include "bench/bench_utils.h"
+
+#include "common/lock_free_queue.h"
+#include "exchange/market_data/market_update.h"
+
+// LockFreeQueue<MEMarketUpdate>: uncontended write + read on one thread, ping-pong round trip between two pinned threads
+// and sustained single producer / single consumer throughput.
+
+using namespace Bench;
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("lock_free_queue", options);
+    pin_current_thread(options.core_);
+
+    if (reporter.wants("write_read_same_thread")) {
+        Exchange::MEMarketUpdateLFQueue queue(Common::ME_MAX_MARKET_UPDATES);
+        const Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 1, 0, Common::Side::BUY, 100, 10, 1};
+        auto result = run("write_read_same_thread", iterations_or(options, 10'000'000), [&](std::size_t) {
+            *queue.get_next_write() = update;
+            queue.update_write_index();
+            do_not_optimize(*queue.get_next_read());
+            queue.update_read_index();
+        });
+        reporter.report(result);
+    }
+
+    if (reporter.wants("ping_pong_rtt")) {
+        Exchange::MEMarketUpdateLFQueue ping(Common::ME_MAX_MARKET_UPDATES), pong(Common::ME_MAX_MARKET_UPDATES);
+        std::atomic_bool running {true};
+        auto peer = Common::create_and_start_thread(usable_core(options.peer_core_), "Bench/LFQEcho", [&]() {
+            while (running) {
+                auto next = ping.get_next_read();
+                if (!next) {
+                    spin_wait();
+                    continue;
+                }
+                *pong.get_next_write() = *next;
+                ping.update_read_index();
+                pong.update_write_index();
+            }
+        });
+        ASSERT(peer != nullptr, "Failed to start echo thread.");
+
+        Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 1, 0, Common::Side::BUY, 100, 10, 1};
+        auto result = run("ping_pong_rtt", iterations_or(options, 100'000), [&](std::size_t i) {
+            update.order_id_ = i;
+            *ping.get_next_write() = update;
+            ping.update_write_index();
+            const Exchange::MEMarketUpdate* reply = nullptr;
+            while (!(reply = pong.get_next_read()))
+                spin_wait();
+            do_not_optimize(*reply);
+            pong.update_read_index();
+        });
+        result.note_ = single_cpu_note();
+        reporter.report(result);
+
+        running = false;
+        peer->join();
+        delete peer;
+    }
+
+    if (reporter.wants("spsc_throughput")) {
+        // the queue has no full check, the producer keeps one slot free itself
+        const std::size_t capacity = Common::ME_MAX_MARKET_UPDATES;
+        Exchange::MEMarketUpdateLFQueue queue(capacity);
+        const auto ops = iterations_or(options, 10'000'000);
+        std::thread* producer = nullptr;
+
+        auto start_producer = [&]() {
+            if (producer) {
+                producer->join();
+                delete producer;
+            }
+            producer = Common::create_and_start_thread(usable_core(options.peer_core_), "Bench/LFQProducer", [&queue, ops, capacity]() {
+                Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 0, 0, Common::Side::BUY, 100, 10, 1};
+                for (std::size_t i = 0; i < ops; ++i) {
+                    while (queue.size() >= capacity - 1)
+                        spin_wait();
+                    update.order_id_ = i;
+                    *queue.get_next_write() = update;
+                    queue.update_write_index();
+                }
+            });
+            ASSERT(producer != nullptr, "Failed to start producer thread.");
+        };
+
+        auto result = run("spsc_throughput", ops, start_producer, [&](std::size_t) {
+            const Exchange::MEMarketUpdate* next = nullptr;
+            while (!(next = queue.get_next_read()))
+                spin_wait();
+            do_not_optimize(*next);
+            queue.update_read_index();
+        });
+        result.note_ = "consumer side, latency includes waiting for the producer" +
+                       (single_cpu_note().empty() ? std::string{} : ", " + single_cpu_note());
+        reporter.report(result);
+
+        producer->join();
+        delete producer;
+    }
+
+    return 0;
+}
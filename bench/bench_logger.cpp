@@ -0,0 +1,51 @@
+#include <algorithm>
+
+#include "bench/bench_utils.h"
+
+#include "common/logging.h"
+
+// Cost of Logger::log() on the calling thread, i.e. formatting and pushing every character into the queue. The
+// background thread writing the file is not part of the measurement but shares the machine.
+
+using namespace Bench;
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("logger", options);
+    pin_current_thread(options.core_);
+
+    // the queue has no full check, both passes of a benchmark together stay below LOG_QUEUE_SIZE characters
+    // (lines are < 128 characters) and every benchmark gets a fresh logger, whose destructor drains the queue
+    const auto ops = std::min<std::size_t>(iterations_or(options, 30'000), Common::LOG_QUEUE_SIZE / (2 * 128));
+    const auto log_file = options.dir_ + "/bench_logger.log";
+    std::string time_str;
+
+    if (reporter.wants("log_typical_line")) {
+        Common::Logger logger(log_file);
+        auto result = run("log_typical_line", ops, [&](std::size_t i) {
+            logger.log("%:% %() % read socket:% len:% ktime:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::get_current_time_str(time_str), 7, i, 1234567890L);
+        });
+        result.note_ = "same shape as the socket read log lines, includes get_current_time_str()";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("log_int_args")) {
+        Common::Logger logger(log_file);
+        auto result = run("log_int_args", ops, [&](std::size_t i) {
+            logger.log("seq:% px:% qty:%\n", i, 100L, 10U);
+        });
+        reporter.report(result);
+    }
+
+    if (reporter.wants("log_64_char_string")) {
+        Common::Logger logger(log_file);
+        const std::string payload(64, 'x');
+        auto result = run("log_64_char_string", ops, [&](std::size_t) {
+            logger.log("%\n", payload);
+        });
+        reporter.report(result);
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "bench/bench_utils.h"
+
+#include "common/mcast_socket.h"
+
+// McastSocket publish -> receive on one host through IP_MULTICAST_LOOP, one 64 byte datagram per op, both sockets
+// driven from one thread. The interface (--iface) has to be multicast capable, the benchmark is reported as skipped
+// when nothing arrives.
+
+using namespace Bench;
+
+namespace {
+    auto histogram_result(const std::string& name, const Common::LatencyHistogram& histogram, const std::string& note) {
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = histogram.count();
+        result.ns_per_op_ = histogram.mean();
+        result.latency_ = histogram;
+        result.note_ = note;
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("mcast_socket", options);
+    pin_current_thread(options.core_);
+
+    const std::string group = "239.0.0.17";
+    constexpr int port = 20017;
+    constexpr std::size_t msg_size = 64;
+
+    Common::Logger logger(options.dir_ + "/bench_mcast_socket.log");
+    Common::McastSocket publisher(logger), subscriber(logger);
+
+    ASSERT(publisher.init(group, options.iface_, port, false, true) >= 0, "Unable to create publisher socket on " + options.iface_);
+    ASSERT(subscriber.init(group, options.iface_, port, true, true) >= 0, "Unable to create subscriber socket on " + options.iface_);
+    ASSERT(subscriber.join(group), "Join failed on " + options.iface_ + " error: " + std::string{strerror(errno)});
+
+    std::size_t received = 0;
+    subscriber.recv_callback_ = [&received](Common::McastSocket* socket) {
+        received += socket->next_rcv_valid_index_;
+        socket->next_rcv_valid_index_ = 0;
+    };
+
+    char msg[msg_size] = {};
+    auto publish_and_receive = [&](std::size_t i, Common::Nanos timeout) {
+        memcpy(msg, &i, sizeof(i));
+        publisher.send(msg, msg_size);
+        publisher.send_and_recv();
+        const auto expected = received + msg_size;
+        const auto start = Common::getCurrentNanos();
+        while (received < expected) {
+            subscriber.send_and_recv();
+            if (UNLIKELY(timeout && Common::getCurrentNanos() - start > timeout))
+                return false;
+        }
+        return true;
+    };
+
+    if (!publish_and_receive(0, 1'000'000'000)) {
+        for (auto name : {"publish_receive_64b", "subscriber_rx_kernel_to_user", "publisher_tx_user_to_kernel"})
+            if (reporter.wants(name))
+                reporter.skip(name, "no multicast delivered on iface " + options.iface_ + ", pass a multicast capable --iface");
+        return 0;
+    }
+
+    if (reporter.wants("publish_receive_64b")) {
+        auto result = run("publish_receive_64b", iterations_or(options, 100'000), [&](std::size_t i) { publish_and_receive(i, 0); });
+        result.note_ = "publisher and subscriber on one thread, includes Logger calls on every read and send";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("subscriber_rx_kernel_to_user"))
+        reporter.report(histogram_result("subscriber_rx_kernel_to_user", subscriber.timestamps_.rx_latency_,
+            "SO_TIMESTAMPING software rx timestamp to recvmsg() return, whole run, non monotonic:" + std::to_string(subscriber.timestamps_.rx_non_monotonic_)));
+
+    if (reporter.wants("publisher_tx_user_to_kernel"))
+        reporter.report(histogram_result("publisher_tx_user_to_kernel", publisher.timestamps_.tx_latency_,
+            "send() call to SO_TIMESTAMPING software tx timestamp, whole run, unmatched:" + std::to_string(publisher.timestamps_.tx_unmatched_) +
+            " non monotonic:" + std::to_string(publisher.timestamps_.tx_non_monotonic_)));
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "bench/bench_utils.h"
+#include "test/two_stream_feed.h"
+
+#include "trading/market_data/market_data_consumer.h"
+
+// MarketDataConsumer recovery time against book depth and incoming message rate, publisher (test/two_stream_feed.h)
+// and consumer on one thread over multicast loopback. Each op: a datagram's worth of incrementals is dropped, the
+// consumer detects the gap and joins the snapshot stream, the publisher answers with a snapshot right away, one datagram
+// per loop iteration, while incrementals keep coming at the given rate. Reported is the consumer's own gap detected ->
+// back in sync time (RecoveryStats), so a venue's wait for its next snapshot cycle is not part of it. After every
+// recovery the books rebuilt from the consumer's output are compared level by level with the publisher's.
+
+using namespace Bench;
+
+namespace {
+    const std::string INCREMENTAL_IP = "239.0.0.26";
+    constexpr int INCREMENTAL_PORT = 20026;
+    const std::string SNAPSHOT_IP = "239.0.0.27";
+    constexpr int SNAPSHOT_PORT = 20027;
+    constexpr std::size_t NUM_INSTRUMENTS = 4;
+
+    auto histogram_result(const std::string& name, const Common::LatencyHistogram& histogram, const std::string& note) {
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = histogram.count();
+        result.ns_per_op_ = histogram.mean();
+        result.latency_ = histogram;
+        result.note_ = note;
+        return result;
+    }
+
+    struct Client {
+        Exchange::MEMarketUpdateLFQueue updates_{Trading::MD_MAX_QUEUED_INCREMENTALS};
+        Trading::MarketDataConsumer consumer_;
+        std::vector<std::unique_ptr<Trading::MarketOrderBook>> books_;
+
+        Client(Common::ClientId client_id, const std::string& iface)
+            : consumer_{client_id, &updates_, iface, SNAPSHOT_IP, SNAPSHOT_PORT, INCREMENTAL_IP, INCREMENTAL_PORT} {
+            for (std::size_t ticker_id = 0; ticker_id < NUM_INSTRUMENTS; ++ticker_id)
+                books_.push_back(std::make_unique<Trading::MarketOrderBook>(static_cast<Common::TickerId>(ticker_id)));
+        }
+
+        auto poll() {
+            consumer_.poll();
+            for (auto update = updates_.get_next_read(); update; update = updates_.get_next_read()) {
+                books_[update->ticker_id_]->on_market_update(update);
+                updates_.update_read_index();
+            }
+        }
+
+        auto in_sync_with(const Test::TwoStreamFeed& feed) const {
+            return !consumer_.in_recovery() && consumer_.next_expected_seq_num() == feed.next_seq_num();
+        }
+
+        auto books_match(const Test::TwoStreamFeed& feed) const {
+            for (std::size_t ticker_id = 0; ticker_id < NUM_INSTRUMENTS; ++ticker_id)
+                if (!Test::same_book(*books_[ticker_id], feed.reference_book(static_cast<Common::TickerId>(ticker_id))))
+                    return false;
+            return true;
+        }
+    };
+
+    // publishes whatever the rate says is due since start, at most a datagram's worth per call
+    struct Pacer {
+        double rate_;
+        Common::Nanos start_ = Common::getCurrentNanos();
+        std::size_t sent_ = 0;
+
+        auto due(Common::Nanos now) noexcept {
+            const auto target = static_cast<std::size_t>(static_cast<double>(now - start_) * rate_ / 1e9);
+            return std::min(target > sent_ ? target - sent_ : 0, Test::TwoStreamFeed::UPDATES_PER_DATAGRAM);
+        }
+    };
+
+    auto run_case(BenchReporter& reporter, const BenchOptions& options, Test::TwoStreamFeed& feed, Client& client,
+                  std::size_t depth, double rate) {
+        const auto name = "recovery_depth" + std::to_string(depth) + "_rate" + std::to_string(static_cast<uint64_t>(rate));
+        if (!reporter.wants(name))
+            return;
+
+        Common::LatencyHistogram recovery_times;
+        std::size_t snapshot_updates = 0, replayed = 0, mismatches = 0, timeouts = 0;
+        const auto recoveries = iterations_or(options, 20);
+        Pacer pacer{rate};
+
+        for (std::size_t r = 0; r < recoveries; ++r) {
+            feed.publish(Test::TwoStreamFeed::UPDATES_PER_DATAGRAM, true);
+
+            bool snapshot_started = false;
+            const auto deadline = Common::getCurrentNanos() + 5'000'000'000;
+            while (!snapshot_started || !client.in_sync_with(feed)) {
+                const auto now = Common::getCurrentNanos();
+                if (now > deadline) {
+                    ++timeouts;
+                    break;
+                }
+                if (const auto n = pacer.due(now)) {
+                    feed.publish(n);
+                    pacer.sent_ += n;
+                }
+                if (!snapshot_started && client.consumer_.in_recovery()) {
+                    feed.start_snapshot();
+                    snapshot_started = true;
+                }
+                if (snapshot_started)
+                    feed.send_snapshot_datagram();
+                client.poll();
+            }
+
+            const auto& stats = client.consumer_.get_recovery_stats();
+            if (stats.end_time_) {
+                recovery_times.record(stats.end_time_ - stats.start_time_);
+                snapshot_updates += stats.snapshot_updates_;
+                replayed += stats.incrementals_replayed_;
+            }
+            mismatches += !client.books_match(feed);
+        }
+
+        const auto elapsed = Common::getCurrentNanos() - pacer.start_;
+        std::stringstream note;
+        const auto count = std::max<std::size_t>(recovery_times.count(), 1);
+        note << NUM_INSTRUMENTS << " instruments " << depth << " levels a side, " << snapshot_updates / count << " snapshot updates and "
+             << replayed / count << " replayed incrementals per recovery on average, incrementals published at "
+             << static_cast<uint64_t>(static_cast<double>(pacer.sent_) * 1e9 / static_cast<double>(elapsed)) << "/s (asked "
+             << static_cast<uint64_t>(rate) << "/s), book mismatches after recovery:" << mismatches << " timeouts:" << timeouts;
+        reporter.report(histogram_result(name, recovery_times, note.str()));
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("md_recovery", options);
+    pin_current_thread(options.core_);
+
+    const std::size_t depths[] = {5, 50, 250};
+    const double rates[] = {10'000, 100'000, 1'000'000};
+
+    Common::Logger logger(options.dir_ + "/bench_md_recovery.log");
+    for (const auto depth : depths) {
+        bool wanted = false;
+        for (const auto rate : rates)
+            wanted |= reporter.wants("recovery_depth" + std::to_string(depth) + "_rate" + std::to_string(static_cast<uint64_t>(rate)));
+        if (!wanted)
+            continue;
+
+        Test::TwoStreamFeed feed(logger, options.iface_, INCREMENTAL_IP, INCREMENTAL_PORT, SNAPSHOT_IP, SNAPSHOT_PORT, NUM_INSTRUMENTS, depth);
+        Client client(static_cast<Common::ClientId>(depth), options.iface_);
+
+        // build the book up to its steady state depth, in sync all along
+        const auto warmup = 20 * NUM_INSTRUMENTS * depth * Test::TwoStreamFeed::ORDERS_PER_LEVEL;
+        auto delivered = true;
+        for (std::size_t sent = 0; sent < warmup && delivered; sent += Test::TwoStreamFeed::UPDATES_PER_DATAGRAM) {
+            feed.publish(Test::TwoStreamFeed::UPDATES_PER_DATAGRAM);
+            const auto deadline = Common::getCurrentNanos() + 1'000'000'000;
+            while (!client.in_sync_with(feed) && (delivered = Common::getCurrentNanos() < deadline))
+                client.poll();
+        }
+        if (!delivered) {
+            for (const auto rate : rates)
+                reporter.skip("recovery_depth" + std::to_string(depth) + "_rate" + std::to_string(static_cast<uint64_t>(rate)),
+                    "no multicast delivered on iface " + options.iface_ + ", pass a multicast capable --iface");
+            continue;
+        }
+
+        for (const auto rate : rates)
+            run_case(reporter, options, feed, client, depth, rate);
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <random>
+
+#include "bench/bench_utils.h"
+
+#include "common/memory_pool.h"
+#include "exchange/market_data/market_update.h"
+
+// MemoryPool<MEMarketUpdate>: allocate + deallocate on an empty pool, and on a pool kept 90% full where the free
+// blocks are scattered across the store.
+
+using namespace Bench;
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("memory_pool", options);
+    pin_current_thread(options.core_);
+
+    if (reporter.wants("allocate_deallocate_empty")) {
+        Common::MemoryPool<Exchange::MEMarketUpdate> pool(Common::ME_MAX_ORDER_IDS);
+        auto result = run("allocate_deallocate_empty", iterations_or(options, 10'000'000), [&](std::size_t i) {
+            auto update = pool.allocate(Exchange::MarketUpdateType::ADD, i, 0, Common::Side::BUY, 100, 10, 1);
+            do_not_optimize(update);
+            pool.deallocate(update);
+        });
+        reporter.report(result);
+    }
+
+    if (reporter.wants("allocate_deallocate_90pct_full")) {
+        constexpr std::size_t pool_size = 64 * 1024;
+        Common::MemoryPool<Exchange::MEMarketUpdate> pool(pool_size);
+        std::vector<Exchange::MEMarketUpdate*> live;
+        std::mt19937_64 rng(42);
+
+        for (std::size_t i = 0; i < pool_size * 9 / 10; ++i)
+            live.push_back(pool.allocate(Exchange::MarketUpdateType::ADD, i, 0, Common::Side::BUY, 100, 10, 1));
+
+        // every op frees a random live block and allocates a new one, the free blocks end up scattered
+        std::vector<std::size_t> victims(iterations_or(options, 1'000'000));
+        for (auto& victim : victims)
+            victim = rng() % live.size();
+
+        auto result = run("allocate_deallocate_90pct_full", victims.size(), [&](std::size_t i) {
+            auto& slot = live[victims[i]];
+            pool.deallocate(slot);
+            slot = pool.allocate(Exchange::MarketUpdateType::ADD, i, 0, Common::Side::BUY, 100, 10, 1);
+        });
+        result.note_ = "pool of " + std::to_string(pool_size) + ", one deallocate + one allocate per op";
+        reporter.report(result);
+    }
+
+    return 0;
+}
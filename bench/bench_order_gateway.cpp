@@ -0,0 +1,130 @@
+#include "bench/bench_utils.h"
+
+#include "common/tcp_server.h"
+#include "trading/order_gw/order_gateway.h"
+
+// OrderGateway decision-to-send over loopback TCP, one thread: the strategy decides, send_new_order() patches the
+// pre-encoded template, sequences it, keeps the resend copy and flushes it to the kernel. _send times that call alone
+// (TSC), _exchange_rx runs from the decision (getCurrentNanos() just before the call) to the kernel rx timestamp on the
+// TCPServer's accepted socket, i.e. including the loopback TCP stack. The exchange side is drained after every order,
+// outside the timed part. Run without and with an OrderJournal on the gateway. On loopback the receiving socket is
+// processed inside the sender's send() call, so _exchange_rx comes out shorter than _send: it stops before the syscall
+// returns.
+
+using namespace Bench;
+
+namespace {
+    constexpr Common::ClientId CLIENT_ID = 1;
+    constexpr int PORT = 12348;
+    constexpr std::size_t DECISION_TIMES_SIZE = 64 * 1024;
+
+    auto histogram_result(const std::string& name, const Common::LatencyHistogram& histogram, const std::string& note) {
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = histogram.count();
+        result.ns_per_op_ = histogram.mean();
+        result.latency_ = histogram;
+        result.note_ = note;
+        return result;
+    }
+
+    auto remove_journal(const std::string& dir, const std::string& name) {
+        for (uint64_t index = 0; unlink(Common::journal_segment_path(dir, name, index).c_str()) == 0; ++index);
+    }
+
+    // exchange side, records decision -> kernel rx for every sequenced request read
+    struct ExchangeSide {
+        Common::TCPServer server_;
+        std::array<Common::Nanos, DECISION_TIMES_SIZE> decision_times_{};
+        Common::LatencyHistogram to_exchange_rx_;
+        std::size_t received_ = 0;
+
+        explicit ExchangeSide(Common::Logger& logger, const std::string& iface) : server_{logger} {
+            server_.recv_callback_ = [this](Common::TCPSocket* socket, Common::Nanos rx_time) {
+                std::size_t i = 0;
+                for (; i + sizeof(Exchange::OMClientRequest) <= socket->next_recv_valid_index_; i += sizeof(Exchange::OMClientRequest)) {
+                    auto request = reinterpret_cast<const Exchange::OMClientRequest*>(socket->inbound_data_.data() + i);
+                    if (request->me_client_request_.type_ == Exchange::ClientRequestType::HEARTBEAT)
+                        continue;
+                    if (rx_time)
+                        to_exchange_rx_.record(rx_time - decision_times_[request->seq_num_ % DECISION_TIMES_SIZE]);
+                    ++received_;
+                }
+                memmove(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_recv_valid_index_ - i);
+                socket->next_recv_valid_index_ -= i;
+            };
+            server_.recv_finished_callback_ = []() {};
+            server_.listen(iface, PORT, true);
+        }
+
+        auto drain(Trading::OrderGateway& gateway, std::size_t expected) {
+            while (received_ < expected) {
+                gateway.poll(Common::getCurrentNanos());
+                server_.poll();
+                server_.send_and_recv();
+            }
+        }
+    };
+
+    auto measure(BenchReporter& reporter, const BenchOptions& options, ExchangeSide& exchange, const std::string& suffix,
+                 Trading::OrderJournal* journal) {
+        const auto send_name = "decision_to_send" + suffix;
+        const auto rx_name = "decision_to_exchange_rx" + suffix;
+        if (!reporter.wants(send_name) && !reporter.wants(rx_name))
+            return;
+
+        Exchange::ClientResponseLFQueue responses(Common::ME_MAX_CLIENT_UPDATES);
+        Trading::OrderGateway gateway(CLIENT_ID, &responses, "", options.iface_, PORT, Trading::OG_HEARTBEAT_INTERVAL,
+                                      Trading::OG_RESEND_STORE_SIZE, journal);
+        gateway.connect();
+
+        // the connect completes in the background, the first order also waits for the accept
+        exchange.received_ = 0;
+        gateway.send_new_order(0, Common::Side::BUY, 100, 10, 1);
+        exchange.drain(gateway, 1);
+        exchange.to_exchange_rx_.reset();
+
+        const auto& clock = TscClock::instance();
+        Common::LatencyHistogram to_send;
+        const auto ops = iterations_or(options, 100'000);
+        for (std::size_t i = 0; i < ops; ++i) {
+            const auto ticker_id = static_cast<Common::TickerId>(i % Common::ME_MAX_TICKERS);
+            const auto side = (i & 1) ? Common::Side::SELL : Common::Side::BUY;
+            exchange.decision_times_[gateway.next_outgoing_seq_num() % DECISION_TIMES_SIZE] = Common::getCurrentNanos();
+            const auto t0 = TscClock::now();
+            gateway.send_new_order(ticker_id, side, static_cast<Common::Price>(100 + (i & 7)), 10, i + 2);
+            const auto t1 = TscClock::now();
+            const auto ticks = t1 - t0;
+            to_send.record(clock.to_nanos(ticks > clock.overhead_ticks() ? ticks - clock.overhead_ticks() : 0));
+            exchange.drain(gateway, i + 2);
+        }
+
+        const std::string journal_note = journal ? ", OrderJournal append on the hot thread" : ", no journal";
+        if (reporter.wants(send_name))
+            reporter.report(histogram_result(send_name, to_send,
+                "send_new_order(): template copy, patch, resend store copy, send() to the kernel" + journal_note));
+        if (reporter.wants(rx_name))
+            reporter.report(histogram_result(rx_name, exchange.to_exchange_rx_,
+                "decision to SO_TIMESTAMPING software rx timestamp on the exchange's socket, loopback TCP" + journal_note));
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("order_gateway", options);
+    pin_current_thread(options.core_);
+
+    Common::Logger logger(options.dir_ + "/bench_order_gateway.log");
+    ExchangeSide exchange(logger, options.iface_);
+
+    measure(reporter, options, exchange, "", nullptr);
+
+    const std::string journal_name = "bench_order_gateway_" + std::to_string(getpid());
+    remove_journal(options.dir_, journal_name);
+    {
+        Trading::OrderJournal journal(options.dir_, journal_name);
+        measure(reporter, options, exchange, "_journal", &journal);
+    }
+    remove_journal(options.dir_, journal_name);
+    return 0;
+}
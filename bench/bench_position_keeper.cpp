@@ -0,0 +1,75 @@
+#include <random>
+
+#include "bench/bench_utils.h"
+
+#include "trading/strategy/position_keeper.h"
+
+// PositionKeeper with 10k instruments and 4 strategies: one fill at a random (strategy, instrument), one BBO tick
+// re-marking a random instrument that every strategy holds, and the cost of a reader taking a consistent snapshot of
+// all the totals.
+
+using namespace Bench;
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("position_keeper", options);
+    pin_current_thread(options.core_);
+
+    constexpr std::size_t num_instruments = 10'000;
+    constexpr std::size_t num_strategies = 4;
+    const auto note = std::to_string(num_instruments) + " instruments x " + std::to_string(num_strategies) + " strategies";
+
+    std::mt19937_64 rng(42);
+    const auto ops = iterations_or(options, 5'000'000);
+    std::vector<Common::TickerId> tickers(ops);
+    std::vector<Common::StrategyId> strategies(ops);
+    std::vector<Common::Price> prices(ops);
+    for (std::size_t i = 0; i < ops; ++i) {
+        tickers[i] = static_cast<Common::TickerId>(rng() % num_instruments);
+        strategies[i] = static_cast<Common::StrategyId>(rng() % num_strategies);
+        prices[i] = 1000 + static_cast<Common::Price>(rng() % 100);
+    }
+
+    // every (strategy, instrument) holds a position and every instrument has a BBO, so nothing takes a flat shortcut
+    auto make_keeper = [&]() {
+        auto keeper = std::make_unique<Trading::PositionKeeper>(num_instruments, num_strategies);
+        for (Common::TickerId ticker_id = 0; ticker_id < num_instruments; ++ticker_id) {
+            keeper->on_bbo(ticker_id, 1049, 1051);
+            for (Common::StrategyId strategy_id = 0; strategy_id < num_strategies; ++strategy_id)
+                keeper->on_fill(strategy_id, ticker_id, Common::Side::BUY, 1050, 100);
+        }
+        return keeper;
+    };
+
+    if (reporter.wants("on_fill")) {
+        auto keeper = make_keeper();
+        auto result = run("on_fill", ops, [&](std::size_t i) {
+            keeper->on_fill(strategies[i], tickers[i], i & 1 ? Common::Side::SELL : Common::Side::BUY, prices[i], 1 + (i & 7));
+        });
+        result.note_ = note + ", random instrument per fill";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("on_bbo")) {
+        auto keeper = make_keeper();
+        auto result = run("on_bbo", ops, [&](std::size_t i) {
+            keeper->on_bbo(tickers[i], prices[i], prices[i] + 2);
+        });
+        result.note_ = note + ", every strategy holds the ticked instrument";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("read_all_totals")) {
+        auto keeper = make_keeper();
+        std::vector<Trading::PnlTotals> strategy_totals(num_strategies);
+        Trading::PnlTotals aggregate_totals;
+        auto result = run("read_all_totals", ops, [&](std::size_t) {
+            keeper->get_all_totals(strategy_totals.data(), aggregate_totals);
+            do_not_optimize(aggregate_totals);
+        });
+        result.note_ = note + ", uncontended reader";
+        reporter.report(result);
+    }
+
+    return 0;
+}
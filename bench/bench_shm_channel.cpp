@@ -0,0 +1,157 @@
+#include <atomic>
+#include <sys/wait.h>
+
+#include "bench/bench_utils.h"
+
+#include "common/shm_channel.h"
+#include "exchange/market_data/market_update.h"
+
+// ShmChannel<MEMarketUpdate> between two processes: ping-pong round trip and sustained throughput, plus the same ping-pong
+// between two threads of one process to compare against lock_free_queue/ping_pong_rtt.
+
+using namespace Bench;
+
+namespace {
+    using Channel = Common::ShmChannel<Exchange::MEMarketUpdate>;
+
+    constexpr std::size_t CHANNEL_SIZE = 64 * 1024;
+
+    // echo everything from ping back on pong until an INVALID update arrives
+    auto echo(Channel& ping, Channel& pong) {
+        while (true) {
+            auto next = ping.get_next_read();
+            if (!next) {
+                spin_wait();
+                continue;
+            }
+            const auto update = *next;
+            ping.update_read_index();
+            if (update.type_ == Exchange::MarketUpdateType::INVALID)
+                return;
+
+            Exchange::MEMarketUpdate* slot = nullptr;
+            while (!(slot = pong.get_next_write()))
+                spin_wait();
+            *slot = update;
+            pong.update_write_index();
+        }
+    }
+
+    auto send(Channel& channel, const Exchange::MEMarketUpdate& update) {
+        Exchange::MEMarketUpdate* slot = nullptr;
+        while (!(slot = channel.get_next_write()))
+            spin_wait();
+        *slot = update;
+        channel.update_write_index();
+    }
+
+    auto ping_pong(Channel& ping, Channel& pong, Exchange::MEMarketUpdate& update, std::size_t i) {
+        update.order_id_ = i;
+        send(ping, update);
+        const Exchange::MEMarketUpdate* reply = nullptr;
+        while (!(reply = pong.get_next_read()))
+            spin_wait();
+        do_not_optimize(*reply);
+        pong.update_read_index();
+    }
+
+    // runs f in a forked child pinned to core, the child attaches to the channels itself
+    template<typename F>
+    auto fork_peer(int core, F&& f) {
+        const auto pid = fork();
+        ASSERT(pid >= 0, "fork() failed. errno: " + std::string{strerror(errno)});
+        if (!pid) {
+            pin_current_thread(core);
+            f();
+            _exit(EXIT_SUCCESS);
+        }
+        return pid;
+    }
+
+    auto wait_peer(pid_t pid) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "Benchmark peer process failed.");
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("shm_channel", options);
+    pin_current_thread(options.core_);
+
+    const std::string ping_name = "/bench_shm_ping_" + std::to_string(getpid());
+    const std::string pong_name = "/bench_shm_pong_" + std::to_string(getpid());
+    const Exchange::MEMarketUpdate stop{};
+
+    if (reporter.wants("ping_pong_rtt_processes")) {
+        Channel ping(ping_name, Common::ShmChannelRole::PRODUCER, CHANNEL_SIZE);
+        Channel pong(pong_name, Common::ShmChannelRole::CONSUMER, CHANNEL_SIZE);
+        const auto peer = fork_peer(options.peer_core_, [&]() {
+            Channel peer_ping(ping_name, Common::ShmChannelRole::CONSUMER);
+            Channel peer_pong(pong_name, Common::ShmChannelRole::PRODUCER);
+            echo(peer_ping, peer_pong);
+        });
+
+        Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 1, 0, Common::Side::BUY, 100, 10, 1};
+        auto result = run("ping_pong_rtt_processes", iterations_or(options, 100'000), [&](std::size_t i) { ping_pong(ping, pong, update, i); });
+        result.note_ = single_cpu_note();
+        reporter.report(result);
+
+        send(ping, stop);
+        wait_peer(peer);
+    }
+
+    if (reporter.wants("ping_pong_rtt_threads")) {
+        Channel ping(ping_name, Common::ShmChannelRole::PRODUCER, CHANNEL_SIZE);
+        Channel pong(pong_name, Common::ShmChannelRole::CONSUMER, CHANNEL_SIZE);
+        Channel peer_ping(ping_name, Common::ShmChannelRole::CONSUMER);
+        Channel peer_pong(pong_name, Common::ShmChannelRole::PRODUCER);
+        auto peer = Common::create_and_start_thread(usable_core(options.peer_core_), "Bench/ShmEcho", [&]() { echo(peer_ping, peer_pong); });
+        ASSERT(peer != nullptr, "Failed to start echo thread.");
+
+        Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 1, 0, Common::Side::BUY, 100, 10, 1};
+        auto result = run("ping_pong_rtt_threads", iterations_or(options, 100'000), [&](std::size_t i) { ping_pong(ping, pong, update, i); });
+        result.note_ = single_cpu_note();
+        reporter.report(result);
+
+        send(ping, stop);
+        peer->join();
+        delete peer;
+    }
+
+    if (reporter.wants("throughput_processes")) {
+        const auto ops = iterations_or(options, 10'000'000);
+        Channel channel(ping_name, Common::ShmChannelRole::CONSUMER, CHANNEL_SIZE);
+        pid_t peer = -1;
+
+        // a fresh producer process for each pass of run()
+        auto start_producer = [&]() {
+            if (peer > 0)
+                wait_peer(peer);
+            peer = fork_peer(options.peer_core_, [&]() {
+                Channel producer(ping_name, Common::ShmChannelRole::PRODUCER);
+                Exchange::MEMarketUpdate update{Exchange::MarketUpdateType::ADD, 0, 0, Common::Side::BUY, 100, 10, 1};
+                for (std::size_t i = 0; i < ops; ++i) {
+                    update.order_id_ = i;
+                    send(producer, update);
+                }
+            });
+        };
+
+        auto result = run("throughput_processes", ops, start_producer, [&](std::size_t) {
+            const Exchange::MEMarketUpdate* next = nullptr;
+            while (!(next = channel.get_next_read()))
+                spin_wait();
+            do_not_optimize(*next);
+            channel.update_read_index();
+        });
+        result.note_ = "consumer side, latency includes waiting for the producer" +
+                       (single_cpu_note().empty() ? std::string{} : ", " + single_cpu_note());
+        reporter.report(result);
+
+        wait_peer(peer);
+    }
+
+    return 0;
+}
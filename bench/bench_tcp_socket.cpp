@@ -0,0 +1,81 @@
+#include "bench/bench_utils.h"
+
+#include "common/tcp_server.h"
+#include "common/tcp_socket.h"
+
+// Loopback TCPSocket round trip: the client sends a 64 byte message, the TCPServer echoes it and the client reads it
+// back, everything driven from one thread so no scheduler hand-off is measured. The SO_TIMESTAMPING histograms the
+// client socket collected along the way (kernel -> user on receive, user -> kernel on send) are reported as well.
+
+using namespace Bench;
+
+namespace {
+    auto histogram_result(const std::string& name, const Common::LatencyHistogram& histogram, const std::string& note) {
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = histogram.count();
+        result.ns_per_op_ = histogram.mean();
+        result.latency_ = histogram;
+        result.note_ = note;
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("tcp_socket", options);
+    pin_current_thread(options.core_);
+
+    constexpr int port = 12345;
+    constexpr std::size_t msg_size = 64;
+
+    Common::Logger logger(options.dir_ + "/bench_tcp_socket.log");
+    Common::TCPServer server(logger);
+    server.recv_callback_ = [](Common::TCPSocket* socket, Common::Nanos) {
+        socket->send(socket->inbound_data_.data(), socket->next_recv_valid_index_);
+        socket->next_recv_valid_index_ = 0;
+    };
+    server.recv_finished_callback_ = []() {};
+    server.listen(options.iface_, port, true);
+
+    Common::TCPSocket client(logger);
+    std::size_t received = 0;
+    client.recv_callback_ = [&received](Common::TCPSocket* socket, Common::Nanos) {
+        received += socket->next_recv_valid_index_;
+        socket->next_recv_valid_index_ = 0;
+    };
+    ASSERT(client.connect("", options.iface_, port, false, true) >= 0, "Unable to connect to the echo server on " + options.iface_);
+
+    char msg[msg_size] = {};
+    auto round_trip = [&](std::size_t i) {
+        memcpy(msg, &i, sizeof(i));
+        client.send(msg, msg_size);
+        const auto expected = received + msg_size;
+        while (received < expected) {
+            client.send_and_recv();
+            server.poll();
+            server.send_and_recv();
+        }
+    };
+
+    // the connect completes in the background, the first round trip also waits for the accept
+    round_trip(0);
+
+    if (reporter.wants("round_trip_64b")) {
+        auto result = run("round_trip_64b", iterations_or(options, 100'000), round_trip);
+        result.note_ = "client and server on one thread, includes Logger calls on every read and send";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("client_rx_kernel_to_user"))
+        reporter.report(histogram_result("client_rx_kernel_to_user", client.timestamps_.rx_latency_,
+            "SO_TIMESTAMPING software rx timestamp to recvmsg() return, whole run, non monotonic:" + std::to_string(client.timestamps_.rx_non_monotonic_)));
+
+    if (reporter.wants("client_tx_user_to_kernel"))
+        reporter.report(histogram_result("client_tx_user_to_kernel", client.timestamps_.tx_latency_,
+            "send() call to SO_TIMESTAMPING software tx timestamp, whole run, unmatched:" + std::to_string(client.timestamps_.tx_unmatched_) +
+            " non monotonic:" + std::to_string(client.timestamps_.tx_non_monotonic_)));
+
+    close(client.socket_fd_);
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include <sys/wait.h>
+
+#include "bench/bench_utils.h"
+
+#include "exchange/simulator/exchange_simulator.h"
+#include "trading/market_data/market_data_consumer.h"
+#include "trading/market_data/market_order_book.h"
+#include "trading/order_gw/order_gateway.h"
+
+// End to end tick-to-trade against the exchange simulator in a forked process. The trading side is the real stack on
+// one thread: MarketDataConsumer -> MarketOrderBook -> a strategy that answers every trigger TRADE with an aggressive
+// order through the OrderGateway. Each scenario reports the exchange's view (trigger sent -> order received) from the
+// simulator process, and the client's breakdown: trigger sent -> strategy sees it, strategy sees it -> order handed to
+// the kernel, and order sent -> ACCEPTED back. Steady and bursty scenarios publish the same average message rate.
+
+using namespace Bench;
+
+namespace {
+    constexpr Common::ClientId CLIENT_ID = 1;
+    constexpr std::size_t NUM_INSTRUMENTS = 4;
+    constexpr std::size_t SENT_TIMES_SIZE = 64 * 1024;
+
+    struct Scenario {
+        std::string name_;
+        std::size_t burst_size_;
+        int order_port_;
+    };
+
+    auto histogram_result(const std::string& name, const Common::LatencyHistogram& histogram, const std::string& note) {
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = histogram.count();
+        result.ns_per_op_ = histogram.mean();
+        result.latency_ = histogram;
+        result.note_ = note;
+        return result;
+    }
+
+    auto scenario_note(const Exchange::SimulatorConfig& config) {
+        std::stringstream ss;
+        ss << config.num_instruments_ << " instruments, " << config.message_rate_ << " updates/s in bursts of " << config.burst_size_
+           << ", trigger every " << config.trigger_every_ << " updates";
+        if (!single_cpu_note().empty())
+            ss << ", " << single_cpu_note();
+        return ss.str();
+    }
+
+    // simulator process, signals ready_fd once it listens and reports its side when every trigger was handled
+    auto run_simulator(const BenchOptions& options, const Exchange::SimulatorConfig& config, const std::string& name, int ready_fd) {
+        Exchange::ExchangeSimulator simulator(config);
+        const char ready = 1;
+        ASSERT(write(ready_fd, &ready, 1) == 1, "Failed to signal simulator start.");
+        // poll() instead of run() so an idle iteration can give the core to the client when they share one
+        while (!simulator.done()) {
+            simulator.poll();
+            spin_wait();
+        }
+
+        const auto& stats = simulator.get_stats();
+        BenchReporter reporter("tick_to_trade", options);
+        reporter.report(histogram_result(name + "_exchange", stats.tick_to_trade_,
+            scenario_note(config) + ", trigger send to order kernel rx, answered " + std::to_string(stats.triggers_answered_) +
+            "/" + std::to_string(stats.triggers_sent_) + ", " + std::to_string(stats.updates_sent_) + " updates in " +
+            std::to_string(stats.datagrams_sent_) + " datagrams"));
+    }
+
+    auto run_scenario(const BenchOptions& options, BenchReporter& reporter, const Scenario& scenario) {
+        Exchange::SimulatorConfig config;
+        config.iface_ = options.iface_;
+        config.order_port_ = scenario.order_port_;
+        config.num_instruments_ = NUM_INSTRUMENTS;
+        config.message_rate_ = 20'000;
+        config.burst_size_ = scenario.burst_size_;
+        config.trigger_every_ = 20;
+        config.num_triggers_ = iterations_or(options, 2'000);
+
+        // join the market data groups before the simulator can publish anything
+        Exchange::MEMarketUpdateLFQueue market_updates(Common::ME_MAX_MARKET_UPDATES);
+        Exchange::ClientResponseLFQueue responses(Common::ME_MAX_CLIENT_UPDATES);
+        Trading::MarketDataConsumer consumer(CLIENT_ID, &market_updates, config.iface_, config.snapshot_ip_, config.snapshot_port_,
+                                             config.incremental_ip_, config.incremental_port_);
+        std::vector<std::unique_ptr<Trading::MarketOrderBook>> books;
+        for (std::size_t ticker_id = 0; ticker_id < NUM_INSTRUMENTS; ++ticker_id)
+            books.push_back(std::make_unique<Trading::MarketOrderBook>(static_cast<Common::TickerId>(ticker_id)));
+
+        int ready_pipe[2];
+        ASSERT(pipe(ready_pipe) == 0, "pipe() failed. errno: " + std::string{strerror(errno)});
+        const auto pid = fork();
+        ASSERT(pid >= 0, "fork() failed. errno: " + std::string{strerror(errno)});
+        if (!pid) {
+            close(ready_pipe[0]);
+            pin_current_thread(options.peer_core_);
+            run_simulator(options, config, scenario.name_, ready_pipe[1]);
+            _exit(EXIT_SUCCESS);
+        }
+        close(ready_pipe[1]);
+        char ready = 0;
+        ASSERT(read(ready_pipe[0], &ready, 1) == 1, "Simulator process failed to start.");
+        close(ready_pipe[0]);
+
+        Trading::OrderGateway gateway(CLIENT_ID, &responses, "", config.iface_, config.order_port_);
+        gateway.connect();
+
+        Common::LatencyHistogram md_to_strategy, strategy_to_order, order_ack;
+        std::vector<Common::Nanos> sent_times(SENT_TIMES_SIZE, 0);
+        std::size_t triggers_seen = 0, fills = 0;
+        auto last_activity = Common::getCurrentNanos();
+
+        while (fills < config.num_triggers_) {
+            consumer.poll();
+            bool idle = true;
+
+            for (auto update = market_updates.get_next_read(); update; update = market_updates.get_next_read()) {
+                if (update->ticker_id_ < books.size())
+                    books[update->ticker_id_]->on_market_update(update);
+
+                // trigger: answer with an order that takes the side of the trade at its price, so it fills right away
+                if (update->type_ == Exchange::MarketUpdateType::TRADE && update->order_id_ != Common::OrderId_INVALID) {
+                    const auto seen = Common::getCurrentNanos();
+                    gateway.send_new_order(update->ticker_id_, update->side_, update->price_, 1, update->order_id_);
+                    const auto sent = Common::getCurrentNanos();
+                    md_to_strategy.record(seen - static_cast<Common::Nanos>(update->priority_));
+                    strategy_to_order.record(sent - seen);
+                    sent_times[update->order_id_ & (SENT_TIMES_SIZE - 1)] = sent;
+                    ++triggers_seen;
+                }
+                market_updates.update_read_index();
+                idle = false;
+            }
+
+            for (auto response = responses.get_next_read(); response; response = responses.get_next_read()) {
+                if (response->type_ == Exchange::ClientResponseType::ACCEPTED)
+                    order_ack.record(Common::getCurrentNanos() - sent_times[response->client_order_id_ & (SENT_TIMES_SIZE - 1)]);
+                else if (response->type_ == Exchange::ClientResponseType::FILLED)
+                    ++fills;
+                responses.update_read_index();
+                last_activity = Common::getCurrentNanos();
+                idle = false;
+            }
+
+            const auto now = Common::getCurrentNanos();
+            gateway.poll(now);
+
+            // triggers lost to drops are recovered through the snapshot but never answered, give up once it goes quiet
+            if (now - last_activity > 5'000'000'000LL)
+                break;
+            if (idle)
+                spin_wait();
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "Simulator process failed.");
+
+        if (!triggers_seen) {
+            reporter.skip(scenario.name_ + "_client", "no market data delivered on iface " + options.iface_ + ", pass a multicast capable --iface");
+            return;
+        }
+
+        const auto note = scenario_note(config) + ", triggers seen " + std::to_string(triggers_seen) + "/" + std::to_string(config.num_triggers_) +
+                          ", recoveries " + std::to_string(consumer.get_recovery_stats().num_recoveries_);
+        reporter.report(histogram_result(scenario.name_ + "_md_to_strategy", md_to_strategy, note + ", trigger send to strategy dequeue"));
+        reporter.report(histogram_result(scenario.name_ + "_strategy_to_order", strategy_to_order, note + ", strategy dequeue to order flushed"));
+        reporter.report(histogram_result(scenario.name_ + "_order_ack", order_ack, note + ", order flushed to ACCEPTED dequeued"));
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("tick_to_trade", options);
+    pin_current_thread(options.core_);
+
+    for (const auto& scenario : {Scenario{"steady", 1, 12346}, Scenario{"burst_64", 64, 12347}}) {
+        if (reporter.wants(scenario.name_))
+            run_scenario(options, reporter, scenario);
+    }
+
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include <ctime>
+
+#include "bench/bench_utils.h"
+
+#include "common/time_utils.h"
+
+// The time helpers every log line and timestamp goes through, with the raw clocks they are built on for reference.
+
+using namespace Bench;
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("time_utils", options);
+    pin_current_thread(options.core_);
+
+    const auto ops = iterations_or(options, 10'000'000);
+
+    if (reporter.wants("get_current_nanos"))
+        reporter.report(run("get_current_nanos", ops, [](std::size_t) { do_not_optimize(Common::getCurrentNanos()); }));
+
+    if (reporter.wants("get_current_time_str")) {
+        std::string time_str;
+        auto result = run("get_current_time_str", iterations_or(options, 1'000'000), [&](std::size_t) {
+            do_not_optimize(Common::get_current_time_str(time_str).size());
+        });
+        result.note_ = "string length after the run:" + std::to_string(time_str.size());
+        reporter.report(result);
+    }
+
+    if (reporter.wants("clock_gettime_monotonic")) {
+        reporter.report(run("clock_gettime_monotonic", ops, [](std::size_t) {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            do_not_optimize(ts.tv_nsec);
+        }));
+    }
+
+    if (reporter.wants("rdtsc"))
+        reporter.report(run("rdtsc", ops, [](std::size_t) { do_not_optimize(TscClock::now()); }));
+
+    return 0;
+}
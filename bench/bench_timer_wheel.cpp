@@ -0,0 +1,148 @@
+#include <random>
+
+#include "bench/bench_utils.h"
+
+#include "common/timer_wheel.h"
+
+// TimerWheel with 100k live timers on a 1us tick and a virtual clock: schedule, cancel, the steady state of canceling
+// one timer and scheduling another (an order time-out replaced on every amend), and advance() with every timer a
+// heartbeat that reschedules itself on expiry. Throttle with bursts of orders at twice its burst size.
+
+using namespace Bench;
+
+namespace {
+    constexpr std::size_t LIVE_TIMERS = 100'000;
+    constexpr Common::Nanos TICK = 1'000;
+
+    using Wheel = Common::TimerWheel<uint32_t>;
+
+    // deadlines from 1ms to 10s out, across every level but the last
+    auto random_delays(std::size_t n, std::mt19937_64& rng) {
+        std::vector<Common::Nanos> delays(n);
+        for (auto& delay : delays)
+            delay = 1'000'000 + static_cast<Common::Nanos>(rng() % 10'000'000'000ULL);
+        return delays;
+    }
+
+    auto make_wheel(std::size_t capacity, const std::vector<Common::Nanos>& delays, std::vector<Wheel::Timer>* timers = nullptr) {
+        auto wheel = std::make_unique<Wheel>(capacity, TICK, 0);
+        for (std::size_t i = 0; i < LIVE_TIMERS; ++i) {
+            const auto timer = wheel->schedule(delays[i], static_cast<uint32_t>(i));
+            if (timers)
+                timers->push_back(timer);
+        }
+        return wheel;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("timer_wheel", options);
+    pin_current_thread(options.core_);
+
+    std::mt19937_64 rng(42);
+    const auto note = std::to_string(LIVE_TIMERS) + " live timers, 1us tick, deadlines 1ms to 10s out";
+
+    if (reporter.wants("schedule")) {
+        const auto ops = iterations_or(options, LIVE_TIMERS);
+        const auto delays = random_delays(LIVE_TIMERS + ops, rng);
+        std::unique_ptr<Wheel> wheel;
+        auto result = run("schedule", ops, [&] { wheel = make_wheel(LIVE_TIMERS + ops, delays); }, [&](std::size_t i) {
+            do_not_optimize(wheel->schedule(delays[LIVE_TIMERS + i], static_cast<uint32_t>(i)));
+        });
+        result.note_ = note;
+        reporter.report(result);
+    }
+
+    if (reporter.wants("cancel")) {
+        const auto ops = std::min(iterations_or(options, LIVE_TIMERS), LIVE_TIMERS);
+        const auto delays = random_delays(LIVE_TIMERS, rng);
+        std::unique_ptr<Wheel> wheel;
+        std::vector<Wheel::Timer> timers;
+        auto result = run("cancel", ops, [&] {
+            timers.clear();
+            wheel = make_wheel(LIVE_TIMERS, delays, &timers);
+            std::shuffle(timers.begin(), timers.end(), rng);
+        }, [&](std::size_t i) {
+            do_not_optimize(wheel->cancel(timers[i]));
+        });
+        result.note_ = note + ", random order, the wheel drains as it goes";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("cancel_schedule")) {
+        const auto ops = iterations_or(options, 1'000'000);
+        const auto delays = random_delays(LIVE_TIMERS + ops, rng);
+        std::vector<std::size_t> victims(ops);
+        for (auto& victim : victims)
+            victim = rng() % LIVE_TIMERS;
+
+        std::unique_ptr<Wheel> wheel;
+        std::vector<Wheel::Timer> timers;
+        auto result = run("cancel_schedule", ops, [&] {
+            timers.clear();
+            wheel = make_wheel(LIVE_TIMERS, delays, &timers);
+        }, [&](std::size_t i) {
+            auto& timer = timers[victims[i]];
+            wheel->cancel(timer);
+            timer = wheel->schedule(delays[LIVE_TIMERS + i], static_cast<uint32_t>(victims[i]));
+        });
+        result.note_ = note + ", one cancel + one schedule per op, stays at " + std::to_string(LIVE_TIMERS) + " live";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("advance_heartbeats")) {
+        // every timer is a heartbeat with its own period that reschedules itself, the clock moves one tick per op
+        const auto ops = iterations_or(options, 1'000'000);
+        std::vector<Common::Nanos> periods(LIVE_TIMERS);
+        for (auto& period : periods)
+            period = 1'000'000 + static_cast<Common::Nanos>(rng() % 99'000'000);
+
+        std::unique_ptr<Wheel> wheel;
+        std::size_t expired = 0;
+        Common::Nanos now = 0;
+        auto result = run("advance_heartbeats", ops, [&] {
+            wheel = std::make_unique<Wheel>(LIVE_TIMERS, TICK, 0);
+            for (std::size_t i = 0; i < LIVE_TIMERS; ++i)
+                wheel->schedule(periods[i], static_cast<uint32_t>(i));
+            expired = 0;
+        }, [&](std::size_t i) {
+            now = static_cast<Common::Nanos>(i + 1) * TICK;
+            expired += wheel->advance(now, [&](uint32_t heartbeat) {
+                wheel->schedule(now + periods[heartbeat], heartbeat);
+            });
+        });
+
+        std::stringstream ss;
+        ss << LIVE_TIMERS << " live heartbeats with periods 1ms to 100ms, one tick per advance(), " << expired << " expired and rescheduled, "
+           << result.ns_per_op_ * static_cast<double>(ops) / static_cast<double>(expired) << " ns per expiry";
+        result.note_ = ss.str();
+        reporter.report(result);
+    }
+
+    if (reporter.wants("throttle_submit")) {
+        // 1 order per us with a burst of 100, bursts of 200 orders 10ns apart every 400us, so half of each is deferred
+        constexpr std::size_t burst = 200;
+        const auto ops = iterations_or(options, 1'000'000);
+        std::unique_ptr<Common::Throttle<uint32_t>> throttle;
+        std::array<std::size_t, 3> results{};
+        std::size_t released = 0;
+        auto result = run("throttle_submit", ops, [&] {
+            throttle = std::make_unique<Common::Throttle<uint32_t>>(1'000, 100, LIVE_TIMERS, TICK, 0);
+            results.fill(0);
+            released = 0;
+        }, [&](std::size_t i) {
+            const auto now = static_cast<Common::Nanos>(i / burst) * 400'000 + static_cast<Common::Nanos>(i % burst) * 10;
+            released += throttle->poll(now, [](uint32_t) {});
+            ++results[static_cast<std::size_t>(throttle->submit(now, static_cast<uint32_t>(i)))];
+        });
+
+        std::stringstream ss;
+        ss << "submit + poll per op, bursts of " << burst << " against 1/us with burst 100: " << results[0] << " sent, " << results[1]
+           << " deferred, " << results[2] << " rejected, " << released << " released by poll";
+        result.note_ = ss.str();
+        reporter.report(result);
+    }
+
+    return 0;
+}
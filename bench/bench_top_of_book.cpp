@@ -0,0 +1,118 @@
+#include <random>
+
+#include "bench/bench_utils.h"
+
+#include "trading/market_data/top_of_book_broadcast.h"
+
+// TopOfBookBroadcast over 1024 instruments: writer cost per publish and reader cost per read without contention, then
+// the writer publishing to random instruments while 1, 2, 4, 8 and 16 reader threads follow their changed bitmaps.
+// For each reader count the writer's publish latency and the readers' staleness (time between a value being
+// published and a reader copying it) are reported, along with the share of publishes conflated away.
+
+using namespace Bench;
+
+namespace {
+    constexpr std::size_t NUM_INSTRUMENTS = 1024;
+
+    auto make_top_of_book(std::size_t i) noexcept {
+        const auto price = static_cast<Common::Price>(1000 + (i & 63));
+        return Trading::TopOfBook{price, price + 1, 100, 200, price, 10, Common::Side::BUY, Common::getCurrentNanos()};
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("top_of_book", options);
+    pin_current_thread(options.core_);
+
+    std::mt19937_64 rng(42);
+    std::vector<Common::TickerId> tickers(1 << 20);
+    for (auto& ticker_id : tickers)
+        ticker_id = static_cast<Common::TickerId>(rng() % NUM_INSTRUMENTS);
+    const auto ticker_mask = tickers.size() - 1;
+
+    if (reporter.wants("publish_no_readers")) {
+        Trading::TopOfBookBroadcast broadcast(NUM_INSTRUMENTS);
+        auto result = run("publish_no_readers", iterations_or(options, 10'000'000), [&](std::size_t i) {
+            broadcast.publish(tickers[i & ticker_mask], make_top_of_book(i));
+        });
+        result.note_ = "includes a clock_gettime for update_time_";
+        reporter.report(result);
+    }
+
+    if (reporter.wants("read_uncontended")) {
+        Trading::TopOfBookBroadcast broadcast(NUM_INSTRUMENTS);
+        for (std::size_t i = 0; i < NUM_INSTRUMENTS; ++i)
+            broadcast.publish(static_cast<Common::TickerId>(i), make_top_of_book(i));
+        auto result = run("read_uncontended", iterations_or(options, 10'000'000), [&](std::size_t i) {
+            const auto top_of_book = broadcast.read(tickers[i & ticker_mask]);
+            do_not_optimize(top_of_book);
+        });
+        reporter.report(result);
+    }
+
+    for (std::size_t num_readers : {1, 2, 4, 8, 16}) {
+        const auto name = "publish_" + std::to_string(num_readers) + "_readers";
+        if (!reporter.wants(name))
+            continue;
+
+        Trading::TopOfBookBroadcast broadcast(NUM_INSTRUMENTS, num_readers);
+        std::atomic<bool> stop {false};
+        std::atomic<std::size_t> ready {0};
+        std::vector<Common::LatencyHistogram> staleness(num_readers);
+        std::vector<std::size_t> seen(num_readers, 0);
+        std::vector<std::thread> readers;
+
+        for (std::size_t r = 0; r < num_readers; ++r) {
+            readers.emplace_back([&, r]() {
+                if (options.peer_core_ >= 0)
+                    pin_current_thread(options.peer_core_ + static_cast<int>(r));
+                const auto reader_id = broadcast.add_reader();
+                ready.fetch_add(1);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const auto num_changed = broadcast.for_each_changed(reader_id, [&](Common::TickerId ticker_id) {
+                        const auto top_of_book = broadcast.read(ticker_id);
+                        staleness[r].record(Common::getCurrentNanos() - top_of_book.update_time_);
+                    });
+                    seen[r] += num_changed;
+                    if (!num_changed)
+                        spin_wait();
+                }
+            });
+        }
+        while (ready.load() != num_readers)
+            spin_wait();
+
+        const auto ops = iterations_or(options, 1'000'000);
+        auto result = run(name, ops, [&](std::size_t i) {
+            broadcast.publish(tickers[i & ticker_mask], make_top_of_book(i));
+        });
+        stop = true;
+        for (auto& reader : readers)
+            reader.join();
+
+        BenchResult stale;
+        stale.name_ = "staleness_" + std::to_string(num_readers) + "_readers";
+        std::size_t total_seen = 0;
+        for (std::size_t r = 0; r < num_readers; ++r) {
+            stale.latency_.merge(staleness[r]);
+            total_seen += seen[r];
+        }
+        stale.ops_ = total_seen;
+
+        // both of run()'s passes publish, each reader had 2 * ops chances to see an update
+        const auto conflated = 100.0 - 100.0 * static_cast<double>(total_seen) / static_cast<double>(2 * ops * num_readers);
+        std::stringstream note;
+        note << NUM_INSTRUMENTS << " instruments, " << num_readers << " readers";
+        if (!single_cpu_note().empty())
+            note << ", " << single_cpu_note();
+        result.note_ = note.str();
+        note << ", " << conflated << "% of publishes conflated, latency is publish to reader copy";
+        stale.note_ = note.str();
+
+        reporter.report(result);
+        reporter.report(stale);
+    }
+
+    return 0;
+}
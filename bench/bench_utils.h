@@ -0,0 +1,423 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "common/macros.h"
+#include "common/thread_utils.h"
+#include "common/time_utils.h"
+#include "common/latency_histogram.h"
+
+// Shared harness for the benchmarks in bench/. Every benchmark run produces one BenchResult: per operation latency
+// percentiles from a timed pass, and throughput plus hardware counters per operation from a second, untimed pass.
+// Results are appended as one JSON object per line so runs of different releases can be diffed or loaded by a script.
+
+namespace Bench {
+
+    // cheap timestamps for per operation latencies, the TSC is converted to ns with a ratio calibrated at startup
+    class TscClock final {
+    public:
+        static auto now() noexcept -> uint64_t {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+        }
+
+        static auto instance() -> const TscClock& {
+            static const TscClock clock;
+            return clock;
+        }
+
+        auto to_nanos(uint64_t ticks) const noexcept { return static_cast<Common::Nanos>(ticks * nanos_per_tick_); }
+
+        // cost of two back to back now() calls, subtracted from every timed operation
+        auto overhead_ticks() const noexcept { return overhead_ticks_; }
+
+        auto nanos_per_tick() const noexcept { return nanos_per_tick_; }
+
+    private:
+        double nanos_per_tick_ = 1.0;
+        uint64_t overhead_ticks_ = 0;
+
+        TscClock() {
+            const auto steady_start = std::chrono::steady_clock::now();
+            const auto tsc_start = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            const auto tsc_end = now();
+            const auto steady_end = std::chrono::steady_clock::now();
+            nanos_per_tick_ = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(steady_end - steady_start).count()) /
+                              static_cast<double>(tsc_end - tsc_start);
+
+            overhead_ticks_ = UINT64_MAX;
+            for (int i = 0; i < 10000; ++i) {
+                const auto t0 = now();
+                const auto t1 = now();
+                overhead_ticks_ = std::min(overhead_ticks_, t1 - t0);
+            }
+        }
+    };
+
+    enum class PerfCounter : uint8_t {
+        CYCLES = 0,
+        INSTRUCTIONS = 1,
+        L1D_MISSES = 2,
+        LLC_MISSES = 3,
+        BRANCH_MISSES = 4
+    };
+
+    constexpr std::size_t NUM_PERF_COUNTERS = 5;
+
+    inline const char* perf_counter_to_string(PerfCounter counter) {
+        switch (counter) {
+            case PerfCounter::CYCLES:
+                return "cycles";
+            case PerfCounter::INSTRUCTIONS:
+                return "instructions";
+            case PerfCounter::L1D_MISSES:
+                return "l1d_misses";
+            case PerfCounter::LLC_MISSES:
+                return "llc_misses";
+            case PerfCounter::BRANCH_MISSES:
+                return "branch_misses";
+        }
+        return "unknown";
+    }
+
+    // Hardware counters for the calling thread through perf_event_open(). Counters the kernel or the (virtual) machine
+    // does not offer are simply reported as unavailable. Kernel mode is counted when perf_event_paranoid allows it,
+    // which matters for the socket benchmarks, otherwise only user mode. That is decided per counter, a PMU can grant
+    // kernel mode for some events and not others.
+    class PerfCounters final {
+    public:
+        PerfCounters() {
+            static constexpr std::array<std::pair<uint32_t, uint64_t>, NUM_PERF_COUNTERS> events = {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            }};
+
+            for (std::size_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+                fds_[i] = open_counter(events[i].first, events[i].second, false);
+                if (fds_[i] < 0 && (errno == EACCES || errno == EPERM))
+                    fds_[i] = open_counter(events[i].first, events[i].second, true);
+                else if (fds_[i] >= 0)
+                    includes_kernel_[i] = true;
+            }
+        }
+
+        ~PerfCounters() {
+            for (auto fd : fds_)
+                if (fd >= 0)
+                    close(fd);
+        }
+
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters(const PerfCounters&&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&&) = delete;
+
+        auto start() noexcept {
+            for (auto fd : fds_) {
+                if (fd >= 0) {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+        }
+
+        auto stop() noexcept {
+            for (auto fd : fds_)
+                if (fd >= 0)
+                    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+
+        // counter value since start(), scaled up if the PMU had to multiplex it, -1 if unavailable
+        auto read(PerfCounter counter) const noexcept -> int64_t {
+            const auto fd = fds_[static_cast<std::size_t>(counter)];
+            uint64_t values[3] = {};
+            if (fd < 0 || ::read(fd, values, sizeof(values)) != sizeof(values) || !values[2])
+                return -1;
+            return static_cast<int64_t>(static_cast<double>(values[0]) * values[1] / values[2]);
+        }
+
+        auto available() const noexcept {
+            for (auto fd : fds_)
+                if (fd >= 0)
+                    return true;
+            return false;
+        }
+
+        auto includes_kernel(PerfCounter counter) const noexcept { return includes_kernel_[static_cast<std::size_t>(counter)]; }
+
+    private:
+        std::array<int, NUM_PERF_COUNTERS> fds_{};
+        std::array<bool, NUM_PERF_COUNTERS> includes_kernel_{};
+
+        static auto open_counter(uint32_t type, uint64_t config, bool exclude_kernel) noexcept -> int {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = exclude_kernel;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    };
+
+    struct BenchOptions {
+        int core_ = 0;              // main benchmark thread
+        int peer_core_ = 1;         // second thread / process in the cross thread benchmarks
+        std::size_t iterations_ = 0; // 0 keeps each benchmark's own default
+        std::string out_ = "bench_results.jsonl";
+        std::string iface_ = "lo";
+        std::string dir_ = "/tmp";
+        std::string filter_;        // only run benchmarks whose name contains this
+    };
+
+    inline auto print_usage(const char* prog) {
+        std::cerr << "usage: " << prog << " [--core N] [--peer-core N] [--iterations N] [--out FILE|-] [--iface IFACE] [--dir DIR] [--filter NAME]\n";
+    }
+
+    inline auto parse_args(int argc, char** argv) {
+        BenchOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h" || i + 1 == argc) {
+                print_usage(argv[0]);
+                exit(arg == "--help" || arg == "-h" ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            const std::string value = argv[++i];
+            if (arg == "--core")
+                options.core_ = std::stoi(value);
+            else if (arg == "--peer-core")
+                options.peer_core_ = std::stoi(value);
+            else if (arg == "--iterations")
+                options.iterations_ = std::stoull(value);
+            else if (arg == "--out")
+                options.out_ = value;
+            else if (arg == "--iface")
+                options.iface_ = value;
+            else if (arg == "--dir")
+                options.dir_ = value;
+            else if (arg == "--filter")
+                options.filter_ = value;
+            else {
+                print_usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        return options;
+    }
+
+    inline auto iterations_or(const BenchOptions& options, std::size_t default_iterations) noexcept {
+        return options.iterations_ ? options.iterations_ : default_iterations;
+    }
+
+    // cores that do not exist on this machine run unpinned (-1) instead of failing the thread start
+    inline auto usable_core(int core) noexcept {
+        return (core >= 0 && core < static_cast<int>(std::thread::hardware_concurrency())) ? core : -1;
+    }
+
+    inline auto pin_current_thread(int core) {
+        core = usable_core(core);
+        if (core >= 0 && !Common::set_thread_core(core))
+            std::cerr << "failed to pin benchmark thread to core " << core << '\n';
+        return core;
+    }
+
+    struct BenchResult {
+        std::string name_;
+        std::size_t ops_ = 0;
+        double ns_per_op_ = 0;   // from the untimed pass, total time / ops
+        Common::LatencyHistogram latency_;
+        std::array<double, NUM_PERF_COUNTERS> counters_per_op_{-1, -1, -1, -1, -1};
+        std::array<bool, NUM_PERF_COUNTERS> counters_include_kernel_{};
+        std::string note_;       // anything a reader needs to interpret the numbers, or why the benchmark was skipped
+        bool skipped_ = false;
+    };
+
+    inline auto json_escape(const std::string& s) {
+        std::string out;
+        for (auto c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20)
+                out += c;
+        }
+        return out;
+    }
+
+    // collects results, writes one JSON line per result and a human readable line to stderr
+    class BenchReporter final {
+    public:
+        BenchReporter(const std::string& suite, const BenchOptions& options) : suite_{suite}, options_{options} {
+            if (options.out_ != "-") {
+                file_.open(options.out_, std::ios::app);
+                ASSERT(file_.is_open(), "Could not open benchmark output: " + options.out_);
+            }
+            utsname uts{};
+            uname(&uts);
+            host_ = uts.nodename;
+            kernel_ = uts.release;
+        }
+
+        auto wants(const std::string& name) const noexcept {
+            return options_.filter_.empty() || name.find(options_.filter_) != std::string::npos;
+        }
+
+        auto report(const BenchResult& result) {
+            std::stringstream ss;
+            ss << "{\"suite\":\"" << suite_ << "\",\"name\":\"" << json_escape(result.name_) << "\""
+               << ",\"time\":" << Common::getCurrentNanos()
+               << ",\"host\":\"" << json_escape(host_) << "\",\"kernel\":\"" << json_escape(kernel_) << "\""
+               << ",\"core\":" << usable_core(options_.core_) << ",\"peer_core\":" << usable_core(options_.peer_core_)
+               << ",\"skipped\":" << (result.skipped_ ? "true" : "false")
+               << ",\"ops\":" << result.ops_
+               << ",\"ns_per_op\":" << result.ns_per_op_
+               << ",\"latency_ns\":{\"count\":" << result.latency_.count() << ",\"min\":" << result.latency_.min()
+               << ",\"mean\":" << result.latency_.mean() << ",\"p50\":" << result.latency_.percentile(50)
+               << ",\"p90\":" << result.latency_.percentile(90) << ",\"p99\":" << result.latency_.percentile(99)
+               << ",\"p99.9\":" << result.latency_.percentile(99.9) << ",\"max\":" << result.latency_.max() << "}"
+               << ",\"per_op\":{";
+            for (std::size_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+                ss << (i ? "," : "") << "\"" << perf_counter_to_string(static_cast<PerfCounter>(i)) << "\":";
+                if (result.counters_per_op_[i] >= 0)
+                    ss << result.counters_per_op_[i];
+                else
+                    ss << "null";
+            }
+            ss << "},\"counters_include_kernel\":{";
+            for (std::size_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+                ss << (i ? "," : "") << "\"" << perf_counter_to_string(static_cast<PerfCounter>(i)) << "\":";
+                if (result.counters_per_op_[i] >= 0)
+                    ss << (result.counters_include_kernel_[i] ? "true" : "false");
+                else
+                    ss << "null";
+            }
+            ss << "},\"note\":\"" << json_escape(result.note_) << "\"}\n";
+
+            if (file_.is_open())
+                file_ << ss.str() << std::flush;
+            else
+                std::cout << ss.str() << std::flush;
+
+            std::cerr << suite_ << '/' << result.name_;
+            if (result.skipped_) {
+                std::cerr << " skipped: " << result.note_ << '\n';
+                return;
+            }
+            std::cerr << " ops:" << result.ops_ << " ns/op:" << result.ns_per_op_;
+            if (result.latency_.count())
+                std::cerr << " latency[" << result.latency_.to_string() << ']';
+            if (result.counters_per_op_[0] >= 0)
+                std::cerr << " cycles/op:" << result.counters_per_op_[0] << " ipc:"
+                          << (result.counters_per_op_[0] > 0 ? result.counters_per_op_[1] / result.counters_per_op_[0] : 0.0);
+            if (!result.note_.empty())
+                std::cerr << " (" << result.note_ << ')';
+            std::cerr << '\n';
+        }
+
+        auto skip(const std::string& name, const std::string& why) {
+            BenchResult result;
+            result.name_ = name;
+            result.skipped_ = true;
+            result.note_ = why;
+            report(result);
+        }
+
+    private:
+        const std::string suite_;
+        const BenchOptions& options_;
+        std::ofstream file_;
+        std::string host_;
+        std::string kernel_;
+    };
+
+    // Two passes over op(i) for i in [0, ops): one timing every call into the latency histogram, one running
+    // back to back under the hardware counters for throughput and counters per op. setup() runs before each pass.
+    template<typename Setup, typename Op>
+    inline auto run(const std::string& name, std::size_t ops, Setup&& setup, Op&& op) {
+        const auto& clock = TscClock::instance();
+        BenchResult result;
+        result.name_ = name;
+        result.ops_ = ops;
+
+        setup();
+        for (std::size_t i = 0; i < ops; ++i) {
+            const auto t0 = TscClock::now();
+            op(i);
+            const auto t1 = TscClock::now();
+            const auto ticks = t1 - t0;
+            result.latency_.record(clock.to_nanos(ticks > clock.overhead_ticks() ? ticks - clock.overhead_ticks() : 0));
+        }
+
+        setup();
+        PerfCounters counters;
+        const auto start = std::chrono::steady_clock::now();
+        counters.start();
+        for (std::size_t i = 0; i < ops; ++i)
+            op(i);
+        counters.stop();
+        const auto end = std::chrono::steady_clock::now();
+
+        result.ns_per_op_ = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / static_cast<double>(ops);
+        for (std::size_t i = 0; i < NUM_PERF_COUNTERS; ++i) {
+            const auto value = counters.read(static_cast<PerfCounter>(i));
+            result.counters_per_op_[i] = value >= 0 ? static_cast<double>(value) / static_cast<double>(ops) : -1;
+            result.counters_include_kernel_[i] = counters.includes_kernel(static_cast<PerfCounter>(i));
+        }
+        if (!counters.available())
+            result.note_ = "perf_event_open unavailable";
+        return result;
+    }
+
+    template<typename Op>
+    inline auto run(const std::string& name, std::size_t ops, Op&& op) {
+        return run(name, ops, [] {}, std::forward<Op>(op));
+    }
+
+    // busy wait step for the cross thread / process benchmarks, on a single cpu the peer can only make progress if we
+    // give the cpu up, so the numbers there measure the scheduler more than the primitive
+    inline auto spin_wait() noexcept {
+        static const bool single_cpu = std::thread::hardware_concurrency() < 2;
+        if (single_cpu) {
+            sched_yield();
+            return;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    inline auto single_cpu_note() -> std::string {
+        return std::thread::hardware_concurrency() < 2 ? "single cpu, peer shares the core and waits yield" : "";
+    }
+
+    // keeps the compiler from optimising away a value nobody reads
+    template<typename T>
+    inline auto do_not_optimize(const T& value) noexcept {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+}
@@ -0,0 +1,137 @@
+#include "bench/bench_utils.h"
+
+#include "common/mcast_socket.h"
+
+// McastSocket receive through the kernel UDP stack against the same socket with the AF_XDP path enabled, publisher
+// and subscriber on one thread through IP_MULTICAST_LOOP. _rtt: one 64 byte datagram published and polled for until
+// it is read, per op. _burst: datagrams read per second while bursts of 64 are published back to back, loss shows up
+// in the notes. The XDP runs are skipped when the program cannot be attached (no CAP_NET_ADMIN / CAP_BPF, no AF_XDP),
+// and their notes say how many datagrams actually came through the XDP ring: on lo the looped back multicast copy is
+// passed to the stack by the program (no Ethernet header in generic mode), so a real NIC or a veth pair is needed to
+// see the bypass numbers.
+
+using namespace Bench;
+
+namespace {
+    const std::string GROUP = "239.0.0.28";
+    constexpr int PORT = 20028;
+    constexpr std::size_t MSG_SIZE = 64;
+    constexpr std::size_t BURST = 64;
+
+    struct Subscriber {
+        Common::McastSocket socket_;
+        std::size_t received_ = 0;
+        std::size_t via_xdp_ = 0;
+        bool xdp_ = false;
+
+        Subscriber(Common::Logger& logger, const BenchOptions& options, bool xdp) : socket_{logger} {
+            ASSERT(socket_.init(GROUP, options.iface_, PORT, true) >= 0, "Unable to create subscriber socket on " + options.iface_);
+            ASSERT(socket_.join(GROUP), "Join failed on " + options.iface_ + " error: " + std::string{strerror(errno)});
+            xdp_ = xdp && socket_.enable_xdp(GROUP, options.iface_, PORT);
+            socket_.recv_callback_ = [this](Common::McastSocket* socket) {
+                received_ += socket->next_rcv_valid_index_ / MSG_SIZE;
+                via_xdp_ += socket->rcv_data_ != socket->inbound_data_.data();
+                socket->next_rcv_valid_index_ = 0;
+            };
+        }
+
+        ~Subscriber() {
+            socket_.leave(GROUP, PORT);
+        }
+
+        auto xdp_note() const {
+            if (!xdp_)
+                return std::string{"kernel UDP socket"};
+            return std::string{"AF_XDP "} + (socket_.xdp_socket_->is_zero_copy() ? "zero copy" : "copy") +
+                   (socket_.xdp_socket_->is_driver_mode() ? " driver mode" : " generic mode") + ", " + std::to_string(via_xdp_) +
+                   " datagrams through the XDP ring, the rest through the socket";
+        }
+    };
+
+    auto measure(BenchReporter& reporter, const BenchOptions& options, Common::Logger& logger, Common::McastSocket& publisher, bool xdp) {
+        const std::string prefix = xdp ? "xdp" : "socket";
+        const auto rtt_name = prefix + "_rtt_64b";
+        const auto burst_name = prefix + "_burst_64b";
+        if (!reporter.wants(rtt_name) && !reporter.wants(burst_name))
+            return;
+
+        Subscriber subscriber(logger, options, xdp);
+        if (xdp && !subscriber.xdp_) {
+            for (const auto& name : {rtt_name, burst_name})
+                if (reporter.wants(name))
+                    reporter.skip(name, "AF_XDP unavailable on iface " + options.iface_ + " (needs CAP_NET_ADMIN and CAP_BPF), see the log");
+            return;
+        }
+
+        char msg[MSG_SIZE] = {};
+        auto publish = [&](std::size_t i) {
+            memcpy(msg, &i, sizeof(i));
+            publisher.send(msg, MSG_SIZE);
+            publisher.send_and_recv();
+        };
+        auto wait_for = [&](std::size_t expected, Common::Nanos timeout) {
+            const auto start = Common::getCurrentNanos();
+            while (subscriber.received_ < expected) {
+                if (!subscriber.socket_.send_and_recv() && Common::getCurrentNanos() - start > timeout)
+                    return false;
+            }
+            return true;
+        };
+
+        publish(0);
+        if (!wait_for(1, 1'000'000'000)) {
+            for (const auto& name : {rtt_name, burst_name})
+                if (reporter.wants(name))
+                    reporter.skip(name, "no multicast delivered on iface " + options.iface_ + ", pass a multicast capable --iface");
+            return;
+        }
+
+        if (reporter.wants(rtt_name)) {
+            auto result = run(rtt_name, iterations_or(options, 100'000), [&](std::size_t i) {
+                publish(i);
+                wait_for(subscriber.received_ + 1, 100'000'000);
+            });
+            result.note_ = "publish() to the subscriber's callback, one thread, " + subscriber.xdp_note();
+            reporter.report(result);
+        }
+
+        if (reporter.wants(burst_name)) {
+            const auto num_bursts = iterations_or(options, 100'000) / BURST;
+            const auto before = subscriber.received_;
+            const auto start = Common::getCurrentNanos();
+            for (std::size_t b = 0; b < num_bursts; ++b) {
+                for (std::size_t i = 0; i < BURST; ++i)
+                    publish(i);
+                while (subscriber.socket_.send_and_recv());
+            }
+            wait_for(before + num_bursts * BURST, 10'000'000);
+            const auto elapsed = Common::getCurrentNanos() - start;
+            const auto received = subscriber.received_ - before;
+
+            BenchResult result;
+            result.name_ = burst_name;
+            result.ops_ = received;
+            result.ns_per_op_ = received ? static_cast<double>(elapsed) / static_cast<double>(received) : 0;
+            std::stringstream note;
+            note << static_cast<uint64_t>(static_cast<double>(received) * 1e9 / static_cast<double>(elapsed)) << " datagrams/s read, "
+                 << num_bursts * BURST - received << " of " << num_bursts * BURST << " lost, bursts of " << BURST
+                 << ", publisher on the same thread, " << subscriber.xdp_note();
+            result.note_ = note.str();
+            reporter.report(result);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options = parse_args(argc, argv);
+    BenchReporter reporter("xdp_socket", options);
+    pin_current_thread(options.core_);
+
+    Common::Logger logger(options.dir_ + "/bench_xdp_socket.log");
+    Common::McastSocket publisher(logger);
+    ASSERT(publisher.init(GROUP, options.iface_, PORT, false) >= 0, "Unable to create publisher socket on " + options.iface_);
+
+    measure(reporter, options, logger, publisher, false);
+    measure(reporter, options, logger, publisher, true);
+    return 0;
+}
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "macros.h"
+#include "thread_utils.h"
+#include "lock_free_queue.h"
+#include "time_utils.h"
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+// Append-only event journal. The hot thread hands fixed layout records to a writer thread through a LockFreeQueue,
+// the writer stamps a sequence number and checksum and copies them into pre-allocated, memory mapped segment files.
+// Segments are <dir>/<name>.<index>.journal with consecutive indices, a record with a bad checksum (or the zero
+// filled tail of a pre-allocated segment) marks the end of valid data in that segment.
+
+namespace Common {
+
+    constexpr std::size_t JOURNAL_QUEUE_SIZE = 1024 * 1024;
+    constexpr std::size_t JOURNAL_SEGMENT_SIZE = 256 * 1024 * 1024;
+
+    // records written between two msync() calls, 0 leaves write back to the kernel (survives a process crash but not
+    // a power loss)
+    constexpr std::size_t JOURNAL_MSYNC_BATCH = 4096;
+
+    constexpr uint64_t JOURNAL_MAGIC = 0x314c4e524a'4d54; // "TMJRNL1"
+    constexpr uint32_t JOURNAL_VERSION = 1;
+
+    // segment files start with this, records follow at JOURNAL_HEADER_SIZE
+    struct JournalSegmentHeader {
+        uint64_t magic_ = 0;
+        uint32_t version_ = 0;
+        uint32_t record_size_ = 0;
+        uint64_t segment_index_ = 0;
+        uint64_t first_seq_num_ = 0;
+    };
+
+    constexpr std::size_t JOURNAL_HEADER_SIZE = CACHE_LINE_SIZE;
+    static_assert(sizeof(JournalSegmentHeader) <= JOURNAL_HEADER_SIZE);
+
+    // CRC-32C, with the SSE4.2 instruction when the build targets it
+    inline auto crc32c(const void* data, std::size_t len, uint32_t crc = 0) noexcept -> uint32_t {
+        auto p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+#ifdef __SSE4_2__
+        for (; len >= 8; len -= 8, p += 8) {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            crc = static_cast<uint32_t>(_mm_crc32_u64(crc, v));
+        }
+        for (; len; --len, ++p)
+            crc = _mm_crc32_u8(crc, *p);
+#else
+        static constexpr auto table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        for (; len; --len, ++p)
+            crc = table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+#endif
+        return ~crc;
+    }
+
+    template<typename T>
+    struct JournalRecord {
+        uint64_t seq_num_ = 0;  // starts at 1, 0 is never written
+        Nanos time_ = 0;        // stamped by the hot thread
+        uint32_t checksum_ = 0; // crc32c of everything after this field
+        uint32_t size_ = 0;     // sizeof(T), guards against replaying with the wrong record type
+        T event_{};
+
+        auto compute_checksum() const noexcept {
+            auto crc = crc32c(&seq_num_, sizeof(seq_num_));
+            crc = crc32c(&time_, sizeof(time_), crc);
+            crc = crc32c(&size_, sizeof(size_), crc);
+            return crc32c(&event_, sizeof(event_), crc);
+        }
+
+        auto is_valid(uint64_t expected_seq_num) const noexcept {
+            return seq_num_ == expected_seq_num && size_ == sizeof(T) && checksum_ == compute_checksum();
+        }
+    };
+
+    struct JournalReplayResult {
+        std::size_t records_ = 0;
+        std::size_t segments_ = 0;
+        uint64_t last_seq_num_ = 0;
+        uint64_t last_segment_index_ = 0;
+        bool torn_ = false; // some segment ended in an invalid record instead of zeroes, i.e. a crash mid write
+    };
+
+    inline auto journal_segment_path(const std::string& dir, const std::string& name, uint64_t index) {
+        return dir + "/" + name + "." + std::to_string(index) + ".journal";
+    }
+
+    struct JournalSegmentMap {
+        const char* data_ = nullptr; // whole file, records start at JOURNAL_HEADER_SIZE, nullptr if it could not be used
+        std::size_t len_ = 0;
+        JournalSegmentHeader header_;
+    };
+
+    // maps a segment file read only for a front to back scan, checks that its header belongs to segment index of a
+    // journal of record_size records. The caller munmap()s data_
+    inline auto map_journal_segment(const std::string& path, uint64_t index, std::size_t record_size) -> JournalSegmentMap {
+        JournalSegmentMap segment;
+        const auto fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return segment;
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < JOURNAL_HEADER_SIZE) {
+            close(fd);
+            return segment;
+        }
+        const auto len = static_cast<std::size_t>(st.st_size);
+
+        // tell the kernel the whole file is read front to back so it reads ahead aggressively
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        auto map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+            return segment;
+        madvise(map, len, MADV_SEQUENTIAL);
+        madvise(map, len, MADV_WILLNEED);
+
+        memcpy(&segment.header_, map, sizeof(segment.header_));
+        if (segment.header_.magic_ != JOURNAL_MAGIC || segment.header_.version_ != JOURNAL_VERSION ||
+            segment.header_.record_size_ != record_size || segment.header_.segment_index_ != index) {
+            munmap(map, len);
+            return segment;
+        }
+        segment.data_ = static_cast<const char*>(map);
+        segment.len_ = len;
+        return segment;
+    }
+
+    // The validation rules shared by Journal::replay() and JournalView over a mapped segment: its header has to continue
+    // the sequence result covers so far, then records are valid from the front up to the first one that is not, f(const
+    // Record&) for each. A non zero seq number where the valid records stop is a torn write. Returns false, result
+    // untouched, if the segment does not continue the sequence.
+    template<typename Record, typename F>
+    inline auto scan_journal_segment(const JournalSegmentMap& segment, uint64_t index, JournalReplayResult& result, F& f) -> bool {
+        if (result.segments_ && segment.header_.first_seq_num_ != result.last_seq_num_ + 1)
+            return false;
+
+        const auto records = reinterpret_cast<const Record*>(segment.data_ + JOURNAL_HEADER_SIZE);
+        const auto max_records = (segment.len_ - JOURNAL_HEADER_SIZE) / sizeof(Record);
+        auto expected = segment.header_.first_seq_num_;
+        std::size_t i = 0;
+        for (; i < max_records && records[i].is_valid(expected); ++i, ++expected)
+            f(records[i]);
+
+        if (i < max_records && records[i].seq_num_ != 0)
+            result.torn_ = true;
+
+        result.records_ += i;
+        result.last_seq_num_ = expected - 1;
+        result.last_segment_index_ = index;
+        ++result.segments_;
+        return true;
+    }
+
+    template<typename T>
+    class Journal final {
+        static_assert(std::is_trivially_copyable_v<T>, "Journal events are written to disk as raw bytes.");
+
+    public:
+        using Record = JournalRecord<T>;
+
+        // resumes after the last valid record of an existing journal, always in a fresh segment so a torn tail never gets
+        // mixed up with new records
+        Journal(const std::string& dir, const std::string& name, std::size_t segment_size = JOURNAL_SEGMENT_SIZE,
+                std::size_t msync_batch = JOURNAL_MSYNC_BATCH, std::size_t queue_size = JOURNAL_QUEUE_SIZE)
+            : dir_{dir}, name_{name}, queue_{queue_size}, queue_capacity_{queue_size},
+              records_per_segment_{(segment_size - JOURNAL_HEADER_SIZE) / sizeof(Record)}, msync_batch_{msync_batch} {
+            ASSERT(segment_size > JOURNAL_HEADER_SIZE + sizeof(Record), "Journal segment size too small: " + std::to_string(segment_size));
+
+            const auto tail = find_tail(dir, name);
+            next_seq_num_ = tail.last_seq_num_ + 1;
+            next_segment_index_ = tail.segments_ ? tail.last_segment_index_ + 1 : 0;
+            open_segment();
+
+            writer_thread_ = create_and_start_thread(-1, "Common/Journal " + name, [this]() { run(); });
+            ASSERT(writer_thread_ != nullptr, "Failed to start Journal thread for " + name);
+        }
+
+        // drains everything appended so far and syncs it
+        ~Journal() {
+            running_ = false;
+            writer_thread_->join();
+            delete writer_thread_;
+            close_segment();
+        }
+
+        Journal() = delete;
+        Journal(const Journal&) = delete;
+        Journal(const Journal&&) = delete;
+        Journal& operator=(const Journal&) = delete;
+        Journal& operator=(const Journal&&) = delete;
+
+        // hot path, one producer thread per journal. Spins (and counts it) only if the writer fell a whole queue behind,
+        // dropping events would defeat the point of a journal
+        auto append(const T& event, Nanos time) noexcept {
+            if (UNLIKELY(queue_.size() >= queue_capacity_ - 1)) {
+                ++hot_stalls_;
+                while (queue_.size() >= queue_capacity_ - 1);
+            }
+            auto record = queue_.get_next_write();
+            record->time_ = time;
+            record->event_ = event;
+            queue_.update_write_index();
+        }
+
+        auto records_written() const noexcept { return records_written_.load(std::memory_order_relaxed); }
+        auto hot_stalls() const noexcept { return hot_stalls_; }
+        auto num_syncs() const noexcept { return num_syncs_.load(std::memory_order_relaxed); }
+
+        // Sequential scan of every segment in order, f(const Record&) for each valid record.
+        // Within a segment the scan stops at the first invalid record, the next segment must continue the sequence.
+        template<typename F>
+        static auto replay(const std::string& dir, const std::string& name, F&& f) -> JournalReplayResult {
+            JournalReplayResult result;
+            for (uint64_t index = 0;; ++index) {
+                const auto path = journal_segment_path(dir, name, index);
+                if (access(path.c_str(), F_OK) != 0)
+                    break;
+                if (!scan_segment(path, index, result, f))
+                    break;
+            }
+            return result;
+        }
+
+    private:
+        const std::string dir_;
+        const std::string name_;
+
+        LockFreeQueue<Record> queue_;
+        const std::size_t queue_capacity_;
+        std::size_t hot_stalls_ = 0;
+
+        std::atomic_bool running_ {true};
+        std::thread* writer_thread_ = nullptr;
+
+        const std::size_t records_per_segment_;
+        const std::size_t msync_batch_;
+
+        uint64_t next_seq_num_ = 1;
+        uint64_t next_segment_index_ = 0;
+
+        char* segment_ = nullptr;
+        std::size_t segment_len_ = 0;
+        std::size_t segment_records_ = 0;
+        std::size_t synced_records_ = 0;
+
+        std::atomic<std::size_t> records_written_ {0};
+        std::atomic<std::size_t> num_syncs_ {0};
+
+        auto run() noexcept {
+            while (true) {
+                const bool draining = !running_;
+                std::size_t n = 0;
+                for (auto next = queue_.get_next_read(); next; next = queue_.get_next_read(), ++n) {
+                    write(*next);
+                    queue_.update_read_index();
+                }
+                records_written_.fetch_add(n, std::memory_order_relaxed);
+
+                if (draining)
+                    return;
+                if (!n) {
+                    // idle, make the partial batch durable rather than leaving it until the next burst
+                    sync();
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+            }
+        }
+
+        auto write(const Record& in) noexcept {
+            if (UNLIKELY(segment_records_ == records_per_segment_)) {
+                close_segment();
+                open_segment();
+            }
+
+            auto record = reinterpret_cast<Record*>(segment_ + JOURNAL_HEADER_SIZE) + segment_records_;
+            memcpy(record, &in, sizeof(Record));
+            record->seq_num_ = next_seq_num_++;
+            record->size_ = sizeof(T);
+            record->checksum_ = record->compute_checksum();
+            ++segment_records_;
+
+            if (msync_batch_ && segment_records_ - synced_records_ >= msync_batch_)
+                sync();
+        }
+
+        // msync the records written since the last call, the range has to start on a page boundary
+        auto sync() noexcept {
+            if (!msync_batch_ || segment_records_ == synced_records_)
+                return;
+            static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            const auto from = (JOURNAL_HEADER_SIZE + synced_records_ * sizeof(Record)) & ~(page_size - 1);
+            const auto to = JOURNAL_HEADER_SIZE + segment_records_ * sizeof(Record);
+            ASSERT(msync(segment_ + from, to - from, MS_SYNC) == 0, "msync() failed for journal " + name_ + " errno: " + std::string{strerror(errno)});
+            synced_records_ = segment_records_;
+            num_syncs_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // the file is fully allocated and pre-faulted here so the writer never takes a page fault or hits ENOSPC (SIGBUS)
+        // half way through a segment
+        auto open_segment() -> void {
+            const auto path = journal_segment_path(dir_, name_, next_segment_index_);
+            const auto fd = open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+            ASSERT(fd >= 0, "open() failed for " + path + " errno: " + std::string{strerror(errno)});
+
+            segment_len_ = JOURNAL_HEADER_SIZE + records_per_segment_ * sizeof(Record);
+            const auto rc = posix_fallocate(fd, 0, static_cast<off_t>(segment_len_));
+            ASSERT(rc == 0, "posix_fallocate() failed for " + path + " error: " + std::string{strerror(rc)});
+
+            auto map = mmap(nullptr, segment_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+            close(fd);
+            ASSERT(map != MAP_FAILED, "mmap() failed for " + path + " errno: " + std::string{strerror(errno)});
+            segment_ = static_cast<char*>(map);
+
+            JournalSegmentHeader header{JOURNAL_MAGIC, JOURNAL_VERSION, sizeof(Record), next_segment_index_, next_seq_num_};
+            memcpy(segment_, &header, sizeof(header));
+
+            ++next_segment_index_;
+            segment_records_ = 0;
+            synced_records_ = 0;
+        }
+
+        auto close_segment() -> void {
+            if (!segment_)
+                return;
+            sync();
+            munmap(segment_, segment_len_);
+            segment_ = nullptr;
+        }
+
+        template<typename F>
+        static auto scan_segment(const std::string& path, uint64_t index, JournalReplayResult& result, F& f) -> bool {
+            const auto segment = map_journal_segment(path, index, sizeof(Record));
+            if (!segment.data_)
+                return false;
+            const auto continued = scan_journal_segment<Record>(segment, index, result, f);
+            munmap(const_cast<char*>(segment.data_), segment.len_);
+            return continued;
+        }
+
+        // where to carry on writing, only the last readable segment has to be scanned: even an empty one records the seq
+        // number it starts from. Unreadable trailing segments (crash while creating one) get overwritten.
+        static auto find_tail(const std::string& dir, const std::string& name) -> JournalReplayResult {
+            uint64_t num_segments = 0;
+            while (access(journal_segment_path(dir, name, num_segments).c_str(), F_OK) == 0)
+                ++num_segments;
+
+            auto no_op = [](const Record&) noexcept {};
+            for (auto index = num_segments; index-- > 0;) {
+                JournalReplayResult result;
+                if (scan_segment(journal_segment_path(dir, name, index), index, result, no_op))
+                    return result;
+            }
+            return {};
+        }
+    };
+
+    // Read only view of a whole journal that stays mapped, for readers that go over the records more than once or from
+    // several threads, e.g. backtests over recorded market data. Validated once on construction by scan_journal_segment(),
+    // the same as Journal::replay(), after that a record is just a pointer into the page cache.
+    template<typename T>
+    class JournalView final {
+    public:
+        using Record = JournalRecord<T>;
+
+        JournalView(const std::string& dir, const std::string& name) {
+            for (uint64_t index = 0;; ++index) {
+                const auto segment = map_journal_segment(journal_segment_path(dir, name, index), index, sizeof(Record));
+                if (!segment.data_)
+                    break;
+                const auto records_before = result_.records_;
+                auto no_op = [](const Record&) noexcept {};
+                if (!scan_journal_segment<Record>(segment, index, result_, no_op)) {
+                    munmap(const_cast<char*>(segment.data_), segment.len_);
+                    break;
+                }
+
+                // readers jump around between instruments from here on
+                madvise(const_cast<char*>(segment.data_), segment.len_, MADV_NORMAL);
+                segments_.push_back({segment, reinterpret_cast<const Record*>(segment.data_ + JOURNAL_HEADER_SIZE),
+                                     result_.records_ - records_before});
+            }
+        }
+
+        ~JournalView() {
+            for (const auto& segment : segments_)
+                munmap(const_cast<char*>(segment.map_.data_), segment.map_.len_);
+        }
+
+        JournalView() = delete;
+        JournalView(const JournalView&) = delete;
+        JournalView(const JournalView&&) = delete;
+        JournalView& operator=(const JournalView&) = delete;
+        JournalView& operator=(const JournalView&&) = delete;
+
+        // f(const Record&) for every valid record in order
+        template<typename F>
+        auto for_each(F&& f) const {
+            for (const auto& segment : segments_) {
+                for (std::size_t i = 0; i < segment.num_records_; ++i)
+                    f(segment.records_[i]);
+            }
+        }
+
+        auto size() const noexcept { return result_.records_; }
+        auto result() const noexcept -> const JournalReplayResult& { return result_; }
+
+    private:
+        struct Segment {
+            JournalSegmentMap map_;
+            const Record* records_ = nullptr;
+            std::size_t num_records_ = 0;
+        };
+
+        std::vector<Segment> segments_;
+        JournalReplayResult result_;
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <sstream>
+
+#include "time_utils.h"
+
+namespace Common {
+
+    // fixed size log-linear histogram of nanosecond latencies, recording never allocates
+    // values below 32ns get a bucket each, above that every power of two range is split into 32 buckets (~3% resolution)
+    class LatencyHistogram final {
+    public:
+        auto record(Nanos value) noexcept {
+            if (value < 0)
+                value = 0; // clocks differ by a few ns at most, don't let that poison the stats
+            ++buckets_[bucket_index(static_cast<uint64_t>(value))];
+            ++count_;
+            sum_ += value;
+            if (value < min_) min_ = value;
+            if (value > max_) max_ = value;
+        }
+
+        auto count() const noexcept { return count_; }
+        auto min() const noexcept { return count_ ? min_ : 0; }
+        auto max() const noexcept { return max_; }
+        auto mean() const noexcept { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+        // upper bound of the bucket holding the p-th percentile, p in [0, 100]
+        auto percentile(double p) const noexcept -> Nanos {
+            if (!count_)
+                return 0;
+            const auto target = static_cast<uint64_t>(p / 100.0 * (count_ - 1)) + 1;
+            uint64_t seen = 0;
+            for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+                seen += buckets_[i];
+                if (seen >= target)
+                    return std::min(bucket_upper_bound(i), max_);
+            }
+            return max_;
+        }
+
+        auto merge(const LatencyHistogram& other) noexcept {
+            for (std::size_t i = 0; i < NUM_BUCKETS; ++i)
+                buckets_[i] += other.buckets_[i];
+            count_ += other.count_;
+            sum_ += other.sum_;
+            if (other.count_ && other.min_ < min_) min_ = other.min_;
+            if (other.max_ > max_) max_ = other.max_;
+        }
+
+        auto reset() noexcept {
+            buckets_.fill(0);
+            count_ = 0;
+            sum_ = 0;
+            min_ = std::numeric_limits<Nanos>::max();
+            max_ = 0;
+        }
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "count:" << count_ << " min:" << min() << " mean:" << static_cast<Nanos>(mean())
+               << " p50:" << percentile(50) << " p90:" << percentile(90) << " p99:" << percentile(99)
+               << " p99.9:" << percentile(99.9) << " max:" << max_;
+            return ss.str();
+        }
+
+    private:
+        static constexpr std::size_t SUB_BUCKET_BITS = 5;
+        static constexpr std::size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static constexpr std::size_t NUM_BUCKETS = SUB_BUCKETS + (63 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+        std::array<uint64_t, NUM_BUCKETS> buckets_{};
+        uint64_t count_ = 0;
+        Nanos sum_ = 0;
+        Nanos min_ = std::numeric_limits<Nanos>::max();
+        Nanos max_ = 0;
+
+        static constexpr auto bucket_index(uint64_t value) noexcept -> std::size_t {
+            if (value < SUB_BUCKETS)
+                return value;
+            const auto msb = static_cast<std::size_t>(std::bit_width(value) - 1);
+            const auto shift = msb - SUB_BUCKET_BITS;
+            return SUB_BUCKETS + shift * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+        }
+
+        static constexpr auto bucket_upper_bound(std::size_t index) noexcept -> Nanos {
+            if (index < SUB_BUCKETS)
+                return static_cast<Nanos>(index);
+            const auto shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+            const auto sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+            return static_cast<Nanos>(((SUB_BUCKETS + sub + 1) << shift) - 1);
+        }
+    };
+}
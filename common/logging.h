@@ -169,7 +169,7 @@ namespace Common {
         }
 
         template <typename T, typename... Args>
-        auto log(const char* s, const T& value, Args... args) noexcept {
+        auto log(const char* s, const T& value, const Args&... args) noexcept {
             while(*s) {
                 if (*s == '%') {
                     push_value(value);
@@ -9,12 +9,17 @@
 #define LIKELY(x)  __builtin_expect(!!(x), 1)
 #define UNLIKELY(x)  __builtin_expect(!!(x), 0)
 
-inline auto ASSERT(bool cond, const std::string& msg) noexcept {
-    if (UNLIKELY(!cond)) {
-        std::cerr << msg << '\n';
-        exit(EXIT_FAILURE);
-    }
-}
+// keep data written by different threads / processes on different cache lines
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// a macro rather than a function so the message, usually a string concatenation, is only built when the check fails
+#define ASSERT(cond, msg) \
+    do { \
+        if (UNLIKELY(!(cond))) { \
+            std::cerr << (msg) << '\n'; \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (false)
 
 inline auto FATAL(const std::string& msg) noexcept {
     std::cerr << msg << '\n';
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "macros.h"
+#include "time_utils.h"
+#include "logging.h"
+#include "socket_utils.h"
+
+// multicast publisher that frames fixed size messages into MTU sized, sequenced datagrams
+
+namespace Common {
+
+    constexpr std::size_t MCAST_DEFAULT_MTU = 1500;
+    constexpr std::size_t MCAST_IP_UDP_HEADER_SIZE = 20 + 8;
+    constexpr std::size_t MCAST_MAX_PACKETS_PER_FLUSH = 64;
+
+#pragma pack(push, 1)
+
+    // starts every datagram, followed by msg_count_ messages of msg_size_ bytes each
+    // packet seq numbers start at 1 and have no gaps, a receiver that sees a gap lost whole datagrams
+    struct McastPacketHeader {
+        uint64_t seq_num_ = 0;
+        Nanos send_time_ = 0;   // when the flush that sent this packet started
+        uint16_t msg_count_ = 0;
+        uint16_t msg_size_ = 0;
+    };
+
+#pragma pack(pop)
+
+    // Messages are staged until a flush, which frames them into as few datagrams as the MTU allows and hands all of
+    // them to the kernel in one sendmmsg(). A flush happens when the staging area is full (max_packets_per_flush full
+    // datagrams), when poll() finds the oldest staged message older than flush_budget, or on flush(). A budget of 0
+    // sends every message as soon as it is published.
+    // publish(msg, key) conflates: a message for a key that is still staged overwrites the staged one in place, so a
+    // slow flush budget costs bandwidth only once per key. Keys are dense ids in [0, max_keys), e.g. ticker ids.
+    // The socket is the regular non blocking UDP socket from create_socket(), connected to the group.
+    template<typename T>
+    class McastPublisher final {
+        static_assert(std::is_trivially_copyable_v<T>, "McastPublisher sends messages as raw bytes.");
+
+    public:
+        McastPublisher(Logger& logger, const std::string& ip, const std::string& iface, int port, Nanos flush_budget = 0,
+                       std::size_t max_keys = 0, std::size_t mtu = MCAST_DEFAULT_MTU, std::size_t max_packets_per_flush = MCAST_MAX_PACKETS_PER_FLUSH)
+            : logger_{logger}, flush_budget_{flush_budget},
+              msgs_per_packet_{mtu > MCAST_IP_UDP_HEADER_SIZE + sizeof(McastPacketHeader) ? (mtu - MCAST_IP_UDP_HEADER_SIZE - sizeof(McastPacketHeader)) / sizeof(T) : 0},
+              max_packets_{max_packets_per_flush}, staged_(msgs_per_packet_ * max_packets_per_flush),
+              headers_(max_packets_per_flush), iovecs_(2 * max_packets_per_flush), msgs_(max_packets_per_flush),
+              key_slots_(max_keys), key_windows_(max_keys, 0) {
+            ASSERT(msgs_per_packet_ && sizeof(T) <= UINT16_MAX, "McastPublisher message of " + std::to_string(sizeof(T)) + " bytes does not fit an MTU of " + std::to_string(mtu));
+            ASSERT(max_packets_per_flush, "McastPublisher needs at least one packet per flush.");
+
+            socket_fd_ = create_socket(logger_, {ip, iface, port, true, false, false});
+            ASSERT(socket_fd_ >= 0, "Unable to create publisher socket for " + ip + ":" + std::to_string(port) + " error: " + std::string{strerror(errno)});
+
+            // every datagram is two iovecs, its header and a contiguous run of staged messages
+            for (std::size_t i = 0; i < max_packets_; ++i) {
+                iovecs_[2 * i] = {&headers_[i], sizeof(McastPacketHeader)};
+                msgs_[i].msg_hdr.msg_iov = &iovecs_[2 * i];
+                msgs_[i].msg_hdr.msg_iovlen = 2;
+            }
+        }
+
+        ~McastPublisher() {
+            if (socket_fd_ >= 0)
+                close(socket_fd_);
+        }
+
+        McastPublisher() = delete;
+        McastPublisher(const McastPublisher&) = delete;
+        McastPublisher(const McastPublisher&&) = delete;
+        McastPublisher& operator=(const McastPublisher&) = delete;
+        McastPublisher& operator=(const McastPublisher&&) = delete;
+
+        auto publish(const T& msg) noexcept {
+            stage() = msg;
+            after_stage();
+        }
+
+        // conflating publish, replaces a staged message for the same key
+        auto publish(const T& msg, std::size_t key) noexcept {
+            ASSERT(key < key_windows_.size(), "McastPublisher key out of range:" + std::to_string(key));
+            if (key_windows_[key] == window_) {
+                staged_[key_slots_[key]] = msg;
+                ++msgs_conflated_;
+                return;
+            }
+            key_windows_[key] = window_;
+            key_slots_[key] = static_cast<uint32_t>(num_staged_);
+            stage() = msg;
+            after_stage();
+        }
+
+        // call from the owning loop, sends what is staged once the oldest message has waited flush_budget
+        auto poll(Nanos now) noexcept {
+            if (num_staged_ && now - first_staged_time_ >= flush_budget_)
+                flush();
+        }
+
+        // frames and sends everything staged, returns the number of datagrams
+        std::size_t flush() noexcept {
+            if (!num_staged_)
+                return 0;
+
+            const auto now = getCurrentNanos();
+            const auto num_packets = (num_staged_ + msgs_per_packet_ - 1) / msgs_per_packet_;
+            for (std::size_t i = 0; i < num_packets; ++i) {
+                const auto first = i * msgs_per_packet_;
+                const auto count = std::min(msgs_per_packet_, num_staged_ - first);
+                headers_[i] = {next_seq_num_++, now, static_cast<uint16_t>(count), static_cast<uint16_t>(sizeof(T))};
+                iovecs_[2 * i + 1] = {&staged_[first], count * sizeof(T)};
+            }
+
+            // a full socket buffer drops what is left, the receivers see it as a packet seq gap like any other loss
+            std::size_t sent = 0;
+            while (sent < num_packets) {
+                const auto n = sendmmsg(socket_fd_, &msgs_[sent], static_cast<unsigned>(num_packets - sent), MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n <= 0) {
+                    packets_dropped_ += num_packets - sent;
+                    logger_.log("%:% %() % sendmmsg() socket:% dropped % packets errno:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::get_current_time_str(time_str_), socket_fd_, num_packets - sent, strerror(errno));
+                    break;
+                }
+                sent += static_cast<std::size_t>(n);
+                ++send_calls_;
+            }
+
+            packets_sent_ += sent;
+            msgs_sent_ += num_staged_;
+            num_staged_ = 0;
+            ++window_;
+            return num_packets;
+        }
+
+        auto num_staged() const noexcept { return num_staged_; }
+        auto msgs_per_packet() const noexcept { return msgs_per_packet_; }
+        auto next_seq_num() const noexcept { return next_seq_num_; }
+
+        auto msgs_sent() const noexcept { return msgs_sent_; }
+        auto msgs_conflated() const noexcept { return msgs_conflated_; }
+        auto packets_sent() const noexcept { return packets_sent_; }
+        auto packets_dropped() const noexcept { return packets_dropped_; }
+        auto send_calls() const noexcept { return send_calls_; }
+
+        // receiver side, f(const T&) for every message of one datagram, returns the header or nullptr if it is malformed
+        template<typename F>
+        static auto for_each_message(const char* datagram, std::size_t len, F&& f) noexcept -> const McastPacketHeader* {
+            if (len < sizeof(McastPacketHeader))
+                return nullptr;
+            const auto header = reinterpret_cast<const McastPacketHeader*>(datagram);
+            if (header->msg_size_ != sizeof(T) || sizeof(McastPacketHeader) + header->msg_count_ * sizeof(T) > len)
+                return nullptr;
+            for (std::size_t i = 0; i < header->msg_count_; ++i) {
+                T msg;
+                memcpy(static_cast<void*>(&msg), datagram + sizeof(McastPacketHeader) + i * sizeof(T), sizeof(T));
+                f(msg);
+            }
+            return header;
+        }
+
+    private:
+        Logger& logger_;
+        std::string time_str_;
+        int socket_fd_ = -1;
+
+        const Nanos flush_budget_;
+        const std::size_t msgs_per_packet_;
+        const std::size_t max_packets_;
+
+        std::vector<T> staged_;
+        std::size_t num_staged_ = 0;
+        Nanos first_staged_time_ = 0;
+
+        std::vector<McastPacketHeader> headers_;
+        std::vector<iovec> iovecs_;
+        std::vector<mmsghdr> msgs_;
+
+        // conflation, a key is staged if its window matches the current one, bumping window_ unstages all keys at once
+        std::vector<uint32_t> key_slots_;
+        std::vector<uint64_t> key_windows_;
+        uint64_t window_ = 1;
+
+        uint64_t next_seq_num_ = 1;
+        std::size_t msgs_sent_ = 0;
+        std::size_t msgs_conflated_ = 0;
+        std::size_t packets_sent_ = 0;
+        std::size_t packets_dropped_ = 0;
+        std::size_t send_calls_ = 0;
+
+        T& stage() noexcept {
+            if (!num_staged_)
+                first_staged_time_ = flush_budget_ ? getCurrentNanos() : 0;
+            return staged_[num_staged_++];
+        }
+
+        void after_stage() noexcept {
+            if (!flush_budget_ || num_staged_ == staged_.size())
+                flush();
+        }
+    };
+}
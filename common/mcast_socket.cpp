@@ -3,9 +3,11 @@
 namespace Common {
   /// Initialize multicast socket to read from or publish to a stream.
   /// Does not join the multicast stream yet.
-  auto McastSocket::init(const std::string &ip, const std::string &iface, int port, bool is_listening) -> int {
-    const SocketCfg socket_cfg{ip, iface, port, true, is_listening, false};
+  auto McastSocket::init(const std::string &ip, const std::string &iface, int port, bool is_listening, bool needs_so_timestamp) -> int {
+    const SocketCfg socket_cfg{ip, iface, port, true, is_listening, needs_so_timestamp};
     socket_fd_ = create_socket(logger_, socket_cfg);
+    timestamps_ = {};
+    timestamps_.enabled_ = needs_so_timestamp;
     return socket_fd_;
   }
 
@@ -16,30 +18,73 @@ namespace Common {
 
   /// Remove / Leave membership / subscription to a multicast stream.
   auto McastSocket::leave(const std::string &, int) -> void {
+    delete xdp_socket_;
+    xdp_socket_ = nullptr;
     close(socket_fd_);
     socket_fd_ = -1;
   }
 
+  /// Receive the stream through AF_XDP instead of the kernel UDP stack, call after init() and join().
+  /// The UDP socket stays open and joined, it keeps the group membership alive on the interface and is still read for
+  /// whatever the XDP program passes on, e.g. the group arriving on an rx queue other than queue_id.
+  auto McastSocket::enable_xdp(const std::string &ip, const std::string &iface, int port, uint32_t queue_id) -> bool {
+    auto xdp_socket = new XdpSocket(logger_);
+    if (!xdp_socket->init(ip, iface, port, queue_id)) {
+      logger_.log("%:% %() % falling back to socket path socket:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), socket_fd_);
+      delete xdp_socket;
+      return false;
+    }
+    xdp_socket_ = xdp_socket;
+    return true;
+  }
+
   /// Publish outgoing data and read incoming data.
   auto McastSocket::send_and_recv() noexcept -> bool {
-    // Read data and dispatch callbacks if data is available - non blocking.
-    const ssize_t n_rcv = recv(socket_fd_, inbound_data_.data() + next_rcv_valid_index_, McastBufferSize - next_rcv_valid_index_, MSG_DONTWAIT);
+    ssize_t n_xdp = 0;
+    if (xdp_socket_) {
+      // Dispatch every datagram in the rx ring in place, one callback each, nothing is copied into inbound_data_.
+      // There is no kernel timestamp on this path, rx_time_ is when the batch was taken off the ring.
+      // Whatever the callback left in inbound_data_ from the socket path stays there for the next socket read.
+      const auto socket_rcv_valid_index = next_rcv_valid_index_;
+      rx_time_ = timestamps_.enabled_ ? getCurrentNanos() : 0;
+      n_xdp = xdp_socket_->recv_batch([this](char *data, size_t len) {
+        rcv_data_ = data;
+        next_rcv_valid_index_ = len;
+        recv_callback_(this);
+      });
+      rcv_data_ = inbound_data_.data();
+      next_rcv_valid_index_ = socket_rcv_valid_index;
+    }
+
+    // Read data and dispatch callbacks if data is available - non blocking, kernel timestamp comes in the control buffer.
+    // With XDP enabled this still picks up the group's datagrams the program passed on, i.e. those on other rx queues.
+    char ctrl[SOCKET_CTRL_BUFFER_SIZE];
+    iovec iov{inbound_data_.data() + next_rcv_valid_index_, McastBufferSize - next_rcv_valid_index_};
+    msghdr msg{nullptr, 0, &iov, 1, ctrl, sizeof(ctrl), 0};
+    const auto n_rcv = recvmsg(socket_fd_, &msg, MSG_DONTWAIT);
     if (n_rcv > 0) {
       next_rcv_valid_index_ += n_rcv;
-      logger_.log("%:% %() % read socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), socket_fd_,
-        next_rcv_valid_index_);
+      rx_time_ = timestamps_.enabled_ ? timestamps_.on_recv(msg, getCurrentNanos()) : 0;
+      logger_.log("%:% %() % read socket:% len:% ktime:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), socket_fd_,
+        next_rcv_valid_index_, rx_time_);
       recv_callback_(this);
     }
 
     // Publish market data in the send buffer to the multicast stream.
     if (next_send_valid_index_ > 0) {
+      const auto send_time = timestamps_.enabled_ ? getCurrentNanos() : 0;
       ssize_t n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL);
+      if (n > 0 && timestamps_.enabled_)
+        timestamps_.on_send(n, send_time);
 
       logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), socket_fd_, n);
     }
     next_send_valid_index_ = 0;
 
-    return (n_rcv > 0);
+    // Transmit timestamps for earlier sends come back on the error queue.
+    timestamps_.harvest_tx(socket_fd_);
+
+    return (n_xdp > 0 || n_rcv > 0);
   }
 
   /// Copy data to send buffers - does not send them out yet.
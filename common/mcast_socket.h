@@ -3,6 +3,8 @@
 #include <functional>
 
 #include "socket_utils.h"
+#include "socket_timestamps.h"
+#include "xdp_socket.h"
 
 #include "logging.h"
 
@@ -15,11 +17,25 @@ namespace Common {
         : logger_(logger) {
       outbound_data_.resize(McastBufferSize);
       inbound_data_.resize(McastBufferSize);
+      rcv_data_ = inbound_data_.data();
     }
 
+    ~McastSocket() {
+      delete xdp_socket_;
+    }
+
+    /// Owns xdp_socket_ and the buffers rcv_data_ points into.
+    McastSocket() = delete;
+    McastSocket(const McastSocket &) = delete;
+    McastSocket &operator=(const McastSocket &) = delete;
+    McastSocket(McastSocket &&) = delete;
+    McastSocket &operator=(McastSocket &&) = delete;
+
     /// Initialize multicast socket to read from or publish to a stream.
     /// Does not join the multicast stream yet.
-    auto init(const std::string &ip, const std::string &iface, int port, bool is_listening) -> int;
+    /// needs_so_timestamp turns on SO_TIMESTAMPING and the per datagram book keeping in timestamps_, which costs a
+    /// clock read per send and an error queue syscall per send_and_recv() - benchmarks and measurement paths opt in.
+    auto init(const std::string &ip, const std::string &iface, int port, bool is_listening, bool needs_so_timestamp = false) -> int;
 
     /// Add / Join membership / subscription to a multicast stream.
     auto join(const std::string &ip) -> bool;
@@ -27,6 +43,11 @@ namespace Common {
     /// Remove / Leave membership / subscription to a multicast stream.
     auto leave(const std::string &ip, int port) -> void;
 
+    /// Receive the stream through AF_XDP instead of the kernel UDP stack, call after init() and join().
+    /// Returns false and keeps using the regular socket if XDP is not available on iface. The regular socket is still
+    /// read either way, the flow on any rx queue other than queue_id reaches it through the kernel stack.
+    auto enable_xdp(const std::string &ip, const std::string &iface, int port, uint32_t queue_id = 0) -> bool;
+
     /// Publish outgoing data and read incoming data.
     auto send_and_recv() noexcept -> bool;
 
@@ -41,6 +62,20 @@ namespace Common {
     std::vector<char> inbound_data_;
     size_t next_rcv_valid_index_ = 0;
 
+    /// Received bytes for recv_callback_, inbound_data_ on the socket path, the UMEM frame itself on the XDP path.
+    /// A datagram is only valid for the duration of the callback on the XDP path.
+    char *rcv_data_ = nullptr;
+
+    /// Optional kernel bypass receive path, nullptr unless enable_xdp() succeeded.
+    XdpSocket *xdp_socket_ = nullptr;
+
+    /// Kernel receive timestamp of the datagram being dispatched, 0 without timestamps. On the XDP path, which has no
+    /// kernel timestamp, the time the batch was taken off the rx ring.
+    Nanos rx_time_ = 0;
+
+    /// SO_TIMESTAMPING state and kernel latency histograms for this socket.
+    SocketTimestamps timestamps_;
+
     /// Function wrapper for the method to call when data is read.
     std::function<void(McastSocket *s)> recv_callback_ = nullptr;
 
@@ -11,21 +11,25 @@ namespace Common {
     template <typename T>
     class MemoryPool final {
     public:
-        explicit MemoryPool(std::size_t num_elems) : store(num_elems, {T(), true}) {
+        explicit MemoryPool(std::size_t num_elems) : store(num_elems, {T(), true}), free_indices(num_elems) {
             ASSERT(reinterpret_cast<const ObjectBlock*>(&(store[0].object)) == &(store[0]),
                 "T object should be first member of ObjectBlock.\n");
+            // handed out from the front of the store first
+            for (std::size_t i = 0; i < num_elems; ++i)
+                free_indices[i] = num_elems - 1 - i;
         }
 
         // note: most compilers implement placement new with extra if statement to check if memory is non null
         template <typename... Args>
         T* allocate(Args... args) noexcept {
+            ASSERT(!free_indices.empty(), "Memory pool out of space.\n");
+            const auto next_free_index = free_indices.back();
+            free_indices.pop_back();
             auto obj_block = &(store[next_free_index]);
             ASSERT(obj_block->is_free, "Expected free ObjectBlock at index:" + std::to_string(next_free_index) + '\n');
             T* ret = &(obj_block->object);
             ret = new(ret) T(args...);
             obj_block->is_free = false;
-            
-            update_next_free_index();
 
             return ret;
         }
@@ -36,6 +40,7 @@ namespace Common {
                 "Element being deallocated does not belong to this memory pool.\n");
             ASSERT(!store[elem_index].is_free, "Expected in-use ObjectBlock at index:" + std::to_string(elem_index));
             store[elem_index].is_free = true;
+            free_indices.push_back(static_cast<std::size_t>(elem_index));
         }
 
         MemoryPool() = delete;
@@ -51,19 +56,8 @@ namespace Common {
         };
 
         std::vector<ObjectBlock> store;
-        std::size_t next_free_index {0};
-
-        // we can make this faster, keep simple for now
-        auto update_next_free_index() noexcept {
-            const auto initial_free_index = next_free_index;
-            while (!store[next_free_index].is_free) {
-                ++next_free_index;
-                if (next_free_index == store.size()) [[unlikely]]
-                    next_free_index = 0;
-                if (initial_free_index == next_free_index) [[unlikely]]
-                    ASSERT(initial_free_index != next_free_index, "Memory pool out of space.\n");
-            }
-        }
+        // stack of free block indices, a freed block is the next one handed out while it is still in cache
+        std::vector<std::size_t> free_indices;
     };
 
 
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "macros.h"
+
+// single writer sequence lock, the writer never waits and readers retry instead of blocking it
+
+namespace Common {
+
+    // The sequence is odd while a write is in progress. Readers take read_begin(), copy what they need and call
+    // read_retry() with the value they got, a write that overlapped the copy makes them go again.
+    class SeqLock final {
+    public:
+        auto write_begin() noexcept {
+            seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        auto write_end() noexcept {
+            seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        auto read_begin() const noexcept {
+            uint64_t seq;
+            while ((seq = seq_.load(std::memory_order_acquire)) & 1);
+            return seq;
+        }
+
+        auto read_retry(uint64_t seq) const noexcept {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return seq_.load(std::memory_order_relaxed) != seq;
+        }
+
+        // number of completed writes times two, a reader can compare it with the last value it saw to skip unchanged data
+        auto sequence() const noexcept { return seq_.load(std::memory_order_acquire); }
+
+    private:
+        std::atomic<uint64_t> seq_ {0};
+    };
+
+    // Storage for a T read concurrently with the writer. T is kept as relaxed atomic words, plain loads and stores on
+    // x86, so the torn reads a seqlock tolerates are not data races. store() goes between write_begin() / write_end()
+    // and load() between read_begin() / read_retry() of the guarding SeqLock.
+    template<typename T>
+    class SeqLockSlot final {
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLockSlot copies T word by word.");
+
+    public:
+        auto store(const T& value) noexcept {
+            std::array<uint64_t, NUM_WORDS> words{};
+            memcpy(words.data(), &value, sizeof(T));
+            for (std::size_t i = 0; i < NUM_WORDS; ++i)
+                words_[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        auto load() const noexcept {
+            std::array<uint64_t, NUM_WORDS> words;
+            for (std::size_t i = 0; i < NUM_WORDS; ++i)
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            T value;
+            memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+            return value;
+        }
+
+    private:
+        static constexpr std::size_t NUM_WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        std::array<std::atomic<uint64_t>, NUM_WORDS> words_{};
+    };
+
+    // a single T behind its own seqlock
+    template<typename T>
+    class SeqLocked final {
+    public:
+        auto store(const T& value) noexcept {
+            lock_.write_begin();
+            slot_.store(value);
+            lock_.write_end();
+        }
+
+        auto load() const noexcept {
+            while (true) {
+                const auto seq = lock_.read_begin();
+                const auto value = slot_.load();
+                if (LIKELY(!lock_.read_retry(seq)))
+                    return value;
+            }
+        }
+
+        // load() that also hands back the sequence the value was read at
+        auto load(uint64_t& seq_out) const noexcept {
+            while (true) {
+                const auto seq = lock_.read_begin();
+                const auto value = slot_.load();
+                if (LIKELY(!lock_.read_retry(seq))) {
+                    seq_out = seq;
+                    return value;
+                }
+            }
+        }
+
+        auto sequence() const noexcept { return lock_.sequence(); }
+
+    private:
+        SeqLock lock_;
+        SeqLockSlot<T> slot_;
+    };
+}
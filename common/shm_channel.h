@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <csignal>
+#include <thread>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "macros.h"
+#include "time_utils.h"
+
+// single producer single consumer channel between two processes, ring buffer in a named POSIX shared memory object
+
+namespace Common {
+
+    constexpr uint64_t SHM_CHANNEL_MAGIC = 0x314e414843'4d4853; // "SHMCHAN1"
+    constexpr uint32_t SHM_CHANNEL_VERSION = 1;
+
+    // how long an attacher waits for the creator to show up and finish initialising the channel
+    constexpr Nanos SHM_CHANNEL_ATTACH_TIMEOUT = 5'000'000'000;
+
+    enum class ShmChannelRole : int8_t {
+        PRODUCER = 0,
+        CONSUMER = 1
+    };
+
+    // lives at the start of the shared memory object, each index sits on its own cache line
+    struct ShmChannelHeader {
+        std::atomic<uint64_t> magic_ {0}; // stored last by the creator, with release, an attacher trusts nothing before it
+        uint32_t version_ = 0;
+        uint32_t elem_size_ = 0;
+        uint64_t capacity_ = 0;
+
+        // liveness, each side stamps its own pid / heartbeat and looks at the other's
+        std::atomic<int32_t> producer_pid_ {0};
+        std::atomic<int32_t> consumer_pid_ {0};
+        std::atomic<Nanos> producer_heartbeat_ {0};
+        std::atomic<Nanos> consumer_heartbeat_ {0};
+
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> write_index_ {0};
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> read_index_ {0};
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<Nanos>::is_always_lock_free,
+        "ShmChannel needs address free atomics.");
+
+    template<typename T>
+    class ShmChannel final {
+        static_assert(std::is_trivially_copyable_v<T>, "ShmChannel elements are shared between processes as raw bytes.");
+
+    private:
+        const std::string name_;
+        const ShmChannelRole role_;
+        bool owner_ = false;
+
+        void* map_ = nullptr;
+        std::size_t map_len_ = 0;
+
+        ShmChannelHeader* header_ = nullptr;
+        T* store_ = nullptr;
+        uint64_t mask_ = 0;
+
+        // each side keeps a private copy of the other side's index and only re-reads the shared one when it has to,
+        // that keeps the index cache lines from bouncing between cores on every message
+        uint64_t local_index_ = 0;
+        uint64_t cached_peer_index_ = 0;
+
+        static constexpr auto store_offset() noexcept {
+            return (sizeof(ShmChannelHeader) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+        }
+
+        // maps map_len_ bytes of fd and closes it, pre-faulting everything now rather than on the first messages
+        auto map(int fd) -> void {
+            map_ = mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+            close(fd);
+            ASSERT(map_ != MAP_FAILED, "mmap() failed for " + name_ + " errno: " + std::string{strerror(errno)});
+            header_ = reinterpret_cast<ShmChannelHeader*>(map_);
+            store_ = reinterpret_cast<T*>(reinterpret_cast<char*>(map_) + store_offset());
+        }
+
+        // one attach attempt, false while the creator has not got as far as shm_open(), ftruncate() and storing the magic
+        auto try_attach() -> bool {
+            const auto fd = shm_open(name_.c_str(), O_RDWR, 0600);
+            if (fd < 0) {
+                ASSERT(errno == ENOENT, "shm_open() attach failed for " + name_ + " errno: " + std::string{strerror(errno)});
+                return false;
+            }
+            struct stat st{};
+            ASSERT(fstat(fd, &st) == 0, "fstat() failed for " + name_ + " errno: " + std::string{strerror(errno)});
+            if (static_cast<std::size_t>(st.st_size) <= store_offset()) {
+                close(fd);
+                return false;
+            }
+            map_len_ = static_cast<std::size_t>(st.st_size);
+            map(fd);
+            if (header_->magic_.load(std::memory_order_acquire) != SHM_CHANNEL_MAGIC) {
+                munmap(map_, map_len_);
+                map_ = nullptr;
+                header_ = nullptr;
+                store_ = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+    public:
+        // capacity > 0 creates the channel (replacing a stale one of the same name) and must be a power of two,
+        // capacity == 0 attaches to a channel created by the other side. The creator unlinks the name on destruction.
+        // Either side may start first: an attacher retries for up to attach_timeout until the creator has created and
+        // initialised the channel, only then does it give up.
+        ShmChannel(const std::string& name, ShmChannelRole role, std::size_t capacity = 0, Nanos attach_timeout = SHM_CHANNEL_ATTACH_TIMEOUT)
+            : name_{name}, role_{role}, owner_{capacity > 0} {
+            ASSERT(!name.empty() && name[0] == '/', "ShmChannel name must start with '/': " + name);
+
+            if (owner_) {
+                ASSERT(!(capacity & (capacity - 1)), "ShmChannel capacity must be a power of two: " + std::to_string(capacity));
+                shm_unlink(name.c_str());
+                const auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+                ASSERT(fd >= 0, "shm_open() create failed for " + name + " errno: " + std::string{strerror(errno)});
+                map_len_ = store_offset() + capacity * sizeof(T);
+                ASSERT(ftruncate(fd, static_cast<off_t>(map_len_)) == 0, "ftruncate() failed for " + name + " errno: " + std::string{strerror(errno)});
+                map(fd);
+
+                new (header_) ShmChannelHeader{};
+                header_->version_ = SHM_CHANNEL_VERSION;
+                header_->elem_size_ = sizeof(T);
+                header_->capacity_ = capacity;
+                header_->magic_.store(SHM_CHANNEL_MAGIC, std::memory_order_release); // last, attachers check it first
+            } else {
+                const auto deadline = getCurrentNanos() + attach_timeout;
+                while (!try_attach()) {
+                    ASSERT(getCurrentNanos() < deadline, "ShmChannel " + name + " was not created and initialised within " +
+                        std::to_string(attach_timeout / 1'000'000) + "ms.");
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                ASSERT(header_->version_ == SHM_CHANNEL_VERSION, "ShmChannel " + name + " version mismatch: " + std::to_string(header_->version_));
+                ASSERT(header_->elem_size_ == sizeof(T), "ShmChannel " + name + " element size mismatch: " + std::to_string(header_->elem_size_));
+                ASSERT(store_offset() + header_->capacity_ * sizeof(T) <= map_len_, "ShmChannel " + name + " is truncated.");
+            }
+            mask_ = header_->capacity_ - 1;
+
+            // pick up where a previous incarnation of this side left off
+            if (role_ == ShmChannelRole::PRODUCER) {
+                local_index_ = header_->write_index_.load(std::memory_order_relaxed);
+                cached_peer_index_ = header_->read_index_.load(std::memory_order_acquire);
+                header_->producer_pid_.store(getpid(), std::memory_order_relaxed);
+            } else {
+                local_index_ = header_->read_index_.load(std::memory_order_relaxed);
+                cached_peer_index_ = header_->write_index_.load(std::memory_order_acquire);
+                header_->consumer_pid_.store(getpid(), std::memory_order_relaxed);
+            }
+            heartbeat();
+        }
+
+        ~ShmChannel() {
+            (role_ == ShmChannelRole::PRODUCER ? header_->producer_pid_ : header_->consumer_pid_).store(0, std::memory_order_relaxed);
+            munmap(map_, map_len_);
+            if (owner_)
+                shm_unlink(name_.c_str());
+        }
+
+        ShmChannel() = delete;
+        ShmChannel(const ShmChannel&) = delete;
+        ShmChannel(const ShmChannel&&) = delete;
+        ShmChannel& operator=(const ShmChannel&) = delete;
+        ShmChannel& operator=(const ShmChannel&&) = delete;
+
+        // producer: slot to construct the next message in place, nullptr while the channel is full
+        auto get_next_write() noexcept -> T* {
+            if (UNLIKELY(local_index_ - cached_peer_index_ > mask_)) {
+                cached_peer_index_ = header_->read_index_.load(std::memory_order_acquire);
+                if (local_index_ - cached_peer_index_ > mask_)
+                    return nullptr;
+            }
+            return &store_[local_index_ & mask_];
+        }
+
+        // producer: publish the slot returned by get_next_write()
+        auto update_write_index() noexcept {
+            header_->write_index_.store(++local_index_, std::memory_order_release);
+        }
+
+        // consumer: next message, read in place, nullptr while the channel is empty
+        auto get_next_read() noexcept -> const T* {
+            if (local_index_ == cached_peer_index_) {
+                cached_peer_index_ = header_->write_index_.load(std::memory_order_acquire);
+                if (local_index_ == cached_peer_index_)
+                    return nullptr;
+            }
+            return &store_[local_index_ & mask_];
+        }
+
+        // consumer: release the slot returned by get_next_read() back to the producer
+        auto update_read_index() noexcept {
+            header_->read_index_.store(++local_index_, std::memory_order_release);
+        }
+
+        auto size() const noexcept {
+            return header_->write_index_.load(std::memory_order_acquire) - header_->read_index_.load(std::memory_order_acquire);
+        }
+
+        auto capacity() const noexcept { return header_->capacity_; }
+
+        // stamp this side as alive, call from the owning loop every so often (not per message)
+        auto heartbeat() noexcept {
+            (role_ == ShmChannelRole::PRODUCER ? header_->producer_heartbeat_ : header_->consumer_heartbeat_)
+                .store(getCurrentNanos(), std::memory_order_relaxed);
+        }
+
+        // the other side is attached, its process exists and it stamped a heartbeat within timeout
+        auto is_peer_alive(Nanos now, Nanos timeout) const noexcept {
+            const auto pid = (role_ == ShmChannelRole::PRODUCER ? header_->consumer_pid_ : header_->producer_pid_).load(std::memory_order_relaxed);
+            const auto last = (role_ == ShmChannelRole::PRODUCER ? header_->consumer_heartbeat_ : header_->producer_heartbeat_).load(std::memory_order_relaxed);
+            return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM) && now - last <= timeout;
+        }
+    };
+}
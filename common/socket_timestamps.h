@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <ctime>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "time_utils.h"
+#include "latency_histogram.h"
+
+namespace Common {
+
+    // sends waiting for their SO_TIMESTAMPING transmit timestamp, the oldest are dropped if the kernel never reports them
+    constexpr std::size_t MAX_PENDING_TX_TIMESTAMPS = 4096;
+
+    // big enough for SCM_TIMESTAMPING plus IP_RECVERR (sock_extended_err + offender address) with padding
+    constexpr std::size_t SOCKET_CTRL_BUFFER_SIZE = 256;
+
+    inline auto timespec_to_nanos(const timespec& ts) noexcept -> Nanos {
+        return static_cast<Nanos>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // walk every control message, the software timestamp is ts[0] of SCM_TIMESTAMPING (ts[2] would be hardware)
+    inline auto get_kernel_timestamp(msghdr& msg) noexcept -> Nanos {
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET)
+                continue;
+            if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                scm_timestamping tss;
+                memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+                return timespec_to_nanos(tss.ts[0]);
+            }
+            if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                return timespec_to_nanos(ts);
+            }
+        }
+        return 0;
+    }
+
+    // Per socket SO_TIMESTAMPING book keeping.
+    // rx: kernel receive timestamp -> user space read, recorded on every read.
+    // tx: user space send -> kernel software transmit timestamp (SCM_TSTAMP_SND), harvested from MSG_ERRQUEUE and matched
+    // to the send that produced it through the SOF_TIMESTAMPING_OPT_ID key, which counts bytes on TCP and datagrams on UDP.
+    struct SocketTimestamps {
+        bool enabled_ = false;
+        bool is_stream_ = false;
+
+        LatencyHistogram rx_latency_;
+        LatencyHistogram tx_latency_;
+
+        Nanos last_rx_kernel_time_ = 0;
+        Nanos last_tx_kernel_time_ = 0;
+
+        // kernel timestamps going backwards, should stay 0
+        uint64_t rx_non_monotonic_ = 0;
+        uint64_t tx_non_monotonic_ = 0;
+
+        // sends that never got a timestamp, or timestamps that matched nothing
+        uint64_t tx_unmatched_ = 0;
+
+        auto on_recv(msghdr& msg, Nanos user_time) noexcept {
+            const auto kernel_time = get_kernel_timestamp(msg);
+            if (kernel_time) {
+                rx_non_monotonic_ += (kernel_time < last_rx_kernel_time_);
+                last_rx_kernel_time_ = kernel_time;
+                rx_latency_.record(user_time - kernel_time);
+            }
+            return kernel_time;
+        }
+
+        // bytes is what the kernel accepted in this send() call
+        auto on_send(std::size_t bytes, Nanos send_time) noexcept {
+            const auto key = is_stream_ ? static_cast<uint32_t>(next_tx_key_ + bytes - 1) : next_tx_key_;
+            next_tx_key_ = is_stream_ ? static_cast<uint32_t>(next_tx_key_ + bytes) : next_tx_key_ + 1;
+
+            if (num_pending_ == pending_.size()) {
+                pending_start_ = (pending_start_ + 1) % pending_.size();
+                --num_pending_;
+                ++tx_unmatched_;
+            }
+            pending_[(pending_start_ + num_pending_) % pending_.size()] = {key, send_time};
+            ++num_pending_;
+        }
+
+        // drain the error queue, only costs a syscall while sends are waiting for their timestamp
+        auto harvest_tx(int fd) noexcept {
+            while (num_pending_) {
+                char ctrl[SOCKET_CTRL_BUFFER_SIZE];
+                msghdr msg{};
+                msg.msg_control = ctrl;
+                msg.msg_controllen = sizeof(ctrl);
+                if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                    return;
+
+                Nanos kernel_time = 0;
+                const sock_extended_err* serr = nullptr;
+                for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                        scm_timestamping tss;
+                        memcpy(&tss, CMSG_DATA(cmsg), sizeof(tss));
+                        kernel_time = timespec_to_nanos(tss.ts[0]);
+                    } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                               (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                        serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+                    }
+                }
+
+                if (!kernel_time || !serr || serr->ee_origin != SO_EE_ORIGIN_TIMESTAMPING || serr->ee_info != SCM_TSTAMP_SND)
+                    continue;
+
+                match(serr->ee_data, kernel_time);
+            }
+        }
+
+    private:
+        struct PendingSend {
+            uint32_t key_ = 0;
+            Nanos send_time_ = 0;
+        };
+
+        uint32_t next_tx_key_ = 0;
+        std::array<PendingSend, MAX_PENDING_TX_TIMESTAMPS> pending_{};
+        std::size_t pending_start_ = 0;
+        std::size_t num_pending_ = 0;
+
+        auto match(uint32_t key, Nanos kernel_time) noexcept -> void {
+            tx_non_monotonic_ += (kernel_time < last_tx_kernel_time_);
+            last_tx_kernel_time_ = kernel_time;
+
+            // keys wrap on TCP after 4GB, compare by signed distance; anything older than key will never be reported
+            while (num_pending_ && static_cast<int32_t>(pending_[pending_start_].key_ - key) < 0) {
+                pending_start_ = (pending_start_ + 1) % pending_.size();
+                --num_pending_;
+                ++tx_unmatched_;
+            }
+
+            if (num_pending_ && pending_[pending_start_].key_ == key) {
+                tx_latency_.record(kernel_time - pending_[pending_start_].send_time_);
+                pending_start_ = (pending_start_ + 1) % pending_.size();
+                --num_pending_;
+            } else {
+                ++tx_unmatched_;
+            }
+        }
+    };
+}
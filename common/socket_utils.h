@@ -1,3 +1,5 @@
+#pragma once
+
 #include <iostream>
 #include <string>
 #include <unordered_set>
@@ -14,6 +16,7 @@
 #include <ifaddrs.h>
 #include <sys/socket.h>
 #include <fcntl.h>
+#include <linux/net_tstamp.h>
 
 #include "logging.h"
 #include "macros.h"
@@ -78,10 +81,25 @@ namespace Common {
         return (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<void*>(&one), sizeof(one)) == 0);
     }
 
-    // software timestamping on incoming packets
-    inline bool set_so_time_stamp(int fd) {
-        int one = 1;
-        return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMP, reinterpret_cast<void*>(&one), sizeof(one)) == 0);
+    // SOF_TIMESTAMPING_OPT_ID_TCP, linux/net_tstamp.h only has it from 6.2 on
+    constexpr int SOF_TIMESTAMPING_OPT_ID_TCP_FLAG = 1 << 16;
+
+    // nanosecond software timestamps on incoming packets, and on outgoing packets (reported on MSG_ERRQUEUE) if with_tx
+    // OPT_ID tags every transmit timestamp with a key to match it to its send, OPT_TSONLY skips looping the payload back
+    // TCP only accepts OPT_ID once connecting / connected, so listening TCP sockets get rx timestamps only
+    // OPT_ID_TCP keys TCP timestamps from the next byte to be written instead of the oldest unacked one, the two differ
+    // by the SYN while a non blocking connect() is still in SYN_SENT and every key would come out one too high.
+    // Kernels before 6.2 reject it, there the keys are only right if the handshake completed before this call
+    inline bool set_so_timestamping(int fd, bool with_tx, bool is_stream = false) {
+        int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (with_tx)
+            flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+        if (with_tx && is_stream) {
+            auto tcp_flags = flags | SOF_TIMESTAMPING_OPT_ID_TCP_FLAG;
+            if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, reinterpret_cast<void*>(&tcp_flags), sizeof(tcp_flags)) == 0)
+                return true;
+        }
+        return (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, reinterpret_cast<void*>(&flags), sizeof(flags)) == 0);
     }
 
     inline bool would_block() {
@@ -116,14 +134,15 @@ namespace Common {
         hints.ai_flags = (socket_cfg.is_listening ? AI_PASSIVE : 0) | AI_NUMERICHOST | AI_NUMERICSERV;
         
         addrinfo *result = nullptr;
-        const auto retval = getaddrinfo(socket_cfg.ip.c_str(), std::to_string(socket_cfg.port).c_str(), &hints, &result);
+        const auto retval = getaddrinfo(ip.c_str(), std::to_string(socket_cfg.port).c_str(), &hints, &result);
         ASSERT(!retval, "getaddrinfo() failed. error: " + std::string{gai_strerror(retval)} + "errno: " + std::string{strerror(errno)});
         
         int socket_fd = -1;
         int one = 1;
         
+        // numeric host / service, so the first result is the only one we need (looping here never advanced rp)
         addrinfo* rp = result;
-        while (rp) {
+        if (rp) {
             ASSERT((socket_fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol)) != -1, "socket() failed. errno: " + std::string{strerror(errno)});
             ASSERT(set_non_blocking(socket_fd), "set_non_blocking() failed. errno: " + std::string{strerror(errno)});
             if (!socket_cfg.is_udp)
@@ -135,10 +154,10 @@ namespace Common {
             }
             if (!socket_cfg.is_udp && socket_cfg.is_listening) // listen for incoming TCP connections
                 ASSERT(listen(socket_fd, max_tcp_server_backlog) == 0, "listen() failed, errno: " + std::string{strerror(errno)});
-            if (!socket_cfg.is_listening)
-                ASSERT(connect(socket_fd, rp->ai_addr, rp->ai_addrlen) == 0, "connect() failed. errno: " + std::string{strerror(errno)});
+            if (!socket_cfg.is_listening) // non-blocking TCP connect completes in the background
+                ASSERT(connect(socket_fd, rp->ai_addr, rp->ai_addrlen) == 0 || errno == EINPROGRESS, "connect() failed. errno: " + std::string{strerror(errno)});
             if (socket_cfg.needs_so_timestamp)
-                ASSERT(set_so_time_stamp(socket_fd), "set_so_timestamp() failed. errno: " + std::string{strerror(errno)});
+                ASSERT(set_so_timestamping(socket_fd, socket_cfg.is_udp || !socket_cfg.is_listening, !socket_cfg.is_udp), "set_so_timestamping() failed. errno: " + std::string{strerror(errno)});
         }
 
         if (result) freeaddrinfo(result);
@@ -7,10 +7,11 @@ namespace Common {
         return !epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, socket->socket_fd_, &ev);
     }
 
-    void TCPServer::listen(const std::string& iface, int port) {
+    void TCPServer::listen(const std::string& iface, int port, bool needs_so_timestamp) {
+        needs_so_timestamp_ = needs_so_timestamp;
         epoll_fd_ = epoll_create(1);
         ASSERT(epoll_fd_ >= 0, "epoll_create() failed. error: " + std::string{strerror(errno)});
-        ASSERT(listener_socket_.connect("", iface, port, true) >= 0, "TCPSocket::connect() failed (listener socket). iface: " + iface + "port: " + std::to_string(port) + "error: " + std::string{strerror(errno)});
+        ASSERT(listener_socket_.connect("", iface, port, true, needs_so_timestamp) >= 0, "TCPSocket::connect() failed (listener socket). iface: " + iface + "port: " + std::to_string(port) + "error: " + std::string{strerror(errno)});
         ASSERT(add_to_epoll_list(&listener_socket_), "epoll_ctl() failed. errno: " + std::string{strerror(errno)});
     }
 
@@ -21,7 +22,7 @@ namespace Common {
         });
 
         // there were some events and they have all been dispatched, inform listener
-        if (recv && recv_callback_) recv_finished_callback_();
+        if (recv && recv_finished_callback_) recv_finished_callback_();
 
         std::for_each(std::begin(send_sockets_), std::end(send_sockets_), [](auto socket) {
             socket->send_and_recv();
@@ -82,8 +83,13 @@ namespace Common {
             logger_.log("%:% %() % accepted socket:%\n", __FILE__, __LINE__, __FUNCTION__,
                         Common::get_current_time_str(time_str_), fd);
 
+            // accepted sockets are established, so they can take tx timestamps with OPT_ID unlike the listener
+            if (needs_so_timestamp_)
+                ASSERT(set_so_timestamping(fd, true, true), "Failed to set SO_TIMESTAMPING on socket:" + std::to_string(fd));
+
             auto socket = new TCPSocket(logger_);
             socket->socket_fd_ = fd;
+            socket->timestamps_.enabled_ = needs_so_timestamp_;
             socket->recv_callback_ = recv_callback_;
             ASSERT(add_to_epoll_list(socket), "Unable to add socket. error:" + std::string(std::strerror(errno)));
 
@@ -18,6 +18,8 @@ namespace Common {
         // function wrapper to call back when all data across all TCPSockets have been read and dispatched this round
         std::function<void()> recv_finished_callback_ = nullptr;
 
+        bool needs_so_timestamp_ = false;
+
         std::string time_str_;
         Logger& logger_;
 
@@ -29,7 +31,8 @@ namespace Common {
         TCPServer(TCPSocket &&) = delete;
         TCPServer &operator=(TCPSocket &&) = delete;
 
-        void listen(const std::string& iface, int port);
+        // needs_so_timestamp is passed on to every accepted socket, see TCPSocket::connect()
+        void listen(const std::string& iface, int port, bool needs_so_timestamp = false);
         void poll() noexcept;
         void send_and_recv() noexcept;
 
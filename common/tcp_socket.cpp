@@ -2,9 +2,12 @@
 
 namespace Common {
 
-    int TCPSocket::connect(const std::string& ip, const std::string& iface, int port, bool is_listening) {
-        const SocketCfg socket_cfg{ip, iface, port, false, is_listening, true};
+    int TCPSocket::connect(const std::string& ip, const std::string& iface, int port, bool is_listening, bool needs_so_timestamp) {
+        const SocketCfg socket_cfg{ip, iface, port, false, is_listening, needs_so_timestamp};
         socket_fd_ = create_socket(logger_, socket_cfg);
+        timestamps_ = {};
+        timestamps_.is_stream_ = true;
+        timestamps_.enabled_ = needs_so_timestamp;
         
         // want to store peers IP/port info on connection, do we need this info when using facilities below? (read into this later...) (msghdr?)
         socket_attrib_.sin_addr.s_addr = INADDR_ANY;
@@ -18,12 +21,10 @@ namespace Common {
     bool TCPSocket::send_and_recv() noexcept {
 
         // control message buffer setup
-        // allocate buffer to receive ancillary data (kernel timestamp) via recvmsg
-        // sized to hold a control message with struct timeval payload (for timestamps) + cmsghdr and alignment padding
-        // CMSG_SPACE is macro to calculate size for payload + cmsghdr + padding = 12 + 16 + 4 = 32
-
-        char ctrl[CMSG_SPACE(sizeof(struct timeval))];        
-        auto cmsg = reinterpret_cast<struct cmsghdr*>(&ctrl); 
+        // allocate buffer to receive ancillary data (kernel timestamp) via recvmsg, SO_TIMESTAMPING delivers a
+        // struct scm_timestamping (3 timespecs, software timestamp in ts[0]), SOCKET_CTRL_BUFFER_SIZE leaves room
+        // for that plus any other control message the kernel decides to attach
+        char ctrl[SOCKET_CTRL_BUFFER_SIZE];
 
         iovec iov{inbound_data_.data() + next_recv_valid_index_, TCP_BUFFER_SIZE - next_recv_valid_index_};
         msghdr msg{&socket_attrib_, sizeof(socket_attrib_), &iov, 1, ctrl, sizeof(ctrl), 0}; // address info, recv buffer (iov) and control buffer (ctrl)
@@ -35,16 +36,9 @@ namespace Common {
         if (read_size > 0) {
             next_recv_valid_index_ += read_size;
 
-            Nanos kernel_time = 0;
-            timeval time_kernel; // stuct timeval to hold timestamp
-            if (cmsg->cmsg_level == SOL_SOCKET && // message at the socket level
-                cmsg->cmsg_type == SCM_TIMESTAMP && // message is a timestamp
-                cmsg->cmsg_len == CMSG_LEN(sizeof(time_kernel))) { // length == cmsghdr + struct timeval, CMSG_LEN does same at CMSG_SPACE but strips padding
-                    memcpy(&time_kernel, CMSG_DATA(cmsg), sizeof(time_kernel));
-                    kernel_time = time_kernel.tv_sec * 1000000000 + time_kernel.tv_usec * 1000;
-            }
-
+            // walks every control message, not just the first one
             const auto user_time = getCurrentNanos();
+            const auto kernel_time = timestamps_.on_recv(msg, user_time);
 
             logger_.log("%:% %() % read socket:% len:% utime:% ktime:% diff:%\n", __FILE__, __LINE__, __FUNCTION__,
                 Common::get_current_time_str(time_str_), socket_fd_, next_recv_valid_index_, user_time, kernel_time, (user_time - kernel_time));
@@ -54,17 +48,33 @@ namespace Common {
 
         // non-blocking call to send data
         if (next_send_valid_index_ > 0) {
-            const auto n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL); // POSIX send (::send)
+            const auto n = flush();
             logger_.log("%:% %() % send socket:% len:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), socket_fd_, n);
         }
 
-        // this is incorrect if (n < next_send_valid_index_), potential loss of data if partial send
-        // will support this later
-        next_send_valid_index_ = 0;
-        
+        // transmit timestamps for earlier sends come back on the error queue
+        timestamps_.harvest_tx(socket_fd_);
+
         return (read_size > 0);
     }
 
+    ssize_t TCPSocket::flush() noexcept {
+        const auto send_time = timestamps_.enabled_ ? getCurrentNanos() : 0;
+        const auto n = ::send(socket_fd_, outbound_data_.data(), next_send_valid_index_, MSG_DONTWAIT | MSG_NOSIGNAL); // POSIX send (::send)
+        if (n > 0 && timestamps_.enabled_)
+            timestamps_.on_send(n, send_time);
+
+        // partial send, keep the tail for the next call instead of dropping it
+        if (n > 0 && static_cast<std::size_t>(n) < next_send_valid_index_) {
+            memmove(outbound_data_.data(), outbound_data_.data() + n, next_send_valid_index_ - n);
+            next_send_valid_index_ -= n;
+        } else if (n > 0 || !would_block()) {
+            next_send_valid_index_ = 0; // all sent, or the connection is gone and the data with it
+        }
+
+        return n;
+    }
+
     // write outgoing data to the send buffers
     void TCPSocket::send(const void* data, std::size_t len) noexcept {
         memcpy(outbound_data_.data() + next_send_valid_index_, data, len);
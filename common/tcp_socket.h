@@ -3,6 +3,7 @@
 #include <functional>
 
 #include "socket_utils.h"
+#include "socket_timestamps.h"
 #include "logging.h"
 
 namespace Common {
@@ -18,6 +19,9 @@ namespace Common {
         std::size_t next_recv_valid_index_ = 0;
 
         struct sockaddr_in socket_attrib_{};
+
+        // SO_TIMESTAMPING state and kernel latency histograms for this connection
+        SocketTimestamps timestamps_;
         
         std::function<void(TCPSocket* s, Nanos rx_time)> recv_callback_ = nullptr;
 
@@ -27,6 +31,7 @@ namespace Common {
         explicit TCPSocket(Logger& logger) : logger_{logger} {
             outbound_data_.resize(TCP_BUFFER_SIZE);
             inbound_data_.resize(TCP_BUFFER_SIZE);
+            timestamps_.is_stream_ = true;
         }
 
         TCPSocket() = delete;
@@ -35,8 +40,17 @@ namespace Common {
         TCPSocket(TCPSocket&&) = delete;
         TCPSocket& operator=(TCPSocket&&) = delete;
 
-        int connect(const std::string& ip, const std::string& iface, int port, bool is_listening);
+        // needs_so_timestamp turns on SO_TIMESTAMPING and the book keeping in timestamps_, a clock read per flush() and an
+        // error queue syscall per send_and_recv() while sends wait for their timestamp - measurement paths opt in
+        int connect(const std::string& ip, const std::string& iface, int port, bool is_listening, bool needs_so_timestamp = false);
         bool send_and_recv() noexcept;
         void send(const void* data, std::size_t len) noexcept;
+
+        // zero copy alternative to send(), encode straight into the outbound buffer and then commit the bytes
+        auto get_next_write() noexcept { return outbound_data_.data() + next_send_valid_index_; }
+        auto update_write_index(std::size_t len) noexcept { next_send_valid_index_ += len; }
+
+        // hand pending outbound data to the kernel right away without reading, keeps whatever was not accepted
+        ssize_t flush() noexcept;
     };
 }
\ No newline at end of file
@@ -22,7 +22,9 @@ namespace Common {
         std::atomic_bool running {0};
         std::atomic_bool failed {0};
 
-        auto thread_body = [&] {
+        // func and args are moved into the thread, the caller's temporaries are gone long before the thread finishes;
+        // only running / failed are shared and the thread stops touching them once it reports its status
+        auto thread_body = [&running, &failed, core_id, name, func = std::forward<F>(func), ...args = std::forward<Args>(args)]() mutable {
             if (core_id >= 0 && !set_thread_core(core_id)) {
                 std::cerr << "Failed to set core affinity for " << name << ' ' << 
                 pthread_self() << " to " << core_id << '\n';
@@ -31,10 +33,10 @@ namespace Common {
             }
             std::cout << "Set core affinity for " << name << ' ' << pthread_self() << " to " << core_id << '\n';
             running = true;
-            std::forward<F>(func) ((std::forward<Args>(args))...);
+            func(args...);
         };
 
-        auto t = new std::thread {thread_body};
+        auto t = new std::thread {std::move(thread_body)};
         
         // wait for new thread's status, either running = true or failed = true, only then should we decide what to do
         while (!running && !failed) {
@@ -12,7 +12,7 @@ namespace Common {
     
     inline auto& get_current_time_str(std::string& time_str) {
         const auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-        time_str.append(ctime(&time));
+        time_str.assign(ctime(&time)); // callers reuse one string member, appending grew it on every log line
         if (!time_str.empty())
             time_str.at(time_str.length()-1) = '\0';
         return time_str;
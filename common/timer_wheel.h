@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#include "macros.h"
+#include "time_utils.h"
+#include "memory_pool.h"
+
+// hierarchical timing wheel for timers driven from a poll loop, plus a token bucket throttle on top of it
+
+namespace Common {
+
+    constexpr std::size_t TW_SLOT_BITS = 8;
+    constexpr std::size_t TW_SLOTS = 1 << TW_SLOT_BITS;
+    constexpr std::size_t TW_LEVELS = 4;
+    constexpr Nanos TW_DEFAULT_TICK = 1'000;
+
+    // Timers are kept in TW_LEVELS wheels of TW_SLOTS slots each, level n slots span TW_SLOTS^n ticks, so with the
+    // default 1us tick level 0 covers 256us, level 1 65ms, level 2 16.7s and level 3 71 minutes. A timer sits in the
+    // slot of the lowest level its deadline fits in, when a lower level wraps the next slot of the level above is
+    // cascaded down. Further out deadlines wait in level 3 and are cascaded around again until they fit.
+    //
+    // schedule() and cancel() are O(1): a pool allocation and a push / unlink on an intrusive slot list. advance(now)
+    // expires a whole slot per tick and uses per level occupancy bitmaps to jump over empty slots, so an idle loop
+    // does not walk every tick. Expired timers are handed to the callback in tick order, never before their deadline.
+    //
+    // T is the payload given back on expiry, e.g. a small struct saying which session or order the timer is for.
+    // Single threaded, owned and driven by the thread that runs the poll loop.
+    template<typename T>
+    class TimerWheel final {
+        struct Node;
+
+    public:
+        // returned by schedule(), stays safe to cancel after the timer expired or was canceled
+        struct Timer {
+            Node* node_ = nullptr;
+            uint64_t id_ = 0;
+        };
+
+        TimerWheel(std::size_t max_timers, Nanos tick = TW_DEFAULT_TICK, Nanos now = getCurrentNanos())
+            : tick_{tick}, origin_{now}, node_pool_{max_timers} {
+            ASSERT(tick_ > 0, "TimerWheel tick must be positive.");
+            for (auto& level : slots_)
+                level.fill(nullptr);
+            for (auto& level : occupied_)
+                level.fill(0);
+        }
+
+        TimerWheel() = delete;
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel(const TimerWheel&&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&&) = delete;
+
+        // fires payload on the first advance() at or after deadline, a deadline already passed fires on the next tick
+        auto schedule(Nanos deadline, const T& payload) noexcept {
+            auto node = node_pool_.allocate();
+            node->payload_ = payload;
+            node->id_ = next_id_++;
+            node->deadline_ = std::max(to_tick_ceil(deadline), current_tick_ + 1);
+            insert(node);
+            ++num_timers_;
+            return Timer{node, node->id_};
+        }
+
+        auto schedule_after(Nanos now, Nanos delay, const T& payload) noexcept { return schedule(now + delay, payload); }
+
+        // returns false if the timer already expired or was canceled
+        auto cancel(Timer& timer) noexcept {
+            const auto node = timer.node_;
+            const auto live = node && node->id_ == timer.id_;
+            if (live) {
+                unlink(node);
+                release(node);
+            }
+            timer = {};
+            return live;
+        }
+
+        auto is_pending(const Timer& timer) const noexcept { return timer.node_ && timer.node_->id_ == timer.id_; }
+
+        // expires everything due at now, f(T&) per timer. f may schedule and cancel timers, including the one it is
+        // called for (a no-op by then), new timers never fire within the same call unless their tick is still ahead.
+        // returns the number of timers expired
+        template<typename F>
+        auto advance(Nanos now, F&& f) noexcept {
+            const auto target = to_tick_floor(now);
+            std::size_t expired = 0;
+            while (current_tick_ < target) {
+                if (!num_timers_) {
+                    current_tick_ = target;
+                    break;
+                }
+                current_tick_ = next_tick(target);
+
+                const auto index = current_tick_ & (TW_SLOTS - 1);
+                if (!index)
+                    cascade(1);
+
+                // take the whole slot at once, f can then reschedule into it without being seen again here
+                expiring_ = slots_[0][index];
+                slots_[0][index] = nullptr;
+                clear_occupied(0, index);
+                while (expiring_) {
+                    const auto node = expiring_;
+                    expiring_ = node->next_;
+                    if (expiring_)
+                        expiring_->prev_ = nullptr;
+                    // released before f, so f sees the timer as no longer pending and may cancel the rest of the tick
+                    auto payload = node->payload_;
+                    release(node);
+                    f(payload);
+                    ++expired;
+                }
+            }
+            return expired;
+        }
+
+        auto size() const noexcept { return num_timers_; }
+        auto tick() const noexcept { return tick_; }
+
+        // time of the last tick advance() processed
+        auto now() const noexcept { return origin_ + static_cast<Nanos>(current_tick_) * tick_; }
+
+    private:
+        struct Node {
+            T payload_{};
+            uint64_t id_ = 0; // 0 while the node is free
+            uint64_t deadline_ = 0; // in ticks since origin_
+            Node* prev_ = nullptr;
+            Node* next_ = nullptr;
+            uint8_t level_ = 0;
+            uint8_t index_ = 0;
+        };
+
+        const Nanos tick_;
+        const Nanos origin_;
+
+        std::array<std::array<Node*, TW_SLOTS>, TW_LEVELS> slots_;
+        std::array<std::array<uint64_t, TW_SLOTS / 64>, TW_LEVELS> occupied_;
+
+        MemoryPool<Node> node_pool_;
+        Node* expiring_ = nullptr;
+        uint64_t current_tick_ = 0;
+        uint64_t next_id_ = 1;
+        std::size_t num_timers_ = 0;
+
+        auto to_tick_floor(Nanos time) const noexcept -> uint64_t {
+            return time > origin_ ? static_cast<uint64_t>((time - origin_) / tick_) : 0;
+        }
+
+        auto to_tick_ceil(Nanos time) const noexcept -> uint64_t {
+            return time > origin_ ? static_cast<uint64_t>((time - origin_ + tick_ - 1) / tick_) : 0;
+        }
+
+        auto insert(Node* node) noexcept -> void {
+            const auto delta = node->deadline_ - current_tick_;
+            std::size_t level = 0;
+            while (level + 1 < TW_LEVELS && delta >= (uint64_t{1} << (TW_SLOT_BITS * (level + 1))))
+                ++level;
+
+            const auto index = (node->deadline_ >> (TW_SLOT_BITS * level)) & (TW_SLOTS - 1);
+            node->level_ = static_cast<uint8_t>(level);
+            node->index_ = static_cast<uint8_t>(index);
+            node->prev_ = nullptr;
+            node->next_ = slots_[level][index];
+            if (node->next_)
+                node->next_->prev_ = node;
+            slots_[level][index] = node;
+            occupied_[level][index / 64] |= uint64_t{1} << (index % 64);
+        }
+
+        auto unlink(Node* node) noexcept -> void {
+            auto& slot = slots_[node->level_][node->index_];
+            if (node->prev_) {
+                node->prev_->next_ = node->next_;
+            } else if (slot == node) {
+                slot = node->next_;
+                if (!slot)
+                    clear_occupied(node->level_, node->index_);
+            } else {
+                // head of the tick advance() is expiring
+                expiring_ = node->next_;
+            }
+            if (node->next_)
+                node->next_->prev_ = node->prev_;
+        }
+
+        auto release(Node* node) noexcept -> void {
+            node->id_ = 0;
+            node_pool_.deallocate(node);
+            --num_timers_;
+        }
+
+        auto clear_occupied(std::size_t level, std::size_t index) noexcept -> void {
+            occupied_[level][index / 64] &= ~(uint64_t{1} << (index % 64));
+        }
+
+        // re-inserts the level's current slot one level down, and the level above's if this level wrapped as well
+        auto cascade(std::size_t level) noexcept -> void {
+            const auto index = (current_tick_ >> (TW_SLOT_BITS * level)) & (TW_SLOTS - 1);
+            if (!index && level + 1 < TW_LEVELS)
+                cascade(level + 1);
+
+            auto node = slots_[level][index];
+            slots_[level][index] = nullptr;
+            clear_occupied(level, index);
+            while (node) {
+                const auto next = node->next_;
+                insert(node);
+                node = next;
+            }
+        }
+
+        // the next tick up to target that has level 0 timers or wraps level 0 and so may cascade some in
+        auto next_tick(uint64_t target) const noexcept -> uint64_t {
+            const auto index = (current_tick_ & (TW_SLOTS - 1)) + 1;
+            const auto base = current_tick_ - (current_tick_ & (TW_SLOTS - 1));
+            auto next = base + TW_SLOTS;
+            for (auto word = index / 64; word < TW_SLOTS / 64; ++word) {
+                auto bits = occupied_[0][word];
+                if (word == index / 64)
+                    bits &= index % 64 ? ~uint64_t{0} << (index % 64) : ~uint64_t{0};
+                if (bits) {
+                    next = base + word * 64 + static_cast<uint64_t>(std::countr_zero(bits));
+                    break;
+                }
+            }
+            return std::min(next, target);
+        }
+    };
+
+    // Token bucket of burst tokens refilled at one per interval, kept as the theoretical time the bucket is next
+    // empty (GCRA), so a check is a couple of compares with no refill arithmetic.
+    class TokenBucket final {
+    public:
+        TokenBucket(Nanos interval, std::size_t burst) : interval_{interval}, window_{interval * static_cast<Nanos>(burst)} {
+            ASSERT(interval_ > 0 && burst, "TokenBucket needs a positive interval and burst.");
+        }
+
+        TokenBucket() = delete;
+        TokenBucket(const TokenBucket&) = delete;
+        TokenBucket(const TokenBucket&&) = delete;
+        TokenBucket& operator=(const TokenBucket&) = delete;
+        TokenBucket& operator=(const TokenBucket&&) = delete;
+
+        auto try_acquire(Nanos now) noexcept {
+            const auto tat = std::max(tat_, now) + interval_;
+            if (tat - now > window_)
+                return false;
+            tat_ = tat;
+            return true;
+        }
+
+        // takes a token that may only be used at the returned time, which is now if one is available
+        auto reserve(Nanos now) noexcept {
+            const auto tat = std::max(tat_, now) + interval_;
+            tat_ = tat;
+            return std::max(now, tat - window_);
+        }
+
+        // when try_acquire() will next succeed
+        auto available_at(Nanos now) const noexcept { return std::max(now, std::max(tat_, now) + interval_ - window_); }
+
+    private:
+        const Nanos interval_;
+        const Nanos window_;
+        Nanos tat_ = 0;
+    };
+
+    enum class ThrottleResult : uint8_t {
+        SEND = 0,     // within the rate, send it now
+        DEFERRED = 1, // queued on the wheel, handed back by poll() once the rate allows
+        REJECTED = 2  // over the rate with max_deferred already queued
+    };
+
+    // Rate limit, e.g. an exchange's orders per second limit: submit() passes whatever the bucket allows and defers
+    // the rest onto a timing wheel at the time their token frees up, poll() hands them back in submit order as long
+    // as interval is at least a tick (timers within one tick come back in no particular order).
+    template<typename T>
+    class Throttle final {
+    public:
+        Throttle(Nanos interval, std::size_t burst, std::size_t max_deferred, Nanos tick = TW_DEFAULT_TICK, Nanos now = getCurrentNanos())
+            : bucket_{interval, burst}, deferred_{max_deferred, tick, now}, max_deferred_{max_deferred} {
+        }
+
+        Throttle() = delete;
+        Throttle(const Throttle&) = delete;
+        Throttle(const Throttle&&) = delete;
+        Throttle& operator=(const Throttle&) = delete;
+        Throttle& operator=(const Throttle&&) = delete;
+
+        auto submit(Nanos now, const T& payload) noexcept {
+            // anything deferred goes first, so a free token now still queues behind it
+            if (!deferred_.size() && bucket_.try_acquire(now))
+                return ThrottleResult::SEND;
+            if (deferred_.size() == max_deferred_)
+                return ThrottleResult::REJECTED;
+            deferred_.schedule(bucket_.reserve(now), payload);
+            return ThrottleResult::DEFERRED;
+        }
+
+        // f(T&) for every deferred payload whose time came
+        template<typename F>
+        auto poll(Nanos now, F&& f) noexcept { return deferred_.advance(now, std::forward<F>(f)); }
+
+        auto num_deferred() const noexcept { return deferred_.size(); }
+        auto available_at(Nanos now) const noexcept { return bucket_.available_at(now); }
+
+    private:
+        TokenBucket bucket_;
+        TimerWheel<T> deferred_;
+        const std::size_t max_deferred_;
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace Common {
+
+    // sizing limits shared between the exchange and the trading side, everything is pre-allocated from these
+    constexpr std::size_t ME_MAX_TICKERS = 8;
+    constexpr std::size_t ME_MAX_CLIENT_UPDATES = 256 * 1024;
+    constexpr std::size_t ME_MAX_MARKET_UPDATES = 256 * 1024;
+    constexpr std::size_t ME_MAX_NUM_CLIENTS = 256;
+    constexpr std::size_t ME_MAX_ORDER_IDS = 1024 * 1024;
+    constexpr std::size_t ME_MAX_PRICE_LEVELS = 256;
+
+    using OrderId = uint64_t;
+    constexpr auto OrderId_INVALID = std::numeric_limits<OrderId>::max();
+
+    using TickerId = uint32_t;
+    constexpr auto TickerId_INVALID = std::numeric_limits<TickerId>::max();
+
+    using ClientId = uint32_t;
+    constexpr auto ClientId_INVALID = std::numeric_limits<ClientId>::max();
+
+    // prices are integer ticks, never floating point
+    using Price = int64_t;
+    constexpr auto Price_INVALID = std::numeric_limits<Price>::max();
+
+    using Qty = uint32_t;
+    constexpr auto Qty_INVALID = std::numeric_limits<Qty>::max();
+
+    // a trading strategy inside one client, positions and pnl are kept per strategy
+    using StrategyId = uint32_t;
+    constexpr auto StrategyId_INVALID = std::numeric_limits<StrategyId>::max();
+
+    // position of an order in the FIFO queue at its price level
+    using Priority = uint64_t;
+    constexpr auto Priority_INVALID = std::numeric_limits<Priority>::max();
+
+    enum class Side : int8_t {
+        INVALID = 0,
+        BUY = 1,
+        SELL = -1
+    };
+
+    template <typename T>
+    inline auto to_string_or_invalid(T value, T invalid) {
+        return (value == invalid) ? std::string{"INVALID"} : std::to_string(value);
+    }
+
+    inline auto order_id_to_string(OrderId order_id) { return to_string_or_invalid(order_id, OrderId_INVALID); }
+    inline auto ticker_id_to_string(TickerId ticker_id) { return to_string_or_invalid(ticker_id, TickerId_INVALID); }
+    inline auto client_id_to_string(ClientId client_id) { return to_string_or_invalid(client_id, ClientId_INVALID); }
+    inline auto price_to_string(Price price) { return to_string_or_invalid(price, Price_INVALID); }
+    inline auto qty_to_string(Qty qty) { return to_string_or_invalid(qty, Qty_INVALID); }
+    inline auto priority_to_string(Priority priority) { return to_string_or_invalid(priority, Priority_INVALID); }
+    inline auto strategy_id_to_string(StrategyId strategy_id) { return to_string_or_invalid(strategy_id, StrategyId_INVALID); }
+
+    inline std::string side_to_string(Side side) {
+        switch (side) {
+            case Side::BUY:
+                return "BUY";
+            case Side::SELL:
+                return "SELL";
+            case Side::INVALID:
+                return "INVALID";
+        }
+        return "UNKNOWN";
+    }
+
+    // +1 for buys, -1 for sells, handy for signed position / pnl arithmetic
+    inline constexpr auto side_to_value(Side side) noexcept {
+        return static_cast<int>(side);
+    }
+}
@@ -0,0 +1,286 @@
+#include "xdp_socket.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+
+namespace Common {
+
+    namespace {
+        inline long sys_bpf(int cmd, bpf_attr* attr) noexcept {
+            return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+        }
+
+        // minimal eBPF instruction encoders, just the forms the filter program below needs
+        constexpr bpf_insn mov64_reg(uint8_t dst, uint8_t src) { return {BPF_ALU64 | BPF_MOV | BPF_X, dst, src, 0, 0}; }
+        constexpr bpf_insn mov64_imm(uint8_t dst, int32_t imm) { return {BPF_ALU64 | BPF_MOV | BPF_K, dst, 0, 0, imm}; }
+        constexpr bpf_insn add64_imm(uint8_t dst, int32_t imm) { return {BPF_ALU64 | BPF_ADD | BPF_K, dst, 0, 0, imm}; }
+        constexpr bpf_insn ldx_mem(uint8_t size, uint8_t dst, uint8_t src, int16_t off) { return {static_cast<uint8_t>(BPF_LDX | size | BPF_MEM), dst, src, off, 0}; }
+        constexpr bpf_insn jgt_reg(uint8_t dst, uint8_t src, int16_t off) { return {BPF_JMP | BPF_JGT | BPF_X, dst, src, off, 0}; }
+        constexpr bpf_insn jne32_imm(uint8_t dst, int32_t imm, int16_t off) { return {BPF_JMP32 | BPF_JNE | BPF_K, dst, 0, off, imm}; }
+        constexpr bpf_insn call(int32_t func) { return {BPF_JMP | BPF_CALL, 0, 0, 0, func}; }
+        constexpr bpf_insn exit_insn() { return {BPF_JMP | BPF_EXIT, 0, 0, 0, 0}; }
+
+        // 64 bit immediate load of a map fd, takes two instruction slots
+        constexpr bpf_insn ld_map_fd_lo(uint8_t dst, int fd) { return {BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0, fd}; }
+        constexpr bpf_insn ld_map_fd_hi() { return {0, 0, 0, 0, 0}; }
+    }
+
+    XdpSocket::~XdpSocket() {
+        cleanup();
+    }
+
+    auto XdpSocket::init(const std::string& ip, const std::string& iface, int port, uint32_t queue_id) -> bool {
+        const auto ifindex = static_cast<int>(if_nametoindex(iface.c_str()));
+        if (!ifindex) {
+            logger_.log("%:% %() % no such interface:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), iface);
+            return false;
+        }
+
+        if (!load_program(ip, port, XDP_PASS)) {
+            cleanup();
+            return false;
+        }
+
+        // driver hook first, then the generic (SKB) hook. The program is attached before any socket is bound: a socket
+        // that bound a queue in copy mode holds it until the kernel's deferred teardown, so binding a second one right
+        // after the first failed to attach comes back EBUSY. A zero copy bind the driver refuses releases the queue
+        // straight away, so only the copy mode socket ever has to be bound for good.
+        for (const auto driver_mode : {true, false}) {
+            if (!attach_program(ifindex, driver_mode)) {
+                logger_.log("%:% %() % XDP driver_mode:% unavailable on iface:% errno:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), static_cast<int>(driver_mode), iface, std::string{strerror(errno)});
+                continue;
+            }
+            // zero copy needs the driver hook, copy mode works with either
+            for (const auto zero_copy : {true, false}) {
+                if (zero_copy && !driver_mode)
+                    continue;
+                xsk_fd_ = socket(AF_XDP, SOCK_RAW, 0);
+                if (xsk_fd_ >= 0 && setup_umem_and_rings() && bind_socket(ifindex, queue_id, zero_copy)) {
+                    logger_.log("%:% %() % AF_XDP socket:% iface:% queue:% zero_copy:% driver_mode:%\n", __FILE__, __LINE__, __FUNCTION__,
+                        Common::get_current_time_str(time_str_), xsk_fd_, iface, queue_id, static_cast<int>(zero_copy_), static_cast<int>(driver_mode_));
+                    return true;
+                }
+                logger_.log("%:% %() % AF_XDP zero_copy:% driver_mode:% unavailable on iface:% queue:% errno:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), static_cast<int>(zero_copy), static_cast<int>(driver_mode), iface, queue_id,
+                    std::string{strerror(errno)});
+                close_socket();
+            }
+            close(link_fd_);
+            link_fd_ = -1;
+        }
+        cleanup();
+        return false;
+    }
+
+    auto XdpSocket::setup_umem_and_rings() -> bool {
+        umem_size_ = static_cast<std::size_t>(XDP_FRAME_SIZE) * XDP_NUM_FRAMES;
+        auto area = mmap(nullptr, umem_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (area == MAP_FAILED)
+            return false;
+        umem_area_ = reinterpret_cast<char*>(area);
+
+        xdp_umem_reg umem_reg{};
+        umem_reg.addr = reinterpret_cast<uint64_t>(umem_area_);
+        umem_reg.len = umem_size_;
+        umem_reg.chunk_size = XDP_FRAME_SIZE;
+        umem_reg.headroom = 0;
+        if (setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_REG, &umem_reg, sizeof(umem_reg)))
+            return false;
+
+        // the completion ring is only used for tx but the kernel insists on one per umem
+        uint32_t ring_size = XDP_NUM_FRAMES;
+        if (setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_FILL_RING, &ring_size, sizeof(ring_size)) ||
+            setsockopt(xsk_fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) ||
+            setsockopt(xsk_fd_, SOL_XDP, XDP_RX_RING, &ring_size, sizeof(ring_size)))
+            return false;
+
+        xdp_mmap_offsets offsets{};
+        socklen_t optlen = sizeof(offsets);
+        if (getsockopt(xsk_fd_, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &optlen))
+            return false;
+
+        auto map_ring = [this, ring_size](Ring& ring, const xdp_ring_offset& off, std::size_t desc_size, off_t pgoff) {
+            ring.map_len_ = off.desc + ring_size * desc_size;
+            ring.map_ = mmap(nullptr, ring.map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, xsk_fd_, pgoff);
+            if (ring.map_ == MAP_FAILED) {
+                ring.map_ = nullptr;
+                return false;
+            }
+            auto base = reinterpret_cast<char*>(ring.map_);
+            ring.producer_ = reinterpret_cast<uint32_t*>(base + off.producer);
+            ring.consumer_ = reinterpret_cast<uint32_t*>(base + off.consumer);
+            ring.flags_ = reinterpret_cast<uint32_t*>(base + off.flags);
+            ring.ring_ = base + off.desc;
+            ring.mask_ = ring_size - 1;
+            return true;
+        };
+
+        if (!map_ring(fill_, offsets.fr, sizeof(uint64_t), XDP_UMEM_PGOFF_FILL_RING) ||
+            !map_ring(completion_, offsets.cr, sizeof(uint64_t), XDP_UMEM_PGOFF_COMPLETION_RING) ||
+            !map_ring(rx_, offsets.rx, sizeof(xdp_desc), XDP_PGOFF_RX_RING))
+            return false;
+
+        // hand every frame to the kernel up front
+        auto addrs = reinterpret_cast<uint64_t*>(fill_.ring_);
+        for (uint32_t i = 0; i < XDP_NUM_FRAMES; ++i)
+            addrs[i] = static_cast<uint64_t>(i) * XDP_FRAME_SIZE;
+        __atomic_store_n(fill_.producer_, XDP_NUM_FRAMES, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    auto XdpSocket::bind_socket(int ifindex, uint32_t queue_id, bool zero_copy) -> bool {
+        sockaddr_xdp addr{};
+        addr.sxdp_family = AF_XDP;
+        addr.sxdp_ifindex = ifindex;
+        addr.sxdp_queue_id = queue_id;
+        addr.sxdp_flags = (zero_copy ? XDP_ZEROCOPY : XDP_COPY) | XDP_USE_NEED_WAKEUP;
+        if (bind(xsk_fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)))
+            return false;
+        zero_copy_ = zero_copy;
+
+        // from here on the program redirects the flow on queue_id into this socket
+        bpf_attr update_attr{};
+        update_attr.map_fd = map_fd_;
+        update_attr.key = reinterpret_cast<uint64_t>(&queue_id);
+        update_attr.value = reinterpret_cast<uint64_t>(&xsk_fd_);
+        return !sys_bpf(BPF_MAP_UPDATE_ELEM, &update_attr);
+    }
+
+    // XDP_PASS everything except IPv4 / UDP to ip:port, which is redirected into the AF_XDP socket bound to the rx queue
+    auto XdpSocket::load_program(const std::string& ip, int port, uint32_t no_socket_action) -> bool {
+        bpf_attr map_attr{};
+        map_attr.map_type = BPF_MAP_TYPE_XSKMAP;
+        map_attr.key_size = sizeof(uint32_t);
+        map_attr.value_size = sizeof(int);
+        map_attr.max_entries = 64;
+        map_fd_ = static_cast<int>(sys_bpf(BPF_MAP_CREATE, &map_attr));
+        if (map_fd_ < 0)
+            return false;
+
+        // packet bytes are compared as loaded, i.e. network order reinterpreted as little endian
+        in_addr group{};
+        if (inet_pton(AF_INET, ip.c_str(), &group) != 1)
+            return false;
+        const auto group_imm = static_cast<int32_t>(group.s_addr);
+        const auto port_imm = static_cast<int32_t>(htons(static_cast<uint16_t>(port)));
+
+        constexpr int16_t PASS = 0; // placeholder, patched below once the program length is known
+        bpf_insn prog[] = {
+            mov64_reg(BPF_REG_6, BPF_REG_1),                                        // r6 = ctx
+            ldx_mem(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, data)),           // r2 = data
+            ldx_mem(BPF_W, BPF_REG_3, BPF_REG_6, offsetof(xdp_md, data_end)),       // r3 = data_end
+            mov64_reg(BPF_REG_4, BPF_REG_2),
+            add64_imm(BPF_REG_4, XDP_UDP_PAYLOAD_OFFSET),
+            jgt_reg(BPF_REG_4, BPF_REG_3, PASS),                                    // too short for eth + ip + udp
+            ldx_mem(BPF_H, BPF_REG_4, BPF_REG_2, 12),
+            jne32_imm(BPF_REG_4, htons(0x0800), PASS),                              // ethertype IPv4
+            ldx_mem(BPF_B, BPF_REG_4, BPF_REG_2, 14),
+            jne32_imm(BPF_REG_4, 0x45, PASS),                                       // version 4, no ip options
+            ldx_mem(BPF_B, BPF_REG_4, BPF_REG_2, 23),
+            jne32_imm(BPF_REG_4, IPPROTO_UDP, PASS),
+            ldx_mem(BPF_W, BPF_REG_4, BPF_REG_2, 30),
+            jne32_imm(BPF_REG_4, group_imm, PASS),                                  // destination group
+            ldx_mem(BPF_H, BPF_REG_4, BPF_REG_2, 36),
+            jne32_imm(BPF_REG_4, port_imm, PASS),                                   // destination port
+            ldx_mem(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(xdp_md, rx_queue_index)), // key = rx queue
+            ld_map_fd_lo(BPF_REG_1, map_fd_),
+            ld_map_fd_hi(),
+            mov64_imm(BPF_REG_3, static_cast<int32_t>(no_socket_action)),          // no socket on this queue -> stack
+            call(BPF_FUNC_redirect_map),
+            exit_insn(),
+            mov64_imm(BPF_REG_0, XDP_PASS),                                         // pass:
+            exit_insn(),
+        };
+        constexpr auto num_insns = sizeof(prog) / sizeof(prog[0]);
+        constexpr auto pass_index = num_insns - 2;
+
+        for (std::size_t i = 0; i < num_insns; ++i) {
+            const auto code = prog[i].code;
+            if (BPF_OP(code) == BPF_JGT || BPF_OP(code) == BPF_JNE)
+                if (BPF_CLASS(code) == BPF_JMP || BPF_CLASS(code) == BPF_JMP32)
+                    prog[i].off = static_cast<int16_t>(pass_index - i - 1);
+        }
+
+        static const char license[] = "GPL";
+        char verifier_log[4096] = {'\0'};
+
+        bpf_attr prog_attr{};
+        prog_attr.prog_type = BPF_PROG_TYPE_XDP;
+        prog_attr.expected_attach_type = BPF_XDP;
+        prog_attr.insn_cnt = num_insns;
+        prog_attr.insns = reinterpret_cast<uint64_t>(prog);
+        prog_attr.license = reinterpret_cast<uint64_t>(license);
+        prog_attr.log_level = 1;
+        prog_attr.log_size = sizeof(verifier_log);
+        prog_attr.log_buf = reinterpret_cast<uint64_t>(verifier_log);
+        prog_fd_ = static_cast<int>(sys_bpf(BPF_PROG_LOAD, &prog_attr));
+        if (prog_fd_ < 0) {
+            logger_.log("%:% %() % BPF_PROG_LOAD failed:%\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), verifier_log);
+            return false;
+        }
+        return true;
+    }
+
+    auto XdpSocket::test_filter(Logger& logger, const std::string& ip, int port, const void* frame, uint32_t len,
+                                uint32_t no_socket_action) -> int {
+        XdpSocket socket(logger);
+        if (!socket.load_program(ip, port, no_socket_action))
+            return -1;
+
+        bpf_attr test_attr{};
+        test_attr.test.prog_fd = static_cast<uint32_t>(socket.prog_fd_);
+        test_attr.test.data_in = reinterpret_cast<uint64_t>(frame);
+        test_attr.test.data_size_in = len;
+        test_attr.test.repeat = 1;
+        if (sys_bpf(BPF_PROG_TEST_RUN, &test_attr) != 0)
+            return -1;
+        return static_cast<int>(test_attr.test.retval);
+    }
+
+    auto XdpSocket::attach_program(int ifindex, bool driver_mode) -> bool {
+        // a bpf link detaches by itself when the fd is closed, including when the process dies. Until a socket is in
+        // the map the redirect falls back to XDP_PASS, nothing is lost in between
+        bpf_attr link_attr{};
+        link_attr.link_create.prog_fd = prog_fd_;
+        link_attr.link_create.target_ifindex = ifindex;
+        link_attr.link_create.attach_type = BPF_XDP;
+        link_attr.link_create.flags = driver_mode ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+        link_fd_ = static_cast<int>(sys_bpf(BPF_LINK_CREATE, &link_attr));
+        driver_mode_ = driver_mode;
+        return link_fd_ >= 0;
+    }
+
+    void XdpSocket::close_socket() noexcept {
+        for (auto ring : {&fill_, &completion_, &rx_}) {
+            if (ring->map_)
+                munmap(ring->map_, ring->map_len_);
+            *ring = {};
+        }
+        if (xsk_fd_ >= 0) close(xsk_fd_);
+        if (umem_area_)
+            munmap(umem_area_, umem_size_);
+
+        xsk_fd_ = -1;
+        umem_area_ = nullptr;
+        umem_size_ = 0;
+        zero_copy_ = false;
+    }
+
+    void XdpSocket::cleanup() noexcept {
+        if (link_fd_ >= 0) close(link_fd_);
+        if (prog_fd_ >= 0) close(prog_fd_);
+        if (map_fd_ >= 0) close(map_fd_);
+        close_socket();
+
+        link_fd_ = prog_fd_ = map_fd_ = -1;
+        driver_mode_ = false;
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/if_xdp.h>
+
+#include "macros.h"
+#include "logging.h"
+
+namespace Common {
+
+    /// UMEM frame size and number of frames, the fill and rx rings are sized to hold every frame.
+    constexpr uint32_t XDP_FRAME_SIZE = 4096;
+    constexpr uint32_t XDP_NUM_FRAMES = 4096;
+
+    /// ethernet + IPv4 (no options, the XDP program only redirects ihl == 5) + UDP header.
+    constexpr uint32_t XDP_UDP_HEADER_OFFSET = 14 + 20;
+    constexpr uint32_t XDP_UDP_PAYLOAD_OFFSET = XDP_UDP_HEADER_OFFSET + 8;
+
+    /// Receive-only AF_XDP socket for a single multicast group / port on one interface queue.
+    /// A small XDP program redirects only the matching UDP flow arriving on that queue into the socket, everything else,
+    /// including the same flow on any other rx queue, goes on to the kernel stack. Steer the flow to queue_id (ethtool
+    /// ntuple / flow rules) to get it all through here, the caller keeps reading the regular socket for the rest.
+    /// Frames live in a UMEM shared with the kernel and UDP payloads are handed to the caller in place.
+    /// Built on raw syscalls and the kernel uapi headers only, no libbpf / libxdp dependency.
+    struct XdpSocket {
+        explicit XdpSocket(Logger& logger) : logger_(logger) {}
+        ~XdpSocket();
+
+        XdpSocket() = delete;
+        XdpSocket(const XdpSocket&) = delete;
+        XdpSocket& operator=(const XdpSocket&) = delete;
+        XdpSocket(XdpSocket&&) = delete;
+        XdpSocket& operator=(XdpSocket&&) = delete;
+
+        /// Set up UMEM, rings, the filter program and attach it. Tries native (driver) mode with zero copy first, then
+        /// native mode with copy, then generic (SKB) mode with copy, so a veth pair is enough for testing. Returns false if XDP is not usable, the caller
+        /// then stays on the regular socket path. Only one program per interface, so only one XDP backed socket per
+        /// interface.
+        auto init(const std::string& ip, const std::string& iface, int port, uint32_t queue_id = 0) -> bool;
+
+        /// Hand every UDP payload currently in the rx ring to f(char* data, size_t len) in place, then recycle the frames.
+        /// The length comes from the UDP header, frames can carry Ethernet trailer padding past the datagram.
+        template <typename F>
+        auto recv_batch(F&& f) noexcept -> uint32_t {
+            const auto prod = __atomic_load_n(rx_.producer_, __ATOMIC_ACQUIRE);
+            const auto cons = *rx_.consumer_;
+            const auto n = prod - cons;
+            if (!n) {
+                kick_fill_ring();
+                return 0;
+            }
+
+            auto descs = reinterpret_cast<const xdp_desc*>(rx_.ring_);
+            auto addrs = reinterpret_cast<uint64_t*>(fill_.ring_);
+            const auto fill_prod = *fill_.producer_;
+
+            for (uint32_t i = 0; i < n; ++i) {
+                const auto& desc = descs[(cons + i) & rx_.mask_];
+                const auto frame = umem_area_ + desc.addr;
+                const auto payload_len = udp_payload_len(frame, desc.len);
+                if (LIKELY(payload_len >= 0))
+                    f(frame + XDP_UDP_PAYLOAD_OFFSET, static_cast<std::size_t>(payload_len));
+                addrs[(fill_prod + i) & fill_.mask_] = desc.addr & ~static_cast<uint64_t>(XDP_FRAME_SIZE - 1);
+            }
+
+            __atomic_store_n(rx_.consumer_, cons + n, __ATOMIC_RELEASE);
+            __atomic_store_n(fill_.producer_, fill_prod + n, __ATOMIC_RELEASE);
+            kick_fill_ring();
+            return n;
+        }
+
+        /// UDP payload length of a frame the program redirected (it checked the frame holds the headers), from the UDP
+        /// header since frames can carry Ethernet trailer padding. -1 for a UDP length shorter than its header or longer
+        /// than the frame, recv_batch() drops those.
+        static auto udp_payload_len(const char* frame, uint32_t frame_len) noexcept -> int32_t {
+            uint16_t udp_len;
+            memcpy(&udp_len, frame + XDP_UDP_HEADER_OFFSET + 4, sizeof(udp_len));
+            udp_len = ntohs(udp_len);
+            if (udp_len < 8 || udp_len - 8u > frame_len - XDP_UDP_PAYLOAD_OFFSET)
+                return -1;
+            return udp_len - 8;
+        }
+
+        /// Run the filter program for ip:port over one frame with BPF_PROG_TEST_RUN, nothing is attached or bound. With no
+        /// socket in the map a matching frame gets no_socket_action (XDP_PASS in init()), anything else XDP_PASS.
+        /// Returns the program's verdict, -1 if it could not be loaded or run, e.g. without CAP_BPF. For tests.
+        static auto test_filter(Logger& logger, const std::string& ip, int port, const void* frame, uint32_t len,
+                                uint32_t no_socket_action) -> int;
+
+        auto is_zero_copy() const noexcept { return zero_copy_; }
+        auto is_driver_mode() const noexcept { return driver_mode_; }
+
+    private:
+        struct Ring {
+            uint32_t* producer_ = nullptr;
+            uint32_t* consumer_ = nullptr;
+            uint32_t* flags_ = nullptr;
+            void* ring_ = nullptr;
+            uint32_t mask_ = 0;
+            void* map_ = nullptr;
+            std::size_t map_len_ = 0;
+        };
+
+        int xsk_fd_ = -1;
+        int map_fd_ = -1;
+        int prog_fd_ = -1;
+        int link_fd_ = -1;
+        bool zero_copy_ = false;
+        bool driver_mode_ = false;
+
+        char* umem_area_ = nullptr;
+        std::size_t umem_size_ = 0;
+
+        Ring fill_;
+        Ring completion_;
+        Ring rx_;
+
+        std::string time_str_;
+        Logger& logger_;
+
+        // in need_wakeup mode the driver stops pulling from the fill ring until poked
+        auto kick_fill_ring() noexcept {
+            if (UNLIKELY(__atomic_load_n(fill_.flags_, __ATOMIC_RELAXED) & XDP_RING_NEED_WAKEUP))
+                recvfrom(xsk_fd_, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+        }
+
+        auto setup_umem_and_rings() -> bool;
+        auto bind_socket(int ifindex, uint32_t queue_id, bool zero_copy) -> bool;
+        auto load_program(const std::string& ip, int port, uint32_t no_socket_action) -> bool;
+        auto attach_program(int ifindex, bool driver_mode) -> bool;
+        void close_socket() noexcept;
+        void cleanup() noexcept;
+    };
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <sstream>
+
+#include "common/types.h"
+#include "common/lock_free_queue.h"
+
+namespace Exchange {
+
+    enum class MarketUpdateType : uint8_t {
+        INVALID = 0,
+        CLEAR = 1,
+        ADD = 2,
+        MODIFY = 3,
+        CANCEL = 4,
+        TRADE = 5,
+        SNAPSHOT_START = 6,
+        SNAPSHOT_END = 7
+    };
+
+    inline std::string market_update_type_to_string(MarketUpdateType type) {
+        switch (type) {
+            case MarketUpdateType::CLEAR:
+                return "CLEAR";
+            case MarketUpdateType::ADD:
+                return "ADD";
+            case MarketUpdateType::MODIFY:
+                return "MODIFY";
+            case MarketUpdateType::CANCEL:
+                return "CANCEL";
+            case MarketUpdateType::TRADE:
+                return "TRADE";
+            case MarketUpdateType::SNAPSHOT_START:
+                return "SNAPSHOT_START";
+            case MarketUpdateType::SNAPSHOT_END:
+                return "SNAPSHOT_END";
+            case MarketUpdateType::INVALID:
+                return "INVALID";
+        }
+        return "UNKNOWN";
+    }
+
+    // wire structs are packed, they are written to / read from the multicast buffers as is
+#pragma pack(push, 1)
+
+    struct MEMarketUpdate {
+        MarketUpdateType type_ = MarketUpdateType::INVALID;
+
+        Common::OrderId order_id_ = Common::OrderId_INVALID;
+        Common::TickerId ticker_id_ = Common::TickerId_INVALID;
+        Common::Side side_ = Common::Side::INVALID;
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty qty_ = Common::Qty_INVALID;
+        Common::Priority priority_ = Common::Priority_INVALID;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "MEMarketUpdate["
+               << " type:" << market_update_type_to_string(type_)
+               << " ticker:" << Common::ticker_id_to_string(ticker_id_)
+               << " oid:" << Common::order_id_to_string(order_id_)
+               << " side:" << Common::side_to_string(side_)
+               << " qty:" << Common::qty_to_string(qty_)
+               << " price:" << Common::price_to_string(price_)
+               << " priority:" << Common::priority_to_string(priority_)
+               << "]";
+            return ss.str();
+        }
+    };
+
+    // market update as published on the incremental and snapshot multicast streams
+    // incremental seq numbers start at 1 and have no gaps, snapshot seq numbers restart at 0 for every snapshot cycle
+    // SNAPSHOT_START / SNAPSHOT_END carry the last incremental seq number the snapshot covers in order_id_
+    struct MDPMarketUpdate {
+        std::size_t seq_num_ = 0;
+        MEMarketUpdate me_market_update_;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "MDPMarketUpdate [ seq:" << seq_num_ << " " << me_market_update_.to_string() << "]";
+            return ss.str();
+        }
+    };
+
+#pragma pack(pop)
+
+    using MEMarketUpdateLFQueue = Common::LockFreeQueue<MEMarketUpdate>;
+    using MDPMarketUpdateLFQueue = Common::LockFreeQueue<MDPMarketUpdate>;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <sstream>
+
+#include "common/types.h"
+#include "common/lock_free_queue.h"
+
+namespace Exchange {
+
+    enum class ClientRequestType : uint8_t {
+        INVALID = 0,
+        NEW = 1,
+        CANCEL = 2,
+        HEARTBEAT = 3
+    };
+
+    inline std::string client_request_type_to_string(ClientRequestType type) {
+        switch (type) {
+            case ClientRequestType::NEW:
+                return "NEW";
+            case ClientRequestType::CANCEL:
+                return "CANCEL";
+            case ClientRequestType::HEARTBEAT:
+                return "HEARTBEAT";
+            case ClientRequestType::INVALID:
+                return "INVALID";
+        }
+        return "UNKNOWN";
+    }
+
+#pragma pack(push, 1)
+
+    struct MEClientRequest {
+        ClientRequestType type_ = ClientRequestType::INVALID;
+
+        Common::ClientId client_id_ = Common::ClientId_INVALID;
+        Common::TickerId ticker_id_ = Common::TickerId_INVALID;
+        Common::OrderId order_id_ = Common::OrderId_INVALID;
+        Common::Side side_ = Common::Side::INVALID;
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty qty_ = Common::Qty_INVALID;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "MEClientRequest ["
+               << "type:" << client_request_type_to_string(type_)
+               << " client:" << Common::client_id_to_string(client_id_)
+               << " ticker:" << Common::ticker_id_to_string(ticker_id_)
+               << " oid:" << Common::order_id_to_string(order_id_)
+               << " side:" << Common::side_to_string(side_)
+               << " qty:" << Common::qty_to_string(qty_)
+               << " price:" << Common::price_to_string(price_)
+               << "]";
+            return ss.str();
+        }
+    };
+
+    // request as sent over the order gateway TCP session, seq numbers start at 1 for the client and carry on across
+    // reconnects (and, recovered from the order journal, across restarts) so requests can be replayed by seq number
+    // heartbeats are not sequenced, they carry the last seq number sent so the exchange can spot a gap while idle
+    struct OMClientRequest {
+        std::size_t seq_num_ = 0;
+        MEClientRequest me_client_request_;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "OMClientRequest [ seq:" << seq_num_ << " " << me_client_request_.to_string() << "]";
+            return ss.str();
+        }
+    };
+
+#pragma pack(pop)
+
+    using ClientRequestLFQueue = Common::LockFreeQueue<MEClientRequest>;
+}
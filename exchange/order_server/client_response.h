@@ -0,0 +1,83 @@
+#pragma once
+
+#include <sstream>
+
+#include "common/types.h"
+#include "common/lock_free_queue.h"
+
+namespace Exchange {
+
+    enum class ClientResponseType : uint8_t {
+        INVALID = 0,
+        ACCEPTED = 1,
+        CANCELED = 2,
+        FILLED = 3,
+        CANCEL_REJECTED = 4,
+        HEARTBEAT = 5
+    };
+
+    inline std::string client_response_type_to_string(ClientResponseType type) {
+        switch (type) {
+            case ClientResponseType::ACCEPTED:
+                return "ACCEPTED";
+            case ClientResponseType::CANCELED:
+                return "CANCELED";
+            case ClientResponseType::FILLED:
+                return "FILLED";
+            case ClientResponseType::CANCEL_REJECTED:
+                return "CANCEL_REJECTED";
+            case ClientResponseType::HEARTBEAT:
+                return "HEARTBEAT";
+            case ClientResponseType::INVALID:
+                return "INVALID";
+        }
+        return "UNKNOWN";
+    }
+
+#pragma pack(push, 1)
+
+    struct MEClientResponse {
+        ClientResponseType type_ = ClientResponseType::INVALID;
+
+        Common::ClientId client_id_ = Common::ClientId_INVALID;
+        Common::TickerId ticker_id_ = Common::TickerId_INVALID;
+        Common::OrderId client_order_id_ = Common::OrderId_INVALID;
+        Common::OrderId market_order_id_ = Common::OrderId_INVALID;
+        Common::Side side_ = Common::Side::INVALID;
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty exec_qty_ = Common::Qty_INVALID;
+        Common::Qty leaves_qty_ = Common::Qty_INVALID;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "MEClientResponse ["
+               << "type:" << client_response_type_to_string(type_)
+               << " client:" << Common::client_id_to_string(client_id_)
+               << " ticker:" << Common::ticker_id_to_string(ticker_id_)
+               << " coid:" << Common::order_id_to_string(client_order_id_)
+               << " moid:" << Common::order_id_to_string(market_order_id_)
+               << " side:" << Common::side_to_string(side_)
+               << " exec_qty:" << Common::qty_to_string(exec_qty_)
+               << " leaves_qty:" << Common::qty_to_string(leaves_qty_)
+               << " price:" << Common::price_to_string(price_)
+               << "]";
+            return ss.str();
+        }
+    };
+
+    // response as sent back over the order gateway TCP session, the exchange keeps its own seq numbers per session
+    struct OMClientResponse {
+        std::size_t seq_num_ = 0;
+        MEClientResponse me_client_response_;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "OMClientResponse [ seq:" << seq_num_ << " " << me_client_response_.to_string() << "]";
+            return ss.str();
+        }
+    };
+
+#pragma pack(pop)
+
+    using ClientResponseLFQueue = Common::LockFreeQueue<MEClientResponse>;
+}
@@ -0,0 +1,307 @@
+#include "exchange_simulator.h"
+
+#include "common/journal.h"
+
+namespace Exchange {
+
+    ExchangeSimulator::ExchangeSimulator(const SimulatorConfig& config)
+        : config_{config}, logger_{"exchange_simulator.log"}, incremental_socket_{logger_}, snapshot_socket_{logger_},
+          order_server_{logger_}, instruments_(config.num_instruments_), rng_{config.seed_}, trigger_times_(TRIGGER_TIMES_SIZE, 0) {
+        // the trading side pre-encodes its requests per ticker, it cannot trade more than ME_MAX_TICKERS
+        ASSERT(config_.num_instruments_ && config_.num_instruments_ <= Common::ME_MAX_TICKERS,
+            "ExchangeSimulator num_instruments has to be in [1, " + std::to_string(Common::ME_MAX_TICKERS) + "]");
+        ASSERT(config_.burst_size_ && config_.trigger_every_, "ExchangeSimulator burst_size and trigger_every must not be 0.");
+
+        for (std::size_t ticker_id = 0; ticker_id < instruments_.size(); ++ticker_id) {
+            instruments_[ticker_id].mid_ = static_cast<Common::Price>(1000 + 100 * ticker_id);
+            instruments_[ticker_id].client_orders_.reserve(1024);
+        }
+
+        if (!config_.replay_name_.empty()) {
+            const auto result = Common::Journal<MEMarketUpdate>::replay(config_.replay_dir_, config_.replay_name_,
+                [this](const auto& record) { replay_updates_.push_back(record.event_); });
+            ASSERT(!replay_updates_.empty(), "ExchangeSimulator nothing to replay in " + config_.replay_dir_ + "/" + config_.replay_name_);
+            logger_.log("%:% %() % loaded % updates from % segments for replay\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::get_current_time_str(time_str_), result.records_, result.segments_);
+        }
+
+        ASSERT(incremental_socket_.init(config_.incremental_ip_, config_.iface_, config_.incremental_port_, false) >= 0,
+            "Unable to create incremental mcast socket. error: " + std::string{strerror(errno)});
+        ASSERT(snapshot_socket_.init(config_.snapshot_ip_, config_.iface_, config_.snapshot_port_, false) >= 0,
+            "Unable to create snapshot mcast socket. error: " + std::string{strerror(errno)});
+
+        order_server_.recv_callback_ = [this](auto socket, auto rx_time) { on_order_data(socket, rx_time); };
+        order_server_.recv_finished_callback_ = []() {};
+        order_server_.listen(config_.iface_, config_.order_port_, true);
+    }
+
+    ExchangeSimulator::~ExchangeSimulator() {
+        for (auto& session : sessions_)
+            close(session.socket_->socket_fd_);
+        close(order_server_.listener_socket_.socket_fd_);
+        close(order_server_.epoll_fd_);
+        close(incremental_socket_.socket_fd_);
+        close(snapshot_socket_.socket_fd_);
+    }
+
+    void ExchangeSimulator::run() noexcept {
+        logger_.log("%:% %() % instruments:% rate:% burst:% trigger_every:% triggers:%\n", __FILE__, __LINE__, __FUNCTION__,
+            Common::get_current_time_str(time_str_), config_.num_instruments_, config_.message_rate_, config_.burst_size_,
+            config_.trigger_every_, config_.num_triggers_);
+
+        running_ = true;
+        while (running_ && !done())
+            poll();
+
+        logger_.log("%:% %() % %\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_), stats_.to_string());
+    }
+
+    void ExchangeSimulator::poll() noexcept {
+        order_server_.poll();
+        order_server_.send_and_recv();
+
+        if (!publishing())
+            return;
+
+        const auto now = Common::getCurrentNanos();
+        if (now >= next_burst_time_)
+            publish_burst(now);
+
+        if (replay_updates_.empty() && config_.snapshot_interval_ && now >= next_snapshot_time_) {
+            publish_snapshot();
+            next_snapshot_time_ = now + config_.snapshot_interval_;
+        }
+    }
+
+    void ExchangeSimulator::publish_burst(Common::Nanos now) noexcept {
+        for (std::size_t i = 0; i < config_.burst_size_ && publishing(); ++i) {
+            auto update = replay_updates_.empty() ? next_synthetic_update() : replay_updates_[next_replay_index_++ % replay_updates_.size()];
+            if (update.type_ == MarketUpdateType::TRADE)
+                send_trigger(update);
+            else
+                publish(update);
+        }
+        flush_incremental();
+
+        // a burst that went out late does not make the next one early, the shape is kept and the rate gives
+        if (config_.message_rate_ > 0) {
+            next_burst_time_ += static_cast<Common::Nanos>(static_cast<double>(config_.burst_size_) * 1e9 / config_.message_rate_);
+            if (next_burst_time_ < now)
+                next_burst_time_ = now;
+        }
+    }
+
+    void ExchangeSimulator::publish(const MEMarketUpdate& update) noexcept {
+        const MDPMarketUpdate mdp_update{next_inc_seq_num_++, update};
+        incremental_socket_.send(&mdp_update, sizeof(mdp_update));
+        ++stats_.updates_sent_;
+        if (++pending_in_datagram_ == MAX_UPDATES_PER_DATAGRAM)
+            flush_incremental();
+    }
+
+    void ExchangeSimulator::flush_incremental() noexcept {
+        if (!pending_in_datagram_)
+            return;
+        incremental_socket_.send_and_recv();
+        ++stats_.datagrams_sent_;
+        pending_in_datagram_ = 0;
+    }
+
+    // Every trigger_every_-th update is a trade at the touch of a random instrument, the rest alternate between adding
+    // synthetic orders 1 to 3 ticks off the mid and canceling the oldest ones, so the book the client builds stays shallow.
+    auto ExchangeSimulator::next_synthetic_update() noexcept -> MEMarketUpdate {
+        const auto ticker_id = static_cast<Common::TickerId>(rng_() % instruments_.size());
+        auto& instrument = instruments_[ticker_id];
+        const auto side = (rng_() & 1) ? Common::Side::BUY : Common::Side::SELL;
+
+        if (++updates_since_trigger_ >= config_.trigger_every_) {
+            updates_since_trigger_ = 0;
+            const auto price = side == Common::Side::BUY ? instrument.mid_ + 1 : instrument.mid_ - 1;
+            return {MarketUpdateType::TRADE, Common::OrderId_INVALID, ticker_id, side, price, static_cast<Common::Qty>(1 + rng_() % 10), Common::Priority_INVALID};
+        }
+
+        if (instrument.num_resting_ == RESTING_PER_INSTRUMENT || (instrument.num_resting_ > RESTING_PER_INSTRUMENT / 2 && (rng_() & 2))) {
+            const auto order = instrument.resting_[instrument.resting_start_];
+            instrument.resting_start_ = (instrument.resting_start_ + 1) % RESTING_PER_INSTRUMENT;
+            --instrument.num_resting_;
+            return {MarketUpdateType::CANCEL, order.order_id_, ticker_id, order.side_, order.price_, 0, Common::Priority_INVALID};
+        }
+
+        const auto offset = static_cast<Common::Price>(1 + rng_() % 3);
+        const RestingOrder order{next_synthetic_order_id_, side, side == Common::Side::BUY ? instrument.mid_ - offset : instrument.mid_ + offset,
+                                 static_cast<Common::Qty>(1 + rng_() % 100)};
+        // ids index straight into the client's order book, recycle them long before they reach ME_MAX_ORDER_IDS
+        if (++next_synthetic_order_id_ == Common::ME_MAX_ORDER_IDS)
+            next_synthetic_order_id_ = 1;
+        instrument.resting_[(instrument.resting_start_ + instrument.num_resting_) % RESTING_PER_INSTRUMENT] = order;
+        ++instrument.num_resting_;
+        return {MarketUpdateType::ADD, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, order.order_id_};
+    }
+
+    // triggers always go out in a datagram of their own, the timestamp in them is as close to the send as it gets
+    void ExchangeSimulator::send_trigger(MEMarketUpdate& trade) noexcept {
+        flush_incremental();
+
+        const auto trigger_id = ++stats_.triggers_sent_;
+        const auto now = Common::getCurrentNanos();
+        trade.order_id_ = trigger_id;
+        trade.priority_ = static_cast<Common::Priority>(now);
+        publish(trade);
+        flush_incremental();
+
+        trigger_times_[trigger_id & (TRIGGER_TIMES_SIZE - 1)] = now;
+        last_trigger_time_ = now;
+
+        if (trade.ticker_id_ < instruments_.size())
+            fill_resting_client_orders(instruments_[trade.ticker_id_], trade.price_);
+    }
+
+    void ExchangeSimulator::publish_snapshot() noexcept {
+        std::size_t seq_num = 0;
+        auto send = [&](const MEMarketUpdate& update) {
+            const MDPMarketUpdate mdp_update{seq_num++, update};
+            snapshot_socket_.send(&mdp_update, sizeof(mdp_update));
+            if (seq_num % MAX_UPDATES_PER_DATAGRAM == 0)
+                snapshot_socket_.send_and_recv();
+        };
+
+        // covers everything up to the last incremental published, including any still waiting for its datagram
+        const auto last_inc_seq_num = static_cast<Common::OrderId>(next_inc_seq_num_ - 1);
+        send({MarketUpdateType::SNAPSHOT_START, last_inc_seq_num});
+        for (std::size_t ticker_id = 0; ticker_id < instruments_.size(); ++ticker_id) {
+            const auto& instrument = instruments_[ticker_id];
+            send({MarketUpdateType::CLEAR, Common::OrderId_INVALID, static_cast<Common::TickerId>(ticker_id)});
+            for (std::size_t i = 0; i < instrument.num_resting_; ++i) {
+                const auto& order = instrument.resting_[(instrument.resting_start_ + i) % RESTING_PER_INSTRUMENT];
+                send({MarketUpdateType::ADD, order.order_id_, static_cast<Common::TickerId>(ticker_id), order.side_, order.price_, order.qty_, order.order_id_});
+            }
+        }
+        send({MarketUpdateType::SNAPSHOT_END, last_inc_seq_num});
+        snapshot_socket_.send_and_recv();
+        ++stats_.snapshots_sent_;
+    }
+
+    auto ExchangeSimulator::session_index(Common::TCPSocket* socket) noexcept -> std::size_t {
+        for (std::size_t i = 0; i < sessions_.size(); ++i) {
+            if (sessions_[i].socket_ == socket)
+                return i;
+        }
+        sessions_.push_back({socket});
+        return sessions_.size() - 1;
+    }
+
+    void ExchangeSimulator::on_order_data(Common::TCPSocket* socket, Common::Nanos rx_time) noexcept {
+        const auto user_time = Common::getCurrentNanos();
+        if (rx_time)
+            stats_.order_rx_kernel_to_user_.record(user_time - rx_time);
+        const auto recv_time = rx_time ? rx_time : user_time;
+
+        const auto index = session_index(socket);
+        std::size_t i = 0;
+        for (; i + sizeof(OMClientRequest) <= socket->next_recv_valid_index_; i += sizeof(OMClientRequest)) {
+            const auto request = reinterpret_cast<const OMClientRequest*>(socket->inbound_data_.data() + i);
+            if (request->me_client_request_.type_ == ClientRequestType::HEARTBEAT)
+                continue;
+
+            // the client's seq numbers carry on across reconnects while ours start at 1 per connection, so only
+            // duplicates are dropped and a gap is counted but not held against the request
+            auto& session = sessions_[index];
+            if (UNLIKELY(request->seq_num_ < session.next_exp_seq_num_))
+                continue;
+            if (UNLIKELY(request->seq_num_ > session.next_exp_seq_num_)) {
+                ++stats_.sequence_gaps_;
+                logger_.log("%:% %() % sequence gap on socket:% expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), socket->socket_fd_, session.next_exp_seq_num_, request->seq_num_);
+            }
+            session.next_exp_seq_num_ = request->seq_num_ + 1;
+
+            on_request(index, request->me_client_request_, recv_time);
+        }
+
+        memmove(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_recv_valid_index_ - i);
+        socket->next_recv_valid_index_ -= i;
+        socket->flush();
+    }
+
+    void ExchangeSimulator::on_request(std::size_t session_index, const MEClientRequest& request, Common::Nanos recv_time) noexcept {
+        ++stats_.orders_received_;
+
+        if (UNLIKELY(request.ticker_id_ >= instruments_.size())) {
+            logger_.log("%:% %() % ignoring request for unknown ticker %\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::get_current_time_str(time_str_), request.to_string());
+            return;
+        }
+        auto& instrument = instruments_[request.ticker_id_];
+
+        if (request.type_ == ClientRequestType::NEW) {
+            const auto trigger_id = request.order_id_;
+            if (trigger_id && trigger_id <= stats_.triggers_sent_ && stats_.triggers_sent_ - trigger_id < TRIGGER_TIMES_SIZE) {
+                auto& trigger_time = trigger_times_[trigger_id & (TRIGGER_TIMES_SIZE - 1)];
+                if (trigger_time) {
+                    stats_.tick_to_trade_.record(recv_time - trigger_time);
+                    ++stats_.triggers_answered_;
+                    trigger_time = 0; // only the first order answering a trigger counts
+                }
+            }
+
+            MEClientResponse response{ClientResponseType::ACCEPTED, request.client_id_, request.ticker_id_, request.order_id_,
+                                      next_market_order_id_++, request.side_, request.price_, 0, request.qty_};
+            respond(session_index, response);
+
+            const auto crosses = request.side_ == Common::Side::BUY ? request.price_ >= instrument.mid_ + 1 : request.price_ <= instrument.mid_ - 1;
+            if (crosses) {
+                response.type_ = ClientResponseType::FILLED;
+                response.price_ = request.side_ == Common::Side::BUY ? instrument.mid_ + 1 : instrument.mid_ - 1;
+                response.exec_qty_ = request.qty_;
+                response.leaves_qty_ = 0;
+                respond(session_index, response);
+                ++stats_.fills_;
+            } else {
+                instrument.client_orders_.push_back({session_index, response});
+            }
+            return;
+        }
+
+        if (request.type_ == ClientRequestType::CANCEL) {
+            auto& orders = instrument.client_orders_;
+            for (std::size_t i = 0; i < orders.size(); ++i) {
+                auto& order = orders[i];
+                if (order.session_index_ != session_index || order.response_.client_order_id_ != request.order_id_)
+                    continue;
+                order.response_.type_ = ClientResponseType::CANCELED;
+                respond(session_index, order.response_);
+                order = orders.back();
+                orders.pop_back();
+                return;
+            }
+            respond(session_index, {ClientResponseType::CANCEL_REJECTED, request.client_id_, request.ticker_id_, request.order_id_,
+                                    Common::OrderId_INVALID, request.side_, Common::Price_INVALID, Common::Qty_INVALID, Common::Qty_INVALID});
+        }
+    }
+
+    void ExchangeSimulator::fill_resting_client_orders(Instrument& instrument, Common::Price trade_price) noexcept {
+        auto& orders = instrument.client_orders_;
+        for (std::size_t i = 0; i < orders.size();) {
+            auto& response = orders[i].response_;
+            const auto filled = response.side_ == Common::Side::BUY ? response.price_ >= trade_price : response.price_ <= trade_price;
+            if (!filled) {
+                ++i;
+                continue;
+            }
+            response.type_ = ClientResponseType::FILLED;
+            response.exec_qty_ = response.leaves_qty_;
+            response.leaves_qty_ = 0;
+            respond(orders[i].session_index_, response);
+            ++stats_.fills_;
+            orders[i] = orders.back();
+            orders.pop_back();
+        }
+    }
+
+    // queued on the session's socket, on_order_data() flushes it and TCPServer::send_and_recv() picks up the rest
+    void ExchangeSimulator::respond(std::size_t session_index, const MEClientResponse& response) noexcept {
+        auto& session = sessions_[session_index];
+        const OMClientResponse om_response{session.next_outgoing_seq_num_++, response};
+        session.socket_->send(&om_response, sizeof(om_response));
+    }
+}
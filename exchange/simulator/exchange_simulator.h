@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/time_utils.h"
+#include "common/logging.h"
+#include "common/latency_histogram.h"
+#include "common/mcast_socket.h"
+#include "common/tcp_server.h"
+
+#include "exchange/market_data/market_update.h"
+#include "exchange/order_server/client_request.h"
+#include "exchange/order_server/client_response.h"
+
+namespace Exchange {
+
+    struct SimulatorConfig {
+        std::string iface_ = "lo";
+        std::string incremental_ip_ = "239.0.0.31";
+        int incremental_port_ = 20031;
+        std::string snapshot_ip_ = "239.0.0.32";
+        int snapshot_port_ = 20032;
+        int order_port_ = 12346;
+
+        std::size_t num_instruments_ = Common::ME_MAX_TICKERS;
+
+        double message_rate_ = 100'000;   // market updates per second, 0 publishes a burst on every loop iteration
+        std::size_t burst_size_ = 1;      // updates sent back to back, bursts are spaced out to hold message_rate_
+        std::size_t trigger_every_ = 100; // every n-th synthetic update is a trigger TRADE
+        std::size_t num_triggers_ = 0;    // stop after this many triggers were sent and answered (or timed out), 0 = until stop()
+        Common::Nanos answer_timeout_ = 1'000'000'000;
+        Common::Nanos snapshot_interval_ = 1'000'000'000;
+        std::size_t min_clients_ = 1;     // nothing is published before this many order sessions are connected
+
+        // replay the MEMarketUpdates of a Common::Journal<MEMarketUpdate> in a loop instead of generating them,
+        // every replayed TRADE becomes a trigger and no snapshots are published
+        std::string replay_dir_;
+        std::string replay_name_;
+
+        uint64_t seed_ = 42;
+    };
+
+    // what the simulator saw of the client's reaction to its triggers, all times in ns
+    struct SimulatorStats {
+        std::size_t updates_sent_ = 0;
+        std::size_t datagrams_sent_ = 0;
+        std::size_t snapshots_sent_ = 0;
+        std::size_t triggers_sent_ = 0;
+        std::size_t triggers_answered_ = 0;
+        std::size_t orders_received_ = 0;
+        std::size_t fills_ = 0;
+        std::size_t sequence_gaps_ = 0;
+
+        // trigger handed to the kernel -> answering order received (kernel receive timestamp where available)
+        Common::LatencyHistogram tick_to_trade_;
+        // kernel receive timestamp -> order seen by the matching loop, already part of tick_to_trade_
+        Common::LatencyHistogram order_rx_kernel_to_user_;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "SimulatorStats{updates:" << updates_sent_ << " datagrams:" << datagrams_sent_ << " snapshots:" << snapshots_sent_
+               << " triggers:" << triggers_sent_ << " answered:" << triggers_answered_ << " orders:" << orders_received_
+               << " fills:" << fills_ << " gaps:" << sequence_gaps_ << " tick_to_trade[" << tick_to_trade_.to_string() << "]}";
+            return ss.str();
+        }
+    };
+
+    // Stand-in for a venue on the local host so tick-to-trade can be measured end to end without one. Publishes synthetic
+    // (or replayed) market data on the incremental multicast stream plus periodic snapshots, accepts orders on a TCP
+    // order session, matches them and sends back execution reports, all in the MDP / OM formats the trading side speaks.
+    //
+    // Triggers: a TRADE update with order_id_ set to a trigger id (from 1) and priority_ set to the time it was handed
+    // to the kernel (Common::getCurrentNanos()). A client answers a trigger with a NEW order whose client order id is
+    // that trigger id, the simulator then records tick-to-trade as order receive time - trigger send time. Both sides
+    // of a loopback run share the clock, so the client can subtract priority_ from its own timestamps as well.
+    //
+    // Matching is deliberately simple: each instrument has a fixed mid with synthetic orders resting 1 to 3 ticks
+    // either side of it. A NEW at or through the touch (mid +- 1) is accepted and filled in full at the touch, anything
+    // else rests until a trigger TRADE trades through its price or it is canceled. Client orders are not published on
+    // the market data streams.
+    class ExchangeSimulator final {
+    public:
+        explicit ExchangeSimulator(const SimulatorConfig& config);
+        ~ExchangeSimulator();
+
+        ExchangeSimulator() = delete;
+        ExchangeSimulator(const ExchangeSimulator&) = delete;
+        ExchangeSimulator(const ExchangeSimulator&&) = delete;
+        ExchangeSimulator& operator=(const ExchangeSimulator&) = delete;
+        ExchangeSimulator& operator=(const ExchangeSimulator&&) = delete;
+
+        // loops on poll() until stop() or until done()
+        void run() noexcept;
+        auto stop() noexcept { running_ = false; }
+
+        // one iteration: accept / read order sessions, publish whatever the rate allows, snapshot if due
+        void poll() noexcept;
+
+        // every configured trigger was sent and answered, or the last one timed out
+        auto done() const noexcept {
+            return config_.num_triggers_ && stats_.triggers_sent_ == config_.num_triggers_ &&
+                   (stats_.triggers_answered_ == stats_.triggers_sent_ || Common::getCurrentNanos() - last_trigger_time_ > config_.answer_timeout_);
+        }
+
+        auto get_stats() const noexcept -> const SimulatorStats& { return stats_; }
+        auto get_config() const noexcept -> const SimulatorConfig& { return config_; }
+
+    private:
+        // datagrams stay below a 1500 byte MTU
+        static constexpr std::size_t MAX_UPDATES_PER_DATAGRAM = 1472 / sizeof(MDPMarketUpdate);
+        static constexpr std::size_t RESTING_PER_INSTRUMENT = 32;
+        static constexpr std::size_t TRIGGER_TIMES_SIZE = 64 * 1024; // power of two, send times of the latest triggers
+
+        struct RestingOrder {
+            Common::OrderId order_id_ = Common::OrderId_INVALID;
+            Common::Side side_ = Common::Side::INVALID;
+            Common::Price price_ = Common::Price_INVALID;
+            Common::Qty qty_ = 0;
+        };
+
+        struct ClientOrder {
+            std::size_t session_index_ = 0;
+            MEClientResponse response_; // filled in as ACCEPTED, reused for the FILLED / CANCELED that follow
+        };
+
+        struct Session {
+            Common::TCPSocket* socket_ = nullptr;
+            std::size_t next_exp_seq_num_ = 1;
+            std::size_t next_outgoing_seq_num_ = 1;
+        };
+
+        struct Instrument {
+            Common::Price mid_ = 0;
+            // synthetic orders currently on the book, a ring, the oldest is canceled to make room
+            std::array<RestingOrder, RESTING_PER_INSTRUMENT> resting_{};
+            std::size_t resting_start_ = 0;
+            std::size_t num_resting_ = 0;
+            std::vector<ClientOrder> client_orders_;
+        };
+
+        const SimulatorConfig config_;
+        std::atomic_bool running_ {false};
+
+        std::string time_str_;
+        Common::Logger logger_;
+        Common::McastSocket incremental_socket_;
+        Common::McastSocket snapshot_socket_;
+        Common::TCPServer order_server_;
+        std::vector<Session> sessions_;
+
+        std::vector<Instrument> instruments_;
+        std::mt19937_64 rng_;
+
+        std::vector<MEMarketUpdate> replay_updates_;
+        std::size_t next_replay_index_ = 0;
+
+        std::size_t next_inc_seq_num_ = 1;
+        std::size_t pending_in_datagram_ = 0;
+        Common::OrderId next_synthetic_order_id_ = 1;
+        Common::OrderId next_market_order_id_ = 1;
+        std::size_t updates_since_trigger_ = 0;
+
+        std::vector<Common::Nanos> trigger_times_;
+        Common::Nanos last_trigger_time_ = 0;
+        Common::Nanos next_burst_time_ = 0;
+        Common::Nanos next_snapshot_time_ = 0;
+
+        SimulatorStats stats_;
+
+        auto publishing() const noexcept {
+            return order_server_.receive_sockets_.size() >= config_.min_clients_ && (!config_.num_triggers_ || stats_.triggers_sent_ < config_.num_triggers_);
+        }
+
+        void publish_burst(Common::Nanos now) noexcept;
+        void publish(const MEMarketUpdate& update) noexcept;
+        void flush_incremental() noexcept;
+        auto next_synthetic_update() noexcept -> MEMarketUpdate;
+        void send_trigger(MEMarketUpdate& trade) noexcept;
+        void publish_snapshot() noexcept;
+
+        auto session_index(Common::TCPSocket* socket) noexcept -> std::size_t;
+        void on_order_data(Common::TCPSocket* socket, Common::Nanos rx_time) noexcept;
+        void on_request(std::size_t session_index, const MEClientRequest& request, Common::Nanos recv_time) noexcept;
+        void fill_resting_client_orders(Instrument& instrument, Common::Price trade_price) noexcept;
+        void respond(std::size_t session_index, const MEClientResponse& response) noexcept;
+    };
+}
@@ -0,0 +1,72 @@
+#include <csignal>
+#include <iostream>
+
+#include "exchange/simulator/exchange_simulator.h"
+
+// Standalone exchange simulator, runs until every --triggers trigger was answered or until SIGINT / SIGTERM, then
+// prints what it saw. See exchange_simulator.h for the trigger convention a client has to follow.
+
+namespace {
+    Exchange::ExchangeSimulator* simulator = nullptr;
+
+    void print_usage(const char* name) {
+        std::cerr << "usage: " << name << " [--iface lo] [--order-port 12346] [--instruments 8] [--rate 100000] [--burst 1]\n"
+                  << "       [--trigger-every 100] [--triggers 0] [--min-clients 1] [--snapshot-interval-ms 1000]\n"
+                  << "       [--replay-dir dir --replay-name name] [--seed 42]\n"
+                  << "  --rate is market updates per second (0 = as fast as possible), --burst how many go out back to back\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Exchange::SimulatorConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h" || i + 1 == argc) {
+            print_usage(argv[0]);
+            return arg == "--help" || arg == "-h" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--iface")
+            config.iface_ = value;
+        else if (arg == "--order-port")
+            config.order_port_ = std::stoi(value);
+        else if (arg == "--instruments")
+            config.num_instruments_ = std::stoull(value);
+        else if (arg == "--rate")
+            config.message_rate_ = std::stod(value);
+        else if (arg == "--burst")
+            config.burst_size_ = std::stoull(value);
+        else if (arg == "--trigger-every")
+            config.trigger_every_ = std::stoull(value);
+        else if (arg == "--triggers")
+            config.num_triggers_ = std::stoull(value);
+        else if (arg == "--min-clients")
+            config.min_clients_ = std::stoull(value);
+        else if (arg == "--snapshot-interval-ms")
+            config.snapshot_interval_ = std::stoll(value) * 1'000'000;
+        else if (arg == "--replay-dir")
+            config.replay_dir_ = value;
+        else if (arg == "--replay-name")
+            config.replay_name_ = value;
+        else if (arg == "--seed")
+            config.seed_ = std::stoull(value);
+        else {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Exchange::ExchangeSimulator exchange_simulator(config);
+    simulator = &exchange_simulator;
+    std::signal(SIGINT, [](int) { simulator->stop(); });
+    std::signal(SIGTERM, [](int) { simulator->stop(); });
+
+    std::cout << "exchange simulator listening on " << config.iface_ << ":" << config.order_port_ << ", publishing "
+              << config.incremental_ip_ << ":" << config.incremental_port_ << std::endl;
+    exchange_simulator.run();
+
+    const auto& stats = exchange_simulator.get_stats();
+    std::cout << stats.to_string() << '\n'
+              << "order rx kernel to user [" << stats.order_rx_kernel_to_user_.to_string() << "]" << std::endl;
+    return 0;
+}
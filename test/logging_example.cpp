@@ -1,4 +1,4 @@
-#include "include/logger.h"
+#include "common/logging.h"
 
 using namespace Common;
 
@@ -15,6 +15,7 @@ int main() {
     Logger logger("logging_example.log");
     
     logger.log("Logging a char:% an int:% and an unsigned int:%\n", c, i, ul);
+    logger.log("Logging a float:% a double:% a C-string:'%' and a string:'%'\n", f, d, s, ss);
     
 
 }
\ No newline at end of file
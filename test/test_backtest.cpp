@@ -0,0 +1,356 @@
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <unistd.h>
+
+#include "test/test_utils.h"
+
+#include "trading/backtest/backtest_engine.h"
+
+// SimulatedOrderGateway's fill model against a MarketOrderBook driven by hand: marketable on arrival, resting fills
+// on trades and touches strictly through the price, cancels and order latency. RecordedMarketData's per instrument index.
+// BacktestEngine over a small recording with one worker and with more workers than cpus and passes to go round.
+
+using namespace Common;
+using namespace Exchange;
+using Trading::MarketOrderBook;
+using Trading::SimulatedOrderGateway;
+using Trading::BacktestEngine;
+using Trading::BacktestConfig;
+using Trading::BacktestResult;
+
+namespace {
+    constexpr TickerId TICKER = 0;
+    constexpr ClientId CLIENT = 7;
+    const std::string DIR = "/tmp";
+
+    auto remove_journal(const std::string& name) {
+        for (uint64_t index = 0; unlink(journal_segment_path(DIR, name, index).c_str()) == 0; ++index);
+    }
+
+    struct Market {
+        MarketOrderBook book_{TICKER};
+        SimulatedOrderGateway gateway_;
+
+        explicit Market(Nanos latency = 0) : gateway_{CLIENT, latency} {
+            // 99 bid 10 / 100 ask 5
+            update({MarketUpdateType::ADD, 1, TICKER, Side::BUY, 99, 10, 1});
+            update({MarketUpdateType::ADD, 2, TICKER, Side::SELL, 100, 5, 1});
+        }
+
+        auto update(const MEMarketUpdate& update, Nanos now = 0) -> void {
+            gateway_.set_time(now);
+            book_.on_market_update(&update);
+            gateway_.on_market_update(&update, book_);
+        }
+
+        auto arrive(Nanos now = 0) -> void {
+            gateway_.set_time(now);
+            gateway_.on_market_update(nullptr, book_);
+        }
+
+        auto take_responses() {
+            auto responses = gateway_.responses();
+            gateway_.responses().clear();
+            return responses;
+        }
+    };
+
+    constexpr std::array<TickerId, 3> RECORDED_TICKERS = {0, 2, 5};
+    constexpr std::size_t NUM_PARAMS = 5;
+
+    // a few hundred adds, modifies, cancels and trades around 100 on each of RECORDED_TICKERS
+    auto record_market_data(const std::string& name) {
+        struct Order {
+            OrderId order_id_;
+            Side side_;
+            Price price_;
+            Qty qty_;
+        };
+        std::mt19937 rng(7);
+        std::array<std::vector<Order>, ME_MAX_TICKERS> live;
+        OrderId next_order_id = 1;
+        Journal<MEMarketUpdate> journal(DIR, name, JOURNAL_HEADER_SIZE + 1024 * sizeof(JournalRecord<MEMarketUpdate>), 16, 1024);
+        for (Nanos time = 0; time < 600; ++time) {
+            const auto ticker_id = RECORDED_TICKERS[rng() % RECORDED_TICKERS.size()];
+            auto& orders = live[ticker_id];
+            const auto action = rng() % 10;
+            if (action < 4 || orders.size() < 4) {
+                Order order{next_order_id++, rng() & 1 ? Side::BUY : Side::SELL, 0, 1 + static_cast<Qty>(rng() % 20)};
+                order.price_ = order.side_ == Side::BUY ? 99 - static_cast<Price>(rng() % 3) : 101 + static_cast<Price>(rng() % 3);
+                orders.push_back(order);
+                journal.append({MarketUpdateType::ADD, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, 1}, time);
+                continue;
+            }
+
+            const auto index = rng() % orders.size();
+            auto& order = orders[index];
+            if (action < 6) {
+                order.qty_ = 1 + static_cast<Qty>(rng() % 20);
+                journal.append({MarketUpdateType::MODIFY, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, 1}, time);
+                continue;
+            }
+            if (action >= 8) {
+                const auto traded = std::min(order.qty_, 1 + static_cast<Qty>(rng() % 10));
+                journal.append({MarketUpdateType::TRADE, OrderId_INVALID, ticker_id, order.side_, order.price_, traded, 0}, time);
+                order.qty_ -= traded;
+                if (order.qty_) {
+                    journal.append({MarketUpdateType::MODIFY, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, 1}, time);
+                    continue;
+                }
+            }
+            journal.append({MarketUpdateType::CANCEL, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, 1}, time);
+            order = orders.back();
+            orders.pop_back();
+        }
+    }
+
+    // strategies constructed per (ticker id, parameter index), each run has to happen exactly once
+    std::array<std::array<std::atomic<std::size_t>, NUM_PARAMS>, ME_MAX_TICKERS> strategy_runs;
+
+    struct TakerParams {
+        std::size_t index_ = 0;
+        std::size_t every_ = 1;
+        Qty clip_ = 1;
+    };
+
+    // every every_ book updates alternately lifts the ask and hits the bid, whatever does not fill rests
+    class Taker final {
+    public:
+        using Params = TakerParams;
+
+        Taker(const Params& params, TickerId ticker_id, SimulatedOrderGateway& gateway)
+            : params_{params}, ticker_id_{ticker_id}, gateway_{gateway} {
+            ++strategy_runs[ticker_id][params.index_];
+        }
+
+        auto on_order_book_update(const MEMarketUpdate&, const MarketOrderBook& book) noexcept {
+            if (++updates_ % params_.every_)
+                return;
+            const auto bbo = book.get_bbo();
+            if (bbo->bid_price_ == Price_INVALID || bbo->ask_price_ == Price_INVALID)
+                return;
+            const auto buy = (updates_ / params_.every_) % 2;
+            gateway_.send_new_order(ticker_id_, buy ? Side::BUY : Side::SELL, buy ? bbo->ask_price_ : bbo->bid_price_, params_.clip_, next_order_id_++);
+        }
+
+        auto on_trade_update(const MEMarketUpdate&, const MarketOrderBook&) noexcept {}
+        auto on_order_update(const MEClientResponse&) noexcept {}
+
+    private:
+        const Params params_;
+        const TickerId ticker_id_;
+        SimulatedOrderGateway& gateway_;
+        std::size_t updates_ = 0;
+        OrderId next_order_id_ = 1;
+    };
+
+    auto is_response(const MEClientResponse& response, ClientResponseType type, Price price, Qty exec_qty, Qty leaves_qty) {
+        return response.type_ == type && response.client_id_ == CLIENT && response.price_ == price &&
+               response.exec_qty_ == exec_qty && response.leaves_qty_ == leaves_qty;
+    }
+}
+
+TEST(backtest_marketable_order_takes_the_touch_and_rests_the_rest) {
+    Market market;
+    market.gateway_.send_new_order(TICKER, Side::BUY, 101, 8, 1);
+    CHECK(market.gateway_.has_pending());
+    market.arrive();
+
+    const auto responses = market.take_responses();
+    REQUIRE(responses.size() == 2u);
+    CHECK(is_response(responses[0], ClientResponseType::ACCEPTED, 101, 0, 8));
+    CHECK(is_response(responses[1], ClientResponseType::FILLED, 100, 5, 3));
+    CHECK_EQ(responses[1].client_order_id_, 1u);
+    CHECK_EQ(market.gateway_.num_live_orders(), 1u);
+    CHECK_EQ(market.gateway_.num_fills(), 1u);
+}
+
+TEST(backtest_resting_order_fills_only_on_trades_through_its_price) {
+    Market market;
+    market.gateway_.send_new_order(TICKER, Side::BUY, 99, 10, 1);
+    market.arrive();
+    CHECK_EQ(market.take_responses().size(), 1u);
+
+    // trading at our price says nothing about our queue position
+    market.update({MarketUpdateType::TRADE, OrderId_INVALID, TICKER, Side::SELL, 99, 4, 0});
+    CHECK(market.take_responses().empty());
+
+    market.update({MarketUpdateType::ADD, 3, TICKER, Side::BUY, 98, 20, 1});
+    market.update({MarketUpdateType::TRADE, OrderId_INVALID, TICKER, Side::SELL, 98, 4, 0});
+    auto responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(is_response(responses[0], ClientResponseType::FILLED, 99, 4, 6));
+
+    // trade qty caps the fill
+    market.update({MarketUpdateType::TRADE, OrderId_INVALID, TICKER, Side::SELL, 97, 50, 0});
+    responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(is_response(responses[0], ClientResponseType::FILLED, 99, 6, 0));
+    CHECK_EQ(market.gateway_.num_live_orders(), 0u);
+}
+
+TEST(backtest_resting_order_fills_when_the_opposite_touch_moves_through_it) {
+    Market market;
+    market.gateway_.send_new_order(TICKER, Side::SELL, 101, 3, 1);
+    market.arrive();
+    market.take_responses();
+
+    // a bid at our price is not enough, one above it is
+    market.update({MarketUpdateType::ADD, 3, TICKER, Side::BUY, 101, 1, 1});
+    CHECK(market.take_responses().empty());
+    market.update({MarketUpdateType::ADD, 4, TICKER, Side::BUY, 102, 1, 1});
+    const auto responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(is_response(responses[0], ClientResponseType::FILLED, 101, 3, 0));
+}
+
+TEST(backtest_cancel) {
+    Market market;
+    market.gateway_.send_new_order(TICKER, Side::BUY, 95, 10, 1);
+    market.arrive();
+    market.take_responses();
+
+    market.gateway_.send_cancel(TICKER, Side::BUY, 1);
+    market.arrive();
+    auto responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(is_response(responses[0], ClientResponseType::CANCELED, 95, Qty_INVALID, 10));
+    CHECK_EQ(market.gateway_.num_live_orders(), 0u);
+
+    // already gone
+    market.gateway_.send_cancel(TICKER, Side::BUY, 1);
+    responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(responses[0].type_ == ClientResponseType::CANCEL_REJECTED);
+    CHECK_EQ(responses[0].client_order_id_, 1u);
+}
+
+TEST(backtest_order_latency_delays_arrival_and_cancels) {
+    Market market(100);
+    market.gateway_.set_time(1'000);
+    market.gateway_.send_new_order(TICKER, Side::BUY, 100, 2, 1);
+    // with latency nothing can have arrived yet by the time the strategy callback returns
+    CHECK(!market.gateway_.has_pending());
+
+    // the ask lifts out of reach before the order gets there
+    market.update({MarketUpdateType::MODIFY, 2, TICKER, Side::SELL, 101, 5, 1}, 1'050);
+    CHECK(market.take_responses().empty());
+    market.update({MarketUpdateType::ADD, 3, TICKER, Side::BUY, 97, 1, 1}, 1'100);
+    auto responses = market.take_responses();
+    REQUIRE(responses.size() == 1u);
+    CHECK(is_response(responses[0], ClientResponseType::ACCEPTED, 100, 0, 2));
+
+    // partly filled by a trade through it while the cancel is on its way
+    market.gateway_.set_time(1'200);
+    market.gateway_.send_cancel(TICKER, Side::BUY, 1);
+    market.update({MarketUpdateType::TRADE, OrderId_INVALID, TICKER, Side::SELL, 99, 1, 0}, 1'250);
+    market.update({MarketUpdateType::ADD, 4, TICKER, Side::BUY, 96, 1, 1}, 1'300);
+    responses = market.take_responses();
+    REQUIRE(responses.size() == 2u);
+    CHECK(is_response(responses[0], ClientResponseType::FILLED, 100, 1, 1));
+    CHECK(is_response(responses[1], ClientResponseType::CANCELED, 100, Qty_INVALID, 1));
+}
+
+TEST(backtest_recorded_market_data_skips_and_counts_ticker_ids_out_of_range) {
+    const std::string name = "test_backtest_recorded_market_data";
+    remove_journal(name);
+    {
+        Journal<MEMarketUpdate> journal(DIR, name, JOURNAL_HEADER_SIZE + 64 * sizeof(JournalRecord<MEMarketUpdate>), 16, 1024);
+        for (const TickerId ticker_id : {TickerId{0}, TickerId{ME_MAX_TICKERS}, TickerId{1}, TickerId{ME_MAX_TICKERS + 3}, TickerId{0}})
+            journal.append({MarketUpdateType::ADD, 1, ticker_id, Side::BUY, 99, 10, 1}, 0);
+    }
+
+    const auto log_file = DIR + "/" + name + ".log";
+    {
+        Logger logger(log_file);
+        const Trading::RecordedMarketData data(logger, DIR, name);
+        CHECK_EQ(data.size(), 5u);
+        CHECK_EQ(data.num_skipped(), 2u);
+        REQUIRE(data.tickers().size() == 2u);
+        CHECK_EQ(data.events(0).size(), 2u);
+        CHECK_EQ(data.events(1).size(), 1u);
+    }
+
+    // reported once with the ticker ids it left out
+    std::ifstream log(log_file);
+    std::string line, report;
+    while (std::getline(log, line))
+        report += line.find("skipped") != std::string::npos ? line : "";
+    CHECK(report.find("skipped 2 updates") != std::string::npos);
+    CHECK(report.ends_with(" " + ticker_id_to_string(ME_MAX_TICKERS) + " " + ticker_id_to_string(ME_MAX_TICKERS + 3)));
+    unlink(log_file.c_str());
+    remove_journal(name);
+}
+
+TEST(backtest_engine_fills_every_result_once_and_worker_count_does_not_change_them) {
+    const std::string name = "test_backtest_engine";
+    remove_journal(name);
+    record_market_data(name);
+    const auto log_file = DIR + "/" + name + ".log";
+    Logger logger(log_file);
+    const Trading::RecordedMarketData data(logger, DIR, name);
+    REQUIRE(data.tickers() == std::vector<TickerId>(RECORDED_TICKERS.begin(), RECORDED_TICKERS.end()));
+
+    std::vector<TakerParams> params;
+    for (std::size_t p = 0; p < NUM_PARAMS; ++p)
+        params.push_back({p, 1 + p % 3, 1 + static_cast<Qty>(p)});
+
+    // two strategies per pass makes three passes per instrument, nine in all
+    auto run = [&](std::size_t num_workers) {
+        for (auto& runs : strategy_runs)
+            for (auto& count : runs)
+                count = 0;
+
+        BacktestConfig config;
+        config.num_workers_ = num_workers;
+        config.strategies_per_pass_ = 2;
+        BacktestEngine<Taker> engine(data, config);
+        const auto results = engine.run(params);
+
+        const auto& stats = engine.get_stats();
+        CHECK_EQ(stats.runs_, RECORDED_TICKERS.size() * NUM_PARAMS);
+        CHECK_EQ(stats.passes_, RECORDED_TICKERS.size() * 3);
+        CHECK_EQ(stats.workers_.size(), num_workers);
+        std::size_t passes = 0;
+        for (const auto& worker : stats.workers_)
+            passes += worker.passes_;
+        CHECK_EQ(passes, stats.passes_);
+        CHECK_EQ(stats.events_, data.size() * 3);
+
+        REQUIRE(results.size() == RECORDED_TICKERS.size() * NUM_PARAMS);
+        for (std::size_t t = 0; t < RECORDED_TICKERS.size(); ++t) {
+            const auto ticker_id = RECORDED_TICKERS[t];
+            for (std::size_t p = 0; p < NUM_PARAMS; ++p) {
+                const auto& result = results[t * NUM_PARAMS + p];
+                CHECK_EQ(strategy_runs[ticker_id][p].load(), 1u);
+                CHECK_EQ(result.ticker_id_, ticker_id);
+                CHECK_EQ(result.param_index_, p);
+                CHECK_EQ(result.events_, data.events(ticker_id).size());
+            }
+        }
+        return results;
+    };
+
+    const auto single = run(1);
+    const auto oversubscribed = run(8);
+    REQUIRE(single.size() == oversubscribed.size());
+    std::size_t fills = 0;
+    for (std::size_t i = 0; i < single.size(); ++i) {
+        CHECK_EQ(oversubscribed[i].orders_, single[i].orders_);
+        CHECK_EQ(oversubscribed[i].fills_, single[i].fills_);
+        CHECK_EQ(oversubscribed[i].position_.position_, single[i].position_.position_);
+        CHECK_EQ(oversubscribed[i].position_.open_cost_, single[i].position_.open_cost_);
+        CHECK_EQ(oversubscribed[i].position_.realized_pnl_, single[i].position_.realized_pnl_);
+        CHECK_EQ(oversubscribed[i].position_.unrealized_pnl_, single[i].position_.unrealized_pnl_);
+        CHECK_EQ(oversubscribed[i].position_.volume_, single[i].position_.volume_);
+        fills += single[i].fills_;
+    }
+    // otherwise the comparison above proves nothing
+    CHECK(fills > 0);
+
+    unlink(log_file.c_str());
+    remove_journal(name);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
@@ -0,0 +1,143 @@
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test/test_utils.h"
+
+#include "common/journal.h"
+
+// Journal write / replay round trip, recovery from a torn tail, and JournalView agreeing with replay().
+
+using namespace Common;
+
+namespace {
+    struct Event {
+        uint64_t id_ = 0;
+        int64_t value_ = 0;
+    };
+
+    using Record = JournalRecord<Event>;
+
+    const std::string DIR = "/tmp";
+
+    auto remove_journal(const std::string& name) {
+        for (uint64_t index = 0; unlink(journal_segment_path(DIR, name, index).c_str()) == 0; ++index);
+    }
+
+    // small segments so a few hundred records span several of them
+    constexpr std::size_t SEGMENT_SIZE = JOURNAL_HEADER_SIZE + 100 * sizeof(Record);
+
+    auto write_events(const std::string& name, uint64_t first_id, std::size_t count) {
+        Journal<Event> journal(DIR, name, SEGMENT_SIZE, 16, 1024);
+        for (std::size_t i = 0; i < count; ++i)
+            journal.append({first_id + i, -static_cast<int64_t>(first_id + i)}, static_cast<Nanos>(first_id + i));
+    }
+
+    auto replay_ids(const std::string& name, JournalReplayResult& result) {
+        std::vector<uint64_t> ids;
+        result = Journal<Event>::replay(DIR, name, [&](const Record& record) {
+            ids.push_back(record.event_.id_);
+        });
+        return ids;
+    }
+
+    // flips a byte of the event in the record_in_segment'th record of a segment, so its checksum no longer matches
+    auto corrupt_record(const std::string& name, uint64_t segment_index, std::size_t record_in_segment) {
+        const auto fd = open(journal_segment_path(DIR, name, segment_index).c_str(), O_RDWR);
+        REQUIRE(fd >= 0);
+        const auto offset = static_cast<off_t>(JOURNAL_HEADER_SIZE + record_in_segment * sizeof(Record) + offsetof(Record, event_));
+        char byte = 0;
+        REQUIRE(pread(fd, &byte, 1, offset) == 1);
+        byte = static_cast<char>(~byte);
+        REQUIRE(pwrite(fd, &byte, 1, offset) == 1);
+        close(fd);
+    }
+}
+
+TEST(journal_round_trip_across_segments) {
+    const std::string name = "test_journal_round_trip";
+    remove_journal(name);
+    write_events(name, 1, 250);
+
+    JournalReplayResult result;
+    const auto ids = replay_ids(name, result);
+    REQUIRE(ids.size() == 250u);
+    for (std::size_t i = 0; i < ids.size(); ++i)
+        CHECK_EQ(ids[i], i + 1);
+    CHECK_EQ(result.records_, 250u);
+    CHECK_EQ(result.segments_, 3u);
+    CHECK_EQ(result.last_seq_num_, 250u);
+    CHECK(!result.torn_);
+
+    // reopening carries on the sequence in a new segment
+    write_events(name, 251, 10);
+    const auto more = replay_ids(name, result);
+    CHECK_EQ(more.size(), 260u);
+    CHECK_EQ(result.last_seq_num_, 260u);
+    CHECK_EQ(result.segments_, 4u);
+    remove_journal(name);
+}
+
+TEST(journal_torn_tail_is_cut_and_writing_resumes_after_it) {
+    const std::string name = "test_journal_torn_tail";
+    remove_journal(name);
+    write_events(name, 1, 50);
+
+    // the last record half written when the process died: checksum no longer matches
+    corrupt_record(name, 0, 49);
+    JournalReplayResult result;
+    auto ids = replay_ids(name, result);
+    CHECK_EQ(ids.size(), 49u);
+    CHECK_EQ(result.last_seq_num_, 49u);
+    CHECK(result.torn_);
+
+    // the restarted writer continues from seq 50 in a fresh segment, the torn record is never replayed
+    write_events(name, 1'000, 5);
+    ids = replay_ids(name, result);
+    REQUIRE(ids.size() == 54u);
+    CHECK_EQ(ids[48], 49u);
+    CHECK_EQ(ids[49], 1'000u);
+    CHECK_EQ(ids[53], 1'004u);
+    CHECK_EQ(result.last_seq_num_, 54u);
+    CHECK_EQ(result.segments_, 2u);
+    CHECK(result.torn_);
+    remove_journal(name);
+}
+
+TEST(journal_corruption_mid_journal_stops_replay_at_the_gap) {
+    const std::string name = "test_journal_mid_corruption";
+    remove_journal(name);
+    write_events(name, 1, 250);
+
+    // a bad record in the middle segment, the segment after it no longer continues the sequence
+    corrupt_record(name, 1, 10);
+    JournalReplayResult result;
+    const auto ids = replay_ids(name, result);
+    CHECK_EQ(ids.size(), 110u);
+    CHECK_EQ(result.last_seq_num_, 110u);
+    CHECK_EQ(result.segments_, 2u);
+    CHECK(result.torn_);
+    remove_journal(name);
+}
+
+TEST(journal_view_agrees_with_replay) {
+    const std::string name = "test_journal_view";
+    remove_journal(name);
+    write_events(name, 1, 250);
+    corrupt_record(name, 2, 40);
+
+    JournalReplayResult replayed;
+    const auto ids = replay_ids(name, replayed);
+
+    const JournalView<Event> view(DIR, name);
+    std::vector<uint64_t> view_ids;
+    view.for_each([&](const Record& record) { view_ids.push_back(record.event_.id_); });
+    CHECK(view_ids == ids);
+    CHECK_EQ(view.size(), replayed.records_);
+    CHECK_EQ(view.result().last_seq_num_, replayed.last_seq_num_);
+    CHECK_EQ(view.result().segments_, replayed.segments_);
+    CHECK_EQ(view.result().torn_, replayed.torn_);
+    remove_journal(name);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
@@ -0,0 +1,198 @@
+#include <thread>
+
+#include "test/test_utils.h"
+
+#include "common/mcast_publisher.h"
+#include "common/mcast_socket.h"
+
+// McastPublisher to a McastSocket subscriber over multicast loopback on lo: datagram framing, seq numbers, flush on
+// a full staging area and conflation by key.
+
+using namespace Common;
+
+namespace {
+    struct Message {
+        uint64_t key_ = 0;
+        uint64_t value_ = 0;
+        char payload_[48] = {};
+    };
+
+    using Publisher = McastPublisher<Message>;
+
+    const std::string GROUP = "239.0.0.99";
+    const std::string IFACE = "lo";
+    constexpr int PORT = 20099;
+
+    struct Received {
+        std::vector<McastPacketHeader> headers_;
+        std::vector<Message> msgs_;
+        std::size_t malformed_ = 0;
+    };
+
+    // everything that arrives within timeout or until expected messages are in
+    auto receive(McastSocket& subscriber, std::size_t expected, Nanos timeout = 1'000'000'000) {
+        Received received;
+        subscriber.recv_callback_ = [&](McastSocket* socket) {
+            const auto header = Publisher::for_each_message(socket->rcv_data_, socket->next_rcv_valid_index_,
+                [&](const Message& msg) { received.msgs_.push_back(msg); });
+            if (header)
+                received.headers_.push_back(*header);
+            else
+                ++received.malformed_;
+            socket->next_rcv_valid_index_ = 0;
+        };
+        const auto deadline = getCurrentNanos() + timeout;
+        while (received.msgs_.size() < expected && getCurrentNanos() < deadline) {
+            if (!subscriber.send_and_recv())
+                std::this_thread::yield();
+        }
+        return received;
+    }
+
+    auto check_seq_nums(const Received& received, uint64_t first) {
+        for (std::size_t i = 0; i < received.headers_.size(); ++i)
+            CHECK_EQ(received.headers_[i].seq_num_, first + i);
+    }
+
+    // one for all cases, a Logger takes a second to start
+    auto test_logger() -> Logger& {
+        static Logger logger("test_mcast_publisher.log");
+        return logger;
+    }
+
+    struct Fixture {
+        Logger& logger_ = test_logger();
+        McastSocket subscriber_{logger_};
+
+        Fixture() {
+            REQUIRE(subscriber_.init(GROUP, IFACE, PORT, true) >= 0);
+            REQUIRE(subscriber_.join(GROUP));
+        }
+
+        ~Fixture() {
+            close(subscriber_.socket_fd_);
+        }
+    };
+}
+
+TEST(mcast_publisher_frames_staged_messages_into_mtu_sized_packets) {
+    Fixture fixture;
+    Publisher publisher(fixture.logger_, GROUP, IFACE, PORT, 1'000'000'000);
+    const auto per_packet = publisher.msgs_per_packet();
+    CHECK_EQ(per_packet, (MCAST_DEFAULT_MTU - MCAST_IP_UDP_HEADER_SIZE - sizeof(McastPacketHeader)) / sizeof(Message));
+
+    const std::size_t count = 2 * per_packet + 3;
+    for (std::size_t i = 0; i < count; ++i)
+        publisher.publish({i, i * 10, {}});
+    CHECK_EQ(publisher.num_staged(), count);
+    publisher.flush();
+    CHECK_EQ(publisher.num_staged(), 0u);
+    CHECK_EQ(publisher.packets_sent(), 3u);
+    CHECK_EQ(publisher.send_calls(), 1u);
+    CHECK_EQ(publisher.msgs_sent(), count);
+
+    const auto received = receive(fixture.subscriber_, count);
+    CHECK_EQ(received.malformed_, 0u);
+    REQUIRE(received.msgs_.size() == count);
+    REQUIRE(received.headers_.size() == 3u);
+    check_seq_nums(received, 1);
+    CHECK_EQ(received.headers_[0].msg_count_, per_packet);
+    CHECK_EQ(received.headers_[2].msg_count_, 3u);
+    CHECK_EQ(received.headers_[0].msg_size_, sizeof(Message));
+    for (std::size_t i = 0; i < count; ++i) {
+        CHECK_EQ(received.msgs_[i].key_, i);
+        CHECK_EQ(received.msgs_[i].value_, i * 10);
+    }
+    CHECK_EQ(publisher.next_seq_num(), 4u);
+}
+
+TEST(mcast_publisher_flushes_when_staging_is_full_and_with_no_budget) {
+    Fixture fixture;
+    {
+        // 2 packets of 2 messages each, the 5th publish finds the staging area full
+        const auto mtu = MCAST_IP_UDP_HEADER_SIZE + sizeof(McastPacketHeader) + 2 * sizeof(Message);
+        Publisher publisher(fixture.logger_, GROUP, IFACE, PORT, 1'000'000'000, 0, mtu, 2);
+        for (uint64_t i = 0; i < 5; ++i)
+            publisher.publish({i, i, {}});
+        CHECK_EQ(publisher.packets_sent(), 2u);
+        CHECK_EQ(publisher.num_staged(), 1u);
+        publisher.flush();
+        const auto received = receive(fixture.subscriber_, 5);
+        CHECK_EQ(received.msgs_.size(), 5u);
+        CHECK_EQ(received.headers_.size(), 3u);
+        check_seq_nums(received, 1);
+    }
+    {
+        // a budget of 0 sends every message on its own
+        Publisher publisher(fixture.logger_, GROUP, IFACE, PORT);
+        for (uint64_t i = 0; i < 4; ++i)
+            publisher.publish({i, i, {}});
+        CHECK_EQ(publisher.num_staged(), 0u);
+        CHECK_EQ(publisher.packets_sent(), 4u);
+        const auto received = receive(fixture.subscriber_, 4);
+        CHECK_EQ(received.headers_.size(), 4u);
+        check_seq_nums(received, 1);
+    }
+}
+
+TEST(mcast_publisher_poll_flushes_after_budget) {
+    Fixture fixture;
+    Publisher publisher(fixture.logger_, GROUP, IFACE, PORT, 1'000'000);
+    publisher.publish({1, 1, {}});
+    publisher.poll(getCurrentNanos());
+    CHECK_EQ(publisher.num_staged(), 1u);
+    publisher.poll(getCurrentNanos() + 2'000'000);
+    CHECK_EQ(publisher.num_staged(), 0u);
+    CHECK_EQ(receive(fixture.subscriber_, 1).msgs_.size(), 1u);
+}
+
+TEST(mcast_publisher_conflates_staged_messages_by_key) {
+    Fixture fixture;
+    Publisher publisher(fixture.logger_, GROUP, IFACE, PORT, 1'000'000'000, 4);
+    for (uint64_t key = 0; key < 4; ++key)
+        publisher.publish({key, 1, {}}, key);
+    // newer values replace the staged ones in place, once for key 1 and twice for key 3
+    publisher.publish({1, 2, {}}, 1);
+    publisher.publish({3, 2, {}}, 3);
+    publisher.publish({3, 3, {}}, 3);
+    CHECK_EQ(publisher.num_staged(), 4u);
+    CHECK_EQ(publisher.msgs_conflated(), 3u);
+    publisher.flush();
+
+    auto received = receive(fixture.subscriber_, 4);
+    REQUIRE(received.msgs_.size() == 4u);
+    const uint64_t expected_values[] = {1, 2, 1, 3};
+    for (uint64_t key = 0; key < 4; ++key) {
+        CHECK_EQ(received.msgs_[key].key_, key);
+        CHECK_EQ(received.msgs_[key].value_, expected_values[key]);
+    }
+
+    // after a flush a key is staged afresh, not conflated into what was already sent
+    publisher.publish({1, 4, {}}, 1);
+    CHECK_EQ(publisher.num_staged(), 1u);
+    CHECK_EQ(publisher.msgs_conflated(), 3u);
+    publisher.flush();
+    received = receive(fixture.subscriber_, 1);
+    REQUIRE(received.msgs_.size() == 1u);
+    CHECK_EQ(received.msgs_[0].value_, 4u);
+    check_seq_nums(received, 2);
+}
+
+TEST(mcast_publisher_for_each_message_rejects_malformed_datagrams) {
+    char datagram[sizeof(McastPacketHeader) + 2 * sizeof(Message)] = {};
+    McastPacketHeader header{1, 0, 2, sizeof(Message)};
+    memcpy(datagram, &header, sizeof(header));
+
+    std::size_t seen = 0;
+    auto count = [&](const Message&) { ++seen; };
+    CHECK(Publisher::for_each_message(datagram, sizeof(datagram), count) != nullptr);
+    CHECK_EQ(seen, 2u);
+    CHECK(Publisher::for_each_message(datagram, sizeof(McastPacketHeader) - 1, count) == nullptr);
+    CHECK(Publisher::for_each_message(datagram, sizeof(datagram) - 1, count) == nullptr);
+    header.msg_size_ = sizeof(Message) + 1;
+    memcpy(datagram, &header, sizeof(header));
+    CHECK(Publisher::for_each_message(datagram, sizeof(datagram), count) == nullptr);
+    CHECK_EQ(seen, 2u);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
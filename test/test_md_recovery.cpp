@@ -0,0 +1,169 @@
+#include "test/test_utils.h"
+#include "test/two_stream_feed.h"
+
+#include "trading/market_data/market_data_consumer.h"
+
+// MarketDataConsumer snapshot + incremental recovery over the two multicast streams on lo: incrementals are dropped
+// on the publisher side and the books rebuilt from what the consumer forwards have to match the publisher's, level by
+// level, once it is back in sync.
+
+using namespace Common;
+using Test::TwoStreamFeed;
+using Trading::MarketOrderBook;
+
+namespace {
+    const std::string IFACE = "lo";
+    const std::string INCREMENTAL_IP = "239.0.0.96";
+    constexpr int INCREMENTAL_PORT = 20096;
+    const std::string SNAPSHOT_IP = "239.0.0.97";
+    constexpr int SNAPSHOT_PORT = 20097;
+    constexpr std::size_t NUM_INSTRUMENTS = 2;
+    constexpr std::size_t DEPTH = 10; // a snapshot of a few datagrams
+
+    auto& feed_logger() {
+        static Logger logger("test_md_recovery_feed.log");
+        return logger;
+    }
+
+    auto make_feed() {
+        return std::make_unique<TwoStreamFeed>(feed_logger(), IFACE, INCREMENTAL_IP, INCREMENTAL_PORT, SNAPSHOT_IP, SNAPSHOT_PORT,
+                                               NUM_INSTRUMENTS, DEPTH);
+    }
+
+    // consumer plus the books built from its output, the way the trade engine would
+    struct Client {
+        Exchange::MEMarketUpdateLFQueue updates_{Trading::MD_MAX_QUEUED_INCREMENTALS};
+        Trading::MarketDataConsumer consumer_;
+        std::vector<std::unique_ptr<MarketOrderBook>> books_;
+
+        explicit Client(ClientId client_id)
+            : consumer_{client_id, &updates_, IFACE, SNAPSHOT_IP, SNAPSHOT_PORT, INCREMENTAL_IP, INCREMENTAL_PORT} {
+            for (std::size_t ticker_id = 0; ticker_id < NUM_INSTRUMENTS; ++ticker_id)
+                books_.push_back(std::make_unique<MarketOrderBook>(static_cast<TickerId>(ticker_id)));
+        }
+
+        auto poll() {
+            consumer_.poll();
+            for (auto update = updates_.get_next_read(); update; update = updates_.get_next_read()) {
+                books_[update->ticker_id_]->on_market_update(update);
+                updates_.update_read_index();
+            }
+        }
+
+        template<typename F>
+        auto poll_until(F&& done, Nanos timeout = 1'000'000'000) {
+            const auto deadline = getCurrentNanos() + timeout;
+            while (!done()) {
+                if (getCurrentNanos() > deadline)
+                    return false;
+                poll();
+            }
+            return true;
+        }
+
+        // caught up with everything the feed sequenced and not recovering
+        auto in_sync_with(const TwoStreamFeed& feed) {
+            return poll_until([&]() { return !consumer_.in_recovery() && consumer_.next_expected_seq_num() == feed.next_seq_num(); });
+        }
+
+        auto books_match(const TwoStreamFeed& feed) const {
+            for (std::size_t ticker_id = 0; ticker_id < NUM_INSTRUMENTS; ++ticker_id)
+                if (!Test::same_book(*books_[ticker_id], feed.reference_book(static_cast<TickerId>(ticker_id))))
+                    return false;
+            return true;
+        }
+    };
+
+    // n incrementals go out while the snapshot is being sent, after its first datagram. The consumer reads one datagram
+    // per stream per poll, so they are all queued by the time the snapshot completes and get replayed on top of it
+    auto publish_snapshot_with(TwoStreamFeed& feed, Client& client, std::size_t n) {
+        client.poll_until([]() { return false; }, 20'000'000);
+        feed.start_snapshot();
+        REQUIRE(feed.send_snapshot_datagram());
+        feed.publish(n);
+        while (feed.send_snapshot_datagram());
+    }
+
+    // a few datagrams at a time, the consumer reads one per poll and lo must not overflow its receive buffer
+    auto publish(TwoStreamFeed& feed, Client& client, std::size_t n) {
+        for (std::size_t i = 0; i < n; i += 100) {
+            feed.publish(std::min<std::size_t>(100, n - i));
+            client.poll_until([&]() { return client.consumer_.in_recovery() || client.consumer_.next_expected_seq_num() == feed.next_seq_num(); });
+        }
+    }
+}
+
+TEST(md_recovery_rebuilds_the_book_after_dropped_incrementals) {
+    auto feed = make_feed();
+    Client client(11);
+
+    publish(*feed, client, 1'000);
+    REQUIRE(client.in_sync_with(*feed));
+    CHECK(client.books_match(*feed));
+    CHECK_EQ(client.consumer_.get_recovery_stats().num_recoveries_, 0u);
+
+    // lost on the wire, the next incremental read is a gap
+    feed->publish(37, true);
+    feed->publish(50);
+    REQUIRE(client.poll_until([&]() { return client.consumer_.in_recovery(); }));
+
+    // incrementals keep flowing while the snapshot is out, the ones after it are replayed on top of it
+    feed->publish(50);
+    publish_snapshot_with(*feed, client, 60);
+    const auto snapshot_size = feed->snapshot_size();
+    REQUIRE(client.in_sync_with(*feed));
+    CHECK(client.books_match(*feed));
+
+    const auto& stats = client.consumer_.get_recovery_stats();
+    CHECK_EQ(stats.num_recoveries_, 1u);
+    CHECK_EQ(stats.snapshot_updates_, snapshot_size - 2);
+    CHECK_EQ(stats.incrementals_replayed_, 60u);
+    CHECK_EQ(stats.incrementals_dropped_, 0u);
+    CHECK(stats.end_time_ >= stats.start_time_);
+
+    // and stays in sync on the plain incremental path afterwards
+    publish(*feed, client, 500);
+    REQUIRE(client.in_sync_with(*feed));
+    CHECK(client.books_match(*feed));
+    CHECK_EQ(client.consumer_.get_recovery_stats().num_recoveries_, 1u);
+}
+
+TEST(md_recovery_waits_for_a_snapshot_the_incrementals_line_up_with) {
+    auto feed = make_feed();
+    Client client(12);
+
+    publish(*feed, client, 500);
+    REQUIRE(client.in_sync_with(*feed));
+
+    feed->publish(20, true);
+    feed->publish(20);
+    REQUIRE(client.poll_until([&]() { return client.consumer_.in_recovery(); }));
+
+    // the incrementals right after the first snapshot are lost as well, it cannot be used
+    feed->publish_snapshot();
+    feed->publish(10, true);
+    feed->publish(20);
+    client.poll_until([]() { return false; }, 50'000'000);
+    CHECK(client.consumer_.in_recovery());
+
+    publish_snapshot_with(*feed, client, 20);
+    REQUIRE(client.in_sync_with(*feed));
+    CHECK(client.books_match(*feed));
+}
+
+TEST(md_recovery_late_joiner_syncs_from_the_snapshot) {
+    auto feed = make_feed();
+    // a session in progress that nobody was listening to
+    feed->publish(2'000);
+
+    Client client(13);
+    feed->publish(30);
+    REQUIRE(client.poll_until([&]() { return client.consumer_.in_recovery(); }));
+
+    publish_snapshot_with(*feed, client, 30);
+    REQUIRE(client.in_sync_with(*feed));
+    CHECK(client.books_match(*feed));
+    CHECK_EQ(client.consumer_.get_recovery_stats().incrementals_replayed_, 30u);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
@@ -0,0 +1,90 @@
+#include "test/test_utils.h"
+
+#include "common/tcp_server.h"
+#include "trading/order_gw/order_gateway.h"
+
+// OrderGateway response sequencing against a TCPServer standing in for the exchange on lo: a gap in the response seq
+// numbers is counted and the session resyncs to it instead of dropping everything after, duplicates are dropped.
+
+using namespace Common;
+using namespace Exchange;
+
+namespace {
+    const std::string IFACE = "lo";
+    constexpr int PORT = 12362;
+    constexpr ClientId CLIENT = 5;
+
+    struct Session {
+        Logger logger_{"test_order_gateway_exchange.log"};
+        TCPServer server_{logger_};
+        ClientResponseLFQueue responses_{ME_MAX_CLIENT_UPDATES};
+        Trading::OrderGateway gateway_{CLIENT, &responses_, "", IFACE, PORT};
+
+        Session() {
+            server_.recv_callback_ = [](TCPSocket* socket, Nanos) { socket->next_recv_valid_index_ = 0; };
+            server_.recv_finished_callback_ = []() {};
+            server_.listen(IFACE, PORT);
+            gateway_.connect();
+        }
+
+        ~Session() {
+            for (auto socket : server_.receive_sockets_)
+                close(socket->socket_fd_);
+            close(server_.listener_socket_.socket_fd_);
+        }
+
+        template<typename F>
+        auto poll_until(F&& done) {
+            const auto deadline = getCurrentNanos() + 1'000'000'000;
+            while (!done() && getCurrentNanos() < deadline) {
+                server_.poll();
+                server_.send_and_recv();
+                gateway_.poll(getCurrentNanos());
+            }
+            return done();
+        }
+
+        // exchange -> gateway, response seq numbers as given
+        auto send_responses(std::initializer_list<std::size_t> seq_nums) {
+            auto socket = server_.receive_sockets_.front();
+            for (const auto seq_num : seq_nums) {
+                const OMClientResponse response{seq_num, {ClientResponseType::FILLED, CLIENT, 0, seq_num, seq_num, Side::BUY, 100, 1, 0}};
+                socket->send(&response, sizeof(response));
+            }
+            socket->flush();
+        }
+
+        auto take_responses() {
+            std::vector<OrderId> client_order_ids;
+            for (auto response = responses_.get_next_read(); response; response = responses_.get_next_read()) {
+                client_order_ids.push_back(response->client_order_id_);
+                responses_.update_read_index();
+            }
+            return client_order_ids;
+        }
+    };
+}
+
+TEST(order_gateway_resyncs_after_a_response_gap_and_drops_duplicates) {
+    Session session;
+    REQUIRE(session.poll_until([&]() { return session.server_.receive_sockets_.size() == 1; }));
+
+    session.send_responses({1, 2});
+    REQUIRE(session.poll_until([&]() { return session.gateway_.next_expected_seq_num() == 3; }));
+    CHECK_EQ(session.gateway_.num_response_gaps(), 0u);
+
+    // 3 and 4 never arrive, a late 4 after the resync is a duplicate
+    session.send_responses({5, 6, 4, 7});
+    REQUIRE(session.poll_until([&]() { return session.gateway_.next_expected_seq_num() == 8; }));
+    CHECK_EQ(session.gateway_.num_response_gaps(), 1u);
+    CHECK_EQ(session.gateway_.num_missed_responses(), 2u);
+    CHECK(session.take_responses() == std::vector<OrderId>({1, 2, 5, 6, 7}));
+
+    // and carries on in sequence
+    session.send_responses({8});
+    REQUIRE(session.poll_until([&]() { return session.gateway_.next_expected_seq_num() == 9; }));
+    CHECK(session.take_responses() == std::vector<OrderId>({8}));
+    CHECK_EQ(session.gateway_.num_response_gaps(), 1u);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
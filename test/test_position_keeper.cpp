@@ -0,0 +1,108 @@
+#include <tuple>
+#include <unistd.h>
+
+#include "test/test_utils.h"
+
+#include "trading/strategy/position_keeper.h"
+
+// PositionKeeper::replay() over an OrderJournal as the gateway writes it: fills are attributed to the strategy of the
+// NEW_SENT with the same client order id and end up in the same positions as feeding them live.
+
+using namespace Common;
+using namespace Trading;
+using Exchange::ClientResponseType;
+
+namespace {
+    const std::string DIR = "/tmp";
+    constexpr ClientId CLIENT = 3;
+
+    auto remove_journal(const std::string& name) {
+        for (uint64_t index = 0; unlink(journal_segment_path(DIR, name, index).c_str()) == 0; ++index);
+    }
+
+    struct Order {
+        StrategyId strategy_id_;
+        TickerId ticker_id_;
+        OrderId client_order_id_;
+        Side side_;
+    };
+
+    auto sent(const Order& order, std::size_t seq_num) {
+        return OrderEvent{OrderEventType::NEW_SENT, order.ticker_id_, order.client_order_id_, OrderId_INVALID, order.side_, 100, 10, 10,
+                          seq_num, order.strategy_id_};
+    }
+
+    auto response(ClientResponseType type, const Order& order, Price price, Qty exec_qty) {
+        return Exchange::MEClientResponse{type, CLIENT, order.ticker_id_, order.client_order_id_, order.client_order_id_ + 1000,
+                                          order.side_, price, exec_qty, 10};
+    }
+
+    auto same_position(const PositionInfo& a, const PositionInfo& b) {
+        return a.position_ == b.position_ && a.open_cost_ == b.open_cost_ && a.realized_pnl_ == b.realized_pnl_ &&
+               a.volume_ == b.volume_ && a.unrealized_pnl_ == b.unrealized_pnl_ && a.net_exposure_ == b.net_exposure_;
+    }
+}
+
+TEST(position_keeper_replay_rebuilds_positions_from_the_order_journal) {
+    const std::string name = "test_position_keeper_replay";
+    remove_journal(name);
+
+    const Order orders[] = {
+        {0, 0, 1, Side::BUY},
+        {1, 0, 2, Side::SELL},
+        {1, 1, 3, Side::BUY},
+        {0, 0, 4, Side::SELL},
+    };
+    // (order, price, qty), the last two close most of strategy 0's long at a profit
+    const std::tuple<std::size_t, Price, Qty> fills[] = {
+        {0, 100, 5}, {1, 101, 3}, {0, 102, 2}, {2, 50, 4}, {3, 105, 4}, {3, 106, 1},
+    };
+
+    PositionKeeper live(2, 2);
+    {
+        OrderJournal journal(DIR, name, JOURNAL_HEADER_SIZE + 64 * sizeof(OrderJournal::Record), 16, 1024);
+        std::size_t seq_num = 1;
+        for (const auto& order : orders) {
+            journal.append(sent(order, seq_num++), 0);
+            journal.append(order_event_from_response(response(ClientResponseType::ACCEPTED, order, 100, 0)), 0);
+        }
+        for (const auto& [index, price, qty] : fills) {
+            const auto& order = orders[index];
+            const auto filled = response(ClientResponseType::FILLED, order, price, qty);
+            journal.append(order_event_from_response(filled), 0);
+            live.on_fill(order.strategy_id_, filled);
+        }
+        journal.append({OrderEventType::CANCEL_SENT, 0, 2, OrderId_INVALID, Side::SELL, Price_INVALID, Qty_INVALID, Qty_INVALID,
+                        seq_num++, 1}, 0);
+        // a fill for an order the journal never saw sent, e.g. one from before the journal was started
+        journal.append(order_event_from_response(response(ClientResponseType::FILLED, {0, 0, 99, Side::BUY}, 100, 7)), 0);
+    }
+
+    PositionKeeper replayed(2, 2);
+    const auto result = replayed.replay(DIR, name);
+    CHECK_EQ(result.fills_, std::size(fills));
+    CHECK_EQ(result.unattributed_fills_, 1u);
+    CHECK_EQ(result.journal_.records_, 2 * std::size(orders) + std::size(fills) + 2);
+    CHECK(!result.journal_.torn_);
+
+    for (StrategyId strategy_id = 0; strategy_id < 2; ++strategy_id)
+        for (TickerId ticker_id = 0; ticker_id < 2; ++ticker_id)
+            CHECK(same_position(replayed.get_position(strategy_id, ticker_id), live.get_position(strategy_id, ticker_id)));
+
+    CHECK_EQ(replayed.get_position(0, 0).position_, 2);
+    // long 7 at a cost of 704: 4 sold at 105 realize 420 - 704 * 4 / 7, 1 at 106 realizes 106 - 302 / 3
+    CHECK_EQ(replayed.get_position(0, 0).realized_pnl_, 24);
+    CHECK_EQ(replayed.get_position(1, 0).position_, -3);
+    CHECK_EQ(replayed.get_position(1, 1).position_, 4);
+    CHECK_EQ(replayed.get_aggregate_totals().volume_, live.get_aggregate_totals().volume_);
+    CHECK_EQ(replayed.get_aggregate_totals().realized_pnl_, live.get_aggregate_totals().realized_pnl_);
+
+    // marks were not journaled, the next BBO brings unrealized pnl back in line
+    replayed.on_bbo(0, 104, 106);
+    live.on_bbo(0, 104, 106);
+    CHECK(same_position(replayed.get_position(0, 0), live.get_position(0, 0)));
+    CHECK_EQ(replayed.get_aggregate_totals().total_pnl(), live.get_aggregate_totals().total_pnl());
+    remove_journal(name);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
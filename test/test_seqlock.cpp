@@ -0,0 +1,97 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test/test_utils.h"
+
+#include "common/seqlock.h"
+
+// SeqLocked under a writer that never stops: every value a reader gets back has to be one the writer stored whole,
+// and a reader never goes back in sequence.
+
+using namespace Common;
+
+namespace {
+    // every field derived from value_, a torn read shows up as fields that disagree
+    struct Snapshot {
+        uint64_t value_ = 0;
+        uint64_t inverted_ = ~0ull;
+        uint64_t squared_ = 0;
+        char tag_[40] = {};
+
+        static auto make(uint64_t value) {
+            Snapshot snapshot;
+            snapshot.value_ = value;
+            snapshot.inverted_ = ~value;
+            snapshot.squared_ = value * value;
+            memset(snapshot.tag_, static_cast<int>(value & 0x7f), sizeof(snapshot.tag_));
+            return snapshot;
+        }
+
+        auto is_consistent() const {
+            return *this == make(value_);
+        }
+
+        auto operator==(const Snapshot& other) const -> bool {
+            return value_ == other.value_ && inverted_ == other.inverted_ && squared_ == other.squared_ && !memcmp(tag_, other.tag_, sizeof(tag_));
+        }
+    };
+}
+
+TEST(seqlock_sequence_counts_writes) {
+    SeqLocked<Snapshot> locked;
+    CHECK_EQ(locked.sequence(), 0u);
+    locked.store(Snapshot::make(1));
+    locked.store(Snapshot::make(2));
+    CHECK_EQ(locked.sequence(), 4u);
+
+    uint64_t seq = 0;
+    CHECK_EQ(locked.load(seq).value_, 2u);
+    CHECK_EQ(seq, 4u);
+}
+
+TEST(seqlock_readers_never_see_a_torn_or_older_value) {
+    constexpr uint64_t num_writes = 200'000;
+    constexpr std::size_t num_readers = 3;
+    SeqLocked<Snapshot> locked;
+    // the slot starts out all zero bytes, which is not a consistent Snapshot, readers must only ever see stored ones
+    locked.store(Snapshot::make(0));
+    std::atomic<bool> done {false};
+
+    std::vector<std::size_t> torn(num_readers, 0), backwards(num_readers, 0), reads(num_readers, 0);
+    std::vector<std::thread> readers;
+    for (std::size_t r = 0; r < num_readers; ++r) {
+        readers.emplace_back([&, r]() {
+            uint64_t last_value = 0, last_seq = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                uint64_t seq = 0;
+                const auto snapshot = locked.load(seq);
+                torn[r] += !snapshot.is_consistent();
+                backwards[r] += snapshot.value_ < last_value || seq < last_seq || seq & 1;
+                last_value = snapshot.value_;
+                last_seq = seq;
+                ++reads[r];
+                // gives the writer the cpu on a single core box
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for (uint64_t i = 1; i <= num_writes; ++i) {
+        locked.store(Snapshot::make(i));
+        if (!(i % 1'000))
+            std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& reader : readers)
+        reader.join();
+
+    for (std::size_t r = 0; r < num_readers; ++r) {
+        CHECK_EQ(torn[r], 0u);
+        CHECK_EQ(backwards[r], 0u);
+        CHECK(reads[r] > 0);
+    }
+    CHECK_EQ(locked.load().value_, num_writes);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
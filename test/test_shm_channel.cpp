@@ -0,0 +1,144 @@
+#include <thread>
+#include <sys/wait.h>
+
+#include "test/test_utils.h"
+
+#include "common/shm_channel.h"
+
+// ShmChannel between a creator and an attacher: ordering, full / empty, wrap around, resuming after a reattach, a
+// producer in a forked process, and attachers that start before the creator.
+
+using namespace Common;
+
+namespace {
+    struct Message {
+        uint64_t seq_num_ = 0;
+        uint64_t check_ = 0;
+    };
+
+    const std::string NAME = "/test_shm_channel";
+}
+
+TEST(shm_channel_in_order_full_and_empty) {
+    ShmChannel<Message> producer(NAME, ShmChannelRole::PRODUCER, 4);
+    ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER);
+    CHECK_EQ(consumer.capacity(), 4u);
+    CHECK(consumer.get_next_read() == nullptr);
+
+    uint64_t next_write = 1, next_read = 1;
+    // several laps of the ring, filling it up each time
+    for (int lap = 0; lap < 5; ++lap) {
+        while (auto slot = producer.get_next_write()) {
+            *slot = {next_write, ~next_write};
+            producer.update_write_index();
+            ++next_write;
+        }
+        CHECK_EQ(producer.size(), 4u);
+        while (auto msg = consumer.get_next_read()) {
+            CHECK_EQ(msg->seq_num_, next_read);
+            CHECK_EQ(msg->check_, ~next_read);
+            consumer.update_read_index();
+            ++next_read;
+        }
+        CHECK_EQ(consumer.size(), 0u);
+    }
+    CHECK_EQ(next_read, 21u);
+}
+
+TEST(shm_channel_consumer_resumes_where_it_left_off) {
+    ShmChannel<Message> producer(NAME, ShmChannelRole::PRODUCER, 8);
+    for (uint64_t i = 1; i <= 6; ++i) {
+        *producer.get_next_write() = {i, ~i};
+        producer.update_write_index();
+    }
+    {
+        ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER);
+        for (uint64_t i = 1; i <= 2; ++i) {
+            CHECK_EQ(consumer.get_next_read()->seq_num_, i);
+            consumer.update_read_index();
+        }
+        CHECK(producer.is_peer_alive(getCurrentNanos(), 1'000'000'000));
+    }
+    CHECK(!producer.is_peer_alive(getCurrentNanos(), 1'000'000'000));
+
+    ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER);
+    const auto msg = consumer.get_next_read();
+    REQUIRE(msg != nullptr);
+    CHECK_EQ(msg->seq_num_, 3u);
+    CHECK_EQ(consumer.size(), 4u);
+}
+
+TEST(shm_channel_across_processes) {
+    constexpr uint64_t count = 100'000;
+    ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER, 64);
+
+    const auto pid = fork();
+    REQUIRE(pid >= 0);
+    if (!pid) {
+        ShmChannel<Message> producer(NAME, ShmChannelRole::PRODUCER);
+        for (uint64_t i = 1; i <= count; ++i) {
+            Message* slot;
+            while (!(slot = producer.get_next_write()))
+                sched_yield();
+            *slot = {i, ~i};
+            producer.update_write_index();
+        }
+        _exit(0);
+    }
+
+    uint64_t next = 1, bad = 0;
+    const auto deadline = getCurrentNanos() + 10'000'000'000;
+    while (next <= count && getCurrentNanos() < deadline) {
+        const auto msg = consumer.get_next_read();
+        if (!msg) {
+            sched_yield();
+            continue;
+        }
+        bad += msg->seq_num_ != next || msg->check_ != ~next;
+        consumer.update_read_index();
+        ++next;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK_EQ(next, count + 1);
+    CHECK_EQ(bad, 0u);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+TEST(shm_channel_attacher_waits_for_the_creator) {
+    shm_unlink(NAME.c_str());
+    std::atomic<uint64_t> first {0};
+    std::thread attacher([&]() {
+        ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER);
+        const Message* msg;
+        while (!(msg = consumer.get_next_read()))
+            std::this_thread::yield();
+        first = msg->seq_num_;
+        consumer.update_read_index();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ShmChannel<Message> producer(NAME, ShmChannelRole::PRODUCER, 4);
+    *producer.get_next_write() = {42, ~42ull};
+    producer.update_write_index();
+    attacher.join();
+    CHECK_EQ(first.load(), 42u);
+    CHECK_EQ(producer.size(), 0u);
+}
+
+TEST(shm_channel_attacher_gives_up_after_its_timeout) {
+    shm_unlink(NAME.c_str());
+    const auto start = getCurrentNanos();
+    const auto pid = fork();
+    REQUIRE(pid >= 0);
+    if (!pid) {
+        ShmChannel<Message> consumer(NAME, ShmChannelRole::CONSUMER, 0, 20'000'000);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE);
+    CHECK(getCurrentNanos() - start >= 20'000'000);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
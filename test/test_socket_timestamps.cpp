@@ -0,0 +1,228 @@
+#include <thread>
+#include <netinet/tcp.h>
+
+#include "test/test_utils.h"
+
+#include "common/mcast_socket.h"
+#include "common/tcp_server.h"
+
+// SO_TIMESTAMPING on a McastSocket pair over multicast loopback on lo and on a TCPServer / TCPSocket session: every
+// read carries a kernel rx timestamp, rx and tx timestamps never go backwards, and every tx timestamp is matched to the
+// send that produced it, by datagram count on UDP and by byte offset on TCP.
+
+using namespace Common;
+
+namespace {
+    const std::string GROUP = "239.0.0.98";
+    const std::string IFACE = "lo";
+    constexpr int PORT = 20098;
+    constexpr int TCP_PORT = 12360;
+
+    auto tcp_state(int fd) {
+        tcp_info info{};
+        socklen_t len = sizeof(info);
+        return getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 ? info.tcpi_state : 0;
+    }
+
+    // timestamps on both ends never went backwards and every send got its own tx timestamp
+    auto check_tcp_timestamps(const SocketTimestamps& timestamps, std::size_t sends) {
+        CHECK(timestamps.rx_latency_.count() > 0);
+        CHECK_EQ(timestamps.rx_non_monotonic_, 0u);
+        CHECK_EQ(timestamps.tx_latency_.count(), sends);
+        CHECK_EQ(timestamps.tx_unmatched_, 0u);
+        CHECK_EQ(timestamps.tx_non_monotonic_, 0u);
+    }
+}
+
+TEST(mcast_socket_timestamps_are_monotonic_and_every_send_is_matched) {
+    constexpr std::size_t num_msgs = 2'000;
+    Logger logger("test_socket_timestamps.log");
+    McastSocket publisher(logger), subscriber(logger);
+    REQUIRE(publisher.init(GROUP, IFACE, PORT, false, true) >= 0);
+    REQUIRE(subscriber.init(GROUP, IFACE, PORT, true, true) >= 0);
+    REQUIRE(subscriber.join(GROUP));
+
+    // the kernel turns rx timestamping on through a deferred static key, the first few datagrams after the socket
+    // asked for it can come without one. Only a gap after the first timestamp is a failure
+    std::size_t received = 0, before_first_rx_time = 0, missing_rx_time = 0, rx_backwards = 0;
+    Nanos last_rx_time = 0;
+    subscriber.recv_callback_ = [&](McastSocket* socket) {
+        received += socket->next_rcv_valid_index_ / sizeof(uint64_t);
+        if (!socket->rx_time_ && !last_rx_time)
+            ++before_first_rx_time;
+        else
+            missing_rx_time += !socket->rx_time_;
+        rx_backwards += socket->rx_time_ < last_rx_time;
+        last_rx_time = socket->rx_time_;
+        socket->next_rcv_valid_index_ = 0;
+    };
+
+    // the subscriber only reads every 16 sends, so it drains a backlog and tx timestamps pile up on the error queue
+    for (uint64_t i = 0; i < num_msgs; ++i) {
+        publisher.send(&i, sizeof(i));
+        publisher.send_and_recv();
+        if (i % 16 == 15)
+            while (subscriber.send_and_recv());
+    }
+
+    const auto deadline = getCurrentNanos() + 1'000'000'000;
+    while ((received < num_msgs || publisher.timestamps_.tx_latency_.count() < num_msgs) && getCurrentNanos() < deadline) {
+        subscriber.send_and_recv();
+        publisher.send_and_recv();
+        std::this_thread::yield();
+    }
+
+    CHECK_EQ(received, num_msgs);
+    CHECK_EQ(missing_rx_time, 0u);
+    CHECK_EQ(rx_backwards, 0u);
+    CHECK(before_first_rx_time < num_msgs / 2);
+    CHECK_EQ(subscriber.timestamps_.rx_latency_.count(), num_msgs - before_first_rx_time);
+    CHECK_EQ(subscriber.timestamps_.rx_non_monotonic_, 0u);
+
+    CHECK_EQ(publisher.timestamps_.tx_latency_.count(), num_msgs);
+    CHECK_EQ(publisher.timestamps_.tx_unmatched_, 0u);
+    CHECK_EQ(publisher.timestamps_.tx_non_monotonic_, 0u);
+    CHECK(publisher.timestamps_.tx_latency_.min() >= 0);
+
+    close(publisher.socket_fd_);
+    close(subscriber.socket_fd_);
+}
+
+TEST(mcast_socket_timestamps_are_off_by_default) {
+    Logger logger("test_socket_timestamps_off.log");
+    McastSocket publisher(logger), subscriber(logger);
+    REQUIRE(publisher.init(GROUP, IFACE, PORT + 1, false) >= 0);
+    REQUIRE(subscriber.init(GROUP, IFACE, PORT + 1, true) >= 0);
+    REQUIRE(subscriber.join(GROUP));
+    CHECK(!publisher.timestamps_.enabled_);
+    CHECK(!subscriber.timestamps_.enabled_);
+
+    std::size_t received = 0;
+    Nanos rx_time = -1;
+    subscriber.recv_callback_ = [&](McastSocket* socket) {
+        ++received;
+        rx_time = socket->rx_time_;
+        socket->next_rcv_valid_index_ = 0;
+    };
+    const uint64_t msg = 1;
+    publisher.send(&msg, sizeof(msg));
+    publisher.send_and_recv();
+    const auto deadline = getCurrentNanos() + 1'000'000'000;
+    while (!received && getCurrentNanos() < deadline)
+        subscriber.send_and_recv();
+    CHECK_EQ(received, 1u);
+    CHECK_EQ(rx_time, 0);
+    CHECK_EQ(publisher.timestamps_.tx_latency_.count(), 0u);
+
+    close(publisher.socket_fd_);
+    close(subscriber.socket_fd_);
+}
+
+TEST(tcp_socket_timestamps_match_every_send_on_client_and_accepted_socket) {
+    constexpr std::size_t num_msgs = 1'000;
+    Logger logger("test_socket_timestamps_tcp.log");
+
+    // echo server, counts its sends to know how many tx timestamps to expect
+    TCPServer server(logger);
+    std::size_t server_sends = 0;
+    server.recv_callback_ = [&](TCPSocket* socket, Nanos) {
+        socket->send(socket->inbound_data_.data(), socket->next_recv_valid_index_);
+        socket->next_recv_valid_index_ = 0;
+        server_sends += socket->flush() > 0;
+    };
+    server.recv_finished_callback_ = []() {};
+    server.listen(IFACE, TCP_PORT, true);
+
+    TCPSocket client(logger);
+    std::size_t received = 0;
+    client.recv_callback_ = [&](TCPSocket* socket, Nanos) {
+        received += socket->next_recv_valid_index_;
+        socket->next_recv_valid_index_ = 0;
+    };
+    REQUIRE(client.connect("", IFACE, TCP_PORT, false, true) >= 0);
+
+    // sizes vary so a key that is off by a few bytes cannot line up by accident
+    std::size_t sent = 0, client_sends = 0;
+    char msg[256] = {};
+    for (std::size_t i = 0; i < num_msgs; ++i) {
+        const auto len = 1 + (i * 37) % sizeof(msg);
+        client.send(msg, len);
+        client_sends += client.flush() > 0;
+        sent += len;
+        const auto deadline = getCurrentNanos() + 1'000'000'000;
+        while (received < sent && getCurrentNanos() < deadline) {
+            server.poll();
+            server.send_and_recv();
+            client.send_and_recv();
+        }
+    }
+    const auto deadline = getCurrentNanos() + 1'000'000'000;
+    while ((client.timestamps_.tx_latency_.count() < client_sends ||
+            (server.receive_sockets_.size() && server.receive_sockets_[0]->timestamps_.tx_latency_.count() < server_sends)) &&
+           getCurrentNanos() < deadline) {
+        server.send_and_recv();
+        client.send_and_recv();
+    }
+
+    CHECK_EQ(received, sent);
+    CHECK_EQ(client_sends, num_msgs);
+    check_tcp_timestamps(client.timestamps_, client_sends);
+    REQUIRE(server.receive_sockets_.size() == 1u);
+    CHECK(server.receive_sockets_[0]->timestamps_.enabled_);
+    check_tcp_timestamps(server.receive_sockets_[0]->timestamps_, server_sends);
+
+    close(client.socket_fd_);
+    close(server.receive_sockets_[0]->socket_fd_);
+    close(server.listener_socket_.socket_fd_);
+}
+
+// on a real network the non blocking connect() returns while the handshake is still going, TCPSocket::connect() turns
+// timestamping on in SYN_SENT. Reproduced on lo with a listener whose accept queue is full: the client's SYN is
+// dropped until the queue has room again and the retransmit gets through
+TEST(tcp_socket_timestamps_match_when_enabled_before_the_handshake_completes) {
+    const sockaddr_in addr{AF_INET, htons(TCP_PORT + 1), {htonl(INADDR_LOOPBACK)}, {}};
+    const auto listener = socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    REQUIRE(bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+    REQUIRE(::listen(listener, 0) == 0);
+    const auto filler = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(::connect(filler, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+
+    Logger logger("test_socket_timestamps_syn_sent.log");
+    TCPSocket client(logger);
+    client.recv_callback_ = [](TCPSocket* socket, Nanos) { socket->next_recv_valid_index_ = 0; };
+    REQUIRE(client.connect("127.0.0.1", IFACE, TCP_PORT + 1, false, true) >= 0);
+    CHECK_EQ(tcp_state(client.socket_fd_), TCP_SYN_SENT);
+
+    // make room, the SYN retransmit after the initial 1s RTO completes the handshake
+    close(accept(listener, nullptr, nullptr));
+    close(filler);
+    const auto deadline = getCurrentNanos() + 5'000'000'000;
+    while (tcp_state(client.socket_fd_) != TCP_ESTABLISHED && getCurrentNanos() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    REQUIRE(tcp_state(client.socket_fd_) == TCP_ESTABLISHED);
+    const auto server = accept(listener, nullptr, nullptr);
+    REQUIRE(server >= 0);
+
+    constexpr std::size_t num_msgs = 100;
+    char msg[64] = {};
+    for (std::size_t i = 0; i < num_msgs; ++i) {
+        client.send(msg, sizeof(msg));
+        REQUIRE(client.flush() == static_cast<ssize_t>(sizeof(msg)));
+        char buf[sizeof(msg)];
+        REQUIRE(recv(server, buf, sizeof(buf), MSG_WAITALL) == static_cast<ssize_t>(sizeof(buf)));
+    }
+    const auto tx_deadline = getCurrentNanos() + 1'000'000'000;
+    while (client.timestamps_.tx_latency_.count() < num_msgs && getCurrentNanos() < tx_deadline)
+        client.timestamps_.harvest_tx(client.socket_fd_);
+
+    CHECK_EQ(client.timestamps_.tx_latency_.count(), num_msgs);
+    CHECK_EQ(client.timestamps_.tx_unmatched_, 0u);
+
+    close(server);
+    close(client.socket_fd_);
+    close(listener);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
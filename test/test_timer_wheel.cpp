@@ -0,0 +1,151 @@
+#include <random>
+#include <vector>
+
+#include "test/test_utils.h"
+
+#include "common/timer_wheel.h"
+
+// TimerWheel against a brute force list of deadlines, TokenBucket and Throttle rate arithmetic. Time is driven by
+// hand from 0, nothing here reads the clock.
+
+using namespace Common;
+
+namespace {
+    // the time a deadline becomes due on a wheel of tick, deadlines round up to the next tick
+    auto due_time(Nanos deadline, Nanos tick) -> Nanos {
+        return std::max<Nanos>(1, (deadline + tick - 1) / tick) * tick;
+    }
+}
+
+TEST(timer_wheel_fires_every_timer_once_in_deadline_order_never_early) {
+    constexpr Nanos tick = 1'000;
+    constexpr std::size_t num_timers = 5'000;
+    TimerWheel<std::size_t> wheel(num_timers, tick, 0);
+
+    // spread over every level, up to 2^26 ticks out, plus a handful in the same tick
+    std::mt19937_64 rng(7);
+    std::vector<Nanos> deadlines;
+    for (std::size_t i = 0; i < num_timers; ++i) {
+        const auto level = rng() % 4;
+        const auto span = static_cast<Nanos>(1) << std::min<std::size_t>(26, TW_SLOT_BITS * (level + 1));
+        deadlines.push_back(i < 16 ? 5 * tick + 1 : static_cast<Nanos>(rng() % static_cast<uint64_t>(span * tick)));
+        wheel.schedule(deadlines.back(), i);
+    }
+    CHECK_EQ(wheel.size(), num_timers);
+
+    std::vector<std::size_t> fire_count(num_timers, 0);
+    Nanos last_due = 0;
+    Nanos prev_now = 0;
+    std::size_t late = 0, early = 0, out_of_order = 0;
+    for (Nanos now = 0; wheel.size();) {
+        // mostly a few hundred ticks at a time, now and then a long jump over whole level 1 and 2 slots
+        now += static_cast<Nanos>(rng() % (rng() % 10 ? 300 * tick : (1 << 20) * tick));
+        wheel.advance(now, [&](std::size_t i) {
+            ++fire_count[i];
+            const auto due = due_time(deadlines[i], tick);
+            early += due > now;
+            late += due <= prev_now;
+            out_of_order += due < last_due;
+            last_due = due;
+        });
+        prev_now = now;
+    }
+    CHECK_EQ(early, 0u);
+    CHECK_EQ(late, 0u);
+    CHECK_EQ(out_of_order, 0u);
+    CHECK(std::all_of(fire_count.begin(), fire_count.end(), [](auto n) { return n == 1; }));
+}
+
+TEST(timer_wheel_cancel) {
+    TimerWheel<int> wheel(8, 1'000, 0);
+    auto a = wheel.schedule(10'000, 1);
+    auto b = wheel.schedule(10'000, 2);
+    auto far = wheel.schedule(100'000'000, 3);
+    CHECK(wheel.is_pending(a));
+    CHECK(wheel.cancel(a));
+    CHECK(!wheel.is_pending(a));
+    CHECK(!wheel.cancel(a));
+    CHECK(wheel.cancel(far));
+    CHECK_EQ(wheel.size(), 1u);
+
+    std::vector<int> fired;
+    CHECK_EQ(wheel.advance(9'999, [&](int p) { fired.push_back(p); }), 0u);
+    CHECK_EQ(wheel.advance(10'000, [&](int p) { fired.push_back(p); }), 1u);
+    CHECK(fired == std::vector<int>{2});
+
+    // a handle of a timer that already fired stays safe, even once its node is reused
+    CHECK(!wheel.is_pending(b));
+    auto c = wheel.schedule(20'000, 4);
+    CHECK(!wheel.cancel(b));
+    CHECK(wheel.is_pending(c));
+    CHECK_EQ(wheel.size(), 1u);
+}
+
+TEST(timer_wheel_past_deadline_fires_on_next_tick_and_callback_may_reschedule) {
+    TimerWheel<int> wheel(4, 1'000, 0);
+    wheel.advance(50'000, [](int) {});
+    wheel.schedule(1'000, 1);
+
+    int fired = 0;
+    wheel.advance(50'999, [&](int) { ++fired; });
+    CHECK_EQ(fired, 0);
+    wheel.advance(51'000, [&](int p) {
+        ++fired;
+        // rescheduled for the tick being processed, must wait for the next call
+        if (p == 1)
+            wheel.schedule(51'000, 2);
+    });
+    CHECK_EQ(fired, 1);
+    wheel.advance(52'000, [&](int p) { fired += p; });
+    CHECK_EQ(fired, 3);
+    CHECK_EQ(wheel.size(), 0u);
+}
+
+TEST(token_bucket_burst_then_rate) {
+    TokenBucket bucket(100, 2);
+    CHECK(bucket.try_acquire(0));
+    CHECK(bucket.try_acquire(0));
+    CHECK(!bucket.try_acquire(0));
+    CHECK_EQ(bucket.available_at(0), 100);
+    CHECK(!bucket.try_acquire(99));
+    CHECK(bucket.try_acquire(100));
+    CHECK(!bucket.try_acquire(100));
+
+    // idle long enough refills the whole burst and no more
+    CHECK(bucket.try_acquire(10'000));
+    CHECK(bucket.try_acquire(10'000));
+    CHECK(!bucket.try_acquire(10'000));
+
+    // reservations queue up one interval apart
+    CHECK_EQ(bucket.reserve(10'000), 10'100);
+    CHECK_EQ(bucket.reserve(10'000), 10'200);
+    CHECK_EQ(bucket.available_at(10'000), 10'300);
+}
+
+TEST(throttle_defers_in_order_and_rejects_past_max_deferred) {
+    Throttle<int> throttle(100, 3, 2, 10, 0);
+    CHECK(throttle.submit(0, 1) == ThrottleResult::SEND);
+    CHECK(throttle.submit(0, 2) == ThrottleResult::SEND);
+    CHECK(throttle.submit(0, 3) == ThrottleResult::SEND);
+    CHECK(throttle.submit(0, 4) == ThrottleResult::DEFERRED);
+    CHECK(throttle.submit(0, 5) == ThrottleResult::DEFERRED);
+    CHECK(throttle.submit(0, 6) == ThrottleResult::REJECTED);
+    CHECK_EQ(throttle.num_deferred(), 2u);
+
+    std::vector<std::pair<Nanos, int>> released;
+    auto poll_until = [&](Nanos until) {
+        for (Nanos now = 0; now <= until; now += 10)
+            throttle.poll(now, [&](int p) { released.emplace_back(now, p); });
+    };
+    poll_until(150);
+    CHECK((released == std::vector<std::pair<Nanos, int>>{{100, 4}}));
+
+    // queues behind what is still deferred, one interval after it
+    CHECK(throttle.submit(150, 7) == ThrottleResult::DEFERRED);
+    poll_until(1'000);
+    CHECK((released == std::vector<std::pair<Nanos, int>>{{100, 4}, {200, 5}, {300, 7}}));
+    CHECK_EQ(throttle.num_deferred(), 0u);
+    CHECK(throttle.submit(1'000, 8) == ThrottleResult::SEND);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal harness for the tests in test/, one executable per component registered with ctest. TEST() cases register
+// themselves, CHECK() / CHECK_EQ() report a failure and carry on so one run shows every broken expectation, REQUIRE()
+// stops the case when the rest of it would make no sense. The executable's exit code is the number of failed cases.
+//
+//     TEST(timer_wheel_fires_in_order) {
+//         ...
+//         CHECK_EQ(fired.size(), 3u);
+//     }
+//
+//     int main(int argc, char** argv) { return Test::run_all(argc, argv); }
+
+namespace Test {
+
+    struct TestCase {
+        std::string name_;
+        std::function<void()> body_;
+    };
+
+    inline auto registry() -> std::vector<TestCase>& {
+        static std::vector<TestCase> cases;
+        return cases;
+    }
+
+    inline auto current_failures() -> std::size_t& {
+        static std::size_t failures = 0;
+        return failures;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, std::function<void()> body) { registry().push_back({name, std::move(body)}); }
+    };
+
+    // thrown by REQUIRE() to leave the current case
+    struct RequireFailed {};
+
+    inline auto fail(const char* file, int line, const std::string& what) {
+        std::cerr << "  " << file << ":" << line << ": " << what << '\n';
+        ++current_failures();
+    }
+
+    template<typename A, typename B>
+    inline auto check_eq(const A& a, const B& b, const char* a_str, const char* b_str, const char* file, int line) {
+        if (a == b)
+            return true;
+        std::stringstream ss;
+        ss << "CHECK_EQ(" << a_str << ", " << b_str << ") " << a << " != " << b;
+        fail(file, line, ss.str());
+        return false;
+    }
+
+    // runs every case, or only those whose name contains argv[1]
+    inline auto run_all(int argc, char** argv) -> int {
+        const std::string filter = argc > 1 ? argv[1] : "";
+        int failed = 0;
+        for (const auto& test : registry()) {
+            if (!filter.empty() && test.name_.find(filter) == std::string::npos)
+                continue;
+            current_failures() = 0;
+            try {
+                test.body_();
+            } catch (const RequireFailed&) {
+            }
+            std::cerr << (current_failures() ? "FAIL " : "ok   ") << test.name_ << '\n';
+            failed += current_failures() != 0;
+        }
+        return failed;
+    }
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static const Test::Registrar registrar_##name{#name, test_##name}; \
+    static void test_##name()
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+            Test::fail(__FILE__, __LINE__, "CHECK(" #cond ")"); \
+    } while (false)
+
+#define CHECK_EQ(a, b) Test::check_eq((a), (b), #a, #b, __FILE__, __LINE__)
+
+#define REQUIRE(cond) \
+    do { \
+        if (!(cond)) { \
+            Test::fail(__FILE__, __LINE__, "REQUIRE(" #cond ")"); \
+            throw Test::RequireFailed{}; \
+        } \
+    } while (false)
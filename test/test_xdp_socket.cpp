@@ -0,0 +1,123 @@
+#include <iostream>
+#include <linux/bpf.h>
+
+#include "test/test_utils.h"
+
+#include "common/xdp_socket.h"
+
+// XdpSocket's hand written filter program run through BPF_PROG_TEST_RUN over crafted frames, nothing gets attached:
+// only IPv4 / UDP without IP options to the group and port reaches the redirect, every other frame is XDP_PASSed.
+// With no socket in the map the redirect falls back to the action it is given, XDP_DROP here so a match is visible.
+// Skipped without CAP_BPF. The UDP payload length recv_batch() hands out comes from the UDP header.
+
+using namespace Common;
+
+namespace {
+    const std::string GROUP = "239.0.0.30";
+    constexpr int PORT = 20030;
+    constexpr uint16_t PAYLOAD_LEN = 64;
+
+    // ethernet + IPv4 + UDP + payload, to GROUP:PORT unless changed afterwards
+    auto make_frame() {
+        std::vector<uint8_t> frame(XDP_UDP_PAYLOAD_OFFSET + PAYLOAD_LEN, 0);
+        const uint8_t mac[] = {0x01, 0x00, 0x5e, 0x00, 0x00, 0x1e};
+        memcpy(frame.data(), mac, sizeof(mac));
+        frame[12] = 0x08;                                  // ethertype IPv4
+        frame[13] = 0x00;
+        frame[14] = 0x45;                                  // version 4, ihl 5
+        const uint16_t ip_len = htons(20 + 8 + PAYLOAD_LEN);
+        memcpy(&frame[16], &ip_len, sizeof(ip_len));
+        frame[22] = 1;                                     // ttl
+        frame[23] = IPPROTO_UDP;
+        in_addr group{};
+        inet_pton(AF_INET, GROUP.c_str(), &group);
+        memcpy(&frame[30], &group.s_addr, sizeof(group.s_addr));
+        const uint16_t src_port = htons(40000), dst_port = htons(PORT), udp_len = htons(8 + PAYLOAD_LEN);
+        memcpy(&frame[34], &src_port, sizeof(src_port));
+        memcpy(&frame[36], &dst_port, sizeof(dst_port));
+        memcpy(&frame[38], &udp_len, sizeof(udp_len));
+        return frame;
+    }
+
+    struct Filter {
+        Logger logger_{"test_xdp_socket.log"};
+
+        auto run(const std::vector<uint8_t>& frame) {
+            return XdpSocket::test_filter(logger_, GROUP, PORT, frame.data(), static_cast<uint32_t>(frame.size()), XDP_DROP);
+        }
+
+        // BPF_PROG_LOAD / BPF_PROG_TEST_RUN need CAP_BPF (or root)
+        auto usable() {
+            if (run(make_frame()) >= 0)
+                return true;
+            std::cout << "  skipped, cannot load or run BPF programs here (needs CAP_BPF)\n";
+            return false;
+        }
+    };
+}
+
+TEST(xdp_filter_redirects_only_the_group_and_port) {
+    Filter filter;
+    if (!filter.usable())
+        return;
+
+    CHECK_EQ(filter.run(make_frame()), XDP_DROP);
+
+    // ethernet trailer padding after the datagram does not matter to the filter
+    auto padded = make_frame();
+    padded.resize(padded.size() + 4, 0);
+    CHECK_EQ(filter.run(padded), XDP_DROP);
+
+    auto other_port = make_frame();
+    const uint16_t port = htons(PORT + 1);
+    memcpy(&other_port[36], &port, sizeof(port));
+    CHECK_EQ(filter.run(other_port), XDP_PASS);
+
+    auto other_group = make_frame();
+    other_group[33] ^= 1;
+    CHECK_EQ(filter.run(other_group), XDP_PASS);
+
+    auto tcp = make_frame();
+    tcp[23] = IPPROTO_TCP;
+    CHECK_EQ(filter.run(tcp), XDP_PASS);
+
+    auto ipv6 = make_frame();
+    ipv6[12] = 0x86;
+    ipv6[13] = 0xdd;
+    CHECK_EQ(filter.run(ipv6), XDP_PASS);
+
+    // IP options move the UDP header, the program only handles ihl == 5
+    auto ip_options = make_frame();
+    ip_options[14] = 0x46;
+    CHECK_EQ(filter.run(ip_options), XDP_PASS);
+
+    // one byte short of the UDP header, the bounds check has to pass it before any load past data_end
+    auto truncated = make_frame();
+    truncated.resize(XDP_UDP_PAYLOAD_OFFSET - 1);
+    CHECK_EQ(filter.run(truncated), XDP_PASS);
+
+    auto headers_only = make_frame();
+    headers_only.resize(XDP_UDP_PAYLOAD_OFFSET);
+    CHECK_EQ(filter.run(headers_only), XDP_DROP);
+}
+
+TEST(xdp_udp_payload_len_comes_from_the_udp_header) {
+    auto frame = make_frame();
+    const auto data = reinterpret_cast<const char*>(frame.data());
+    CHECK_EQ(XdpSocket::udp_payload_len(data, static_cast<uint32_t>(frame.size())), PAYLOAD_LEN);
+
+    // padded to a minimum frame size, the padding is not payload
+    CHECK_EQ(XdpSocket::udp_payload_len(data, static_cast<uint32_t>(frame.size() + 20)), PAYLOAD_LEN);
+
+    // a UDP length past the end of the frame or shorter than the UDP header itself is dropped
+    CHECK_EQ(XdpSocket::udp_payload_len(data, static_cast<uint32_t>(frame.size() - 1)), -1);
+    const uint16_t too_short = htons(7);
+    memcpy(&frame[38], &too_short, sizeof(too_short));
+    CHECK_EQ(XdpSocket::udp_payload_len(data, static_cast<uint32_t>(frame.size())), -1);
+
+    const uint16_t empty = htons(8);
+    memcpy(&frame[38], &empty, sizeof(empty));
+    CHECK_EQ(XdpSocket::udp_payload_len(data, static_cast<uint32_t>(frame.size())), 0);
+}
+
+int main(int argc, char** argv) { return Test::run_all(argc, argv); }
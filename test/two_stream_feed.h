@@ -0,0 +1,202 @@
+#pragma once
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/mcast_socket.h"
+
+#include "exchange/market_data/market_update.h"
+#include "trading/market_data/market_order_book.h"
+
+// Publisher side of the market data recovery harness, shared by test_md_recovery and bench/bench_md_recovery.
+// Generates a synthetic book of `depth` price levels either side of a fixed mid per instrument, publishes it on the
+// incremental stream in the MDP format and on demand as a snapshot cycle on the snapshot stream, and applies every
+// update to a reference MarketOrderBook so whatever a consumer rebuilds can be compared with it level by level.
+// Incrementals can be dropped: sequenced and applied to the reference, but never sent.
+
+namespace Test {
+
+    class TwoStreamFeed final {
+    public:
+        // datagrams stay below a 1500 byte MTU, same as the exchange simulator
+        static constexpr std::size_t UPDATES_PER_DATAGRAM = 1472 / sizeof(Exchange::MDPMarketUpdate);
+        static constexpr std::size_t ORDERS_PER_LEVEL = 2;
+
+        TwoStreamFeed(Common::Logger& logger, const std::string& iface, const std::string& incremental_ip, int incremental_port,
+                      const std::string& snapshot_ip, int snapshot_port, std::size_t num_instruments, std::size_t depth, uint64_t seed = 1)
+            : incremental_socket_{logger}, snapshot_socket_{logger}, depth_{depth}, instruments_(num_instruments), rng_{seed},
+              free_ids_(Common::ME_MAX_ORDER_IDS - 1) {
+            ASSERT(num_instruments && num_instruments <= Common::ME_MAX_TICKERS && depth, "TwoStreamFeed needs 1 to ME_MAX_TICKERS instruments and depth > 0.");
+            ASSERT(incremental_socket_.init(incremental_ip, iface, incremental_port, false) >= 0, "Unable to create incremental socket on " + iface);
+            ASSERT(snapshot_socket_.init(snapshot_ip, iface, snapshot_port, false) >= 0, "Unable to create snapshot socket on " + iface);
+
+            // order ids are handed out oldest freed first, an id only comes back long after its CANCEL
+            for (std::size_t i = 0; i < free_ids_.size(); ++i)
+                free_ids_[i] = static_cast<Common::OrderId>(i + 1);
+            num_free_ids_ = free_ids_.size();
+
+            for (std::size_t ticker_id = 0; ticker_id < num_instruments; ++ticker_id) {
+                instruments_[ticker_id].mid_ = static_cast<Common::Price>(1000 * (ticker_id + 1));
+                instruments_[ticker_id].book_ = std::make_unique<Trading::MarketOrderBook>(static_cast<Common::TickerId>(ticker_id));
+            }
+        }
+
+        ~TwoStreamFeed() {
+            close(incremental_socket_.socket_fd_);
+            close(snapshot_socket_.socket_fd_);
+        }
+
+        TwoStreamFeed() = delete;
+        TwoStreamFeed(const TwoStreamFeed&) = delete;
+        TwoStreamFeed(const TwoStreamFeed&&) = delete;
+        TwoStreamFeed& operator=(const TwoStreamFeed&) = delete;
+        TwoStreamFeed& operator=(const TwoStreamFeed&&) = delete;
+
+        // the next n incrementals, sent as full datagrams plus a last partial one. drop = sequenced and applied to the
+        // reference books but lost on the wire
+        auto publish(std::size_t n, bool drop = false) noexcept {
+            for (std::size_t i = 0; i < n; ++i) {
+                const Exchange::MDPMarketUpdate update{next_seq_num_++, next_update()};
+                instruments_[update.me_market_update_.ticker_id_].book_->on_market_update(&update.me_market_update_);
+                if (drop)
+                    continue;
+                incremental_socket_.send(&update, sizeof(update));
+                if (++pending_in_datagram_ == UPDATES_PER_DATAGRAM)
+                    flush();
+            }
+            flush();
+        }
+
+        auto flush() noexcept -> void {
+            if (!pending_in_datagram_)
+                return;
+            incremental_socket_.send_and_recv();
+            pending_in_datagram_ = 0;
+        }
+
+        // snapshot cycle of the current reference state, covering every incremental sequenced so far. Sent one datagram
+        // per send_snapshot_datagram() so a caller can keep incrementals flowing in between, like a venue does
+        auto start_snapshot() -> void {
+            flush();
+            snapshot_.clear();
+            snapshot_sent_ = 0;
+            const auto last_seq_num = static_cast<Common::OrderId>(next_seq_num_ - 1);
+            auto add = [this](const Exchange::MEMarketUpdate& update) {
+                snapshot_.push_back({snapshot_.size(), update});
+            };
+            add({Exchange::MarketUpdateType::SNAPSHOT_START, last_seq_num});
+            for (std::size_t ticker_id = 0; ticker_id < instruments_.size(); ++ticker_id) {
+                add({Exchange::MarketUpdateType::CLEAR, Common::OrderId_INVALID, static_cast<Common::TickerId>(ticker_id)});
+                for (const auto& order : instruments_[ticker_id].orders_)
+                    add(add_update(static_cast<Common::TickerId>(ticker_id), order));
+            }
+            add({Exchange::MarketUpdateType::SNAPSHOT_END, last_seq_num});
+        }
+
+        // false once the whole snapshot is out
+        auto send_snapshot_datagram() noexcept -> bool {
+            const auto end = std::min(snapshot_sent_ + UPDATES_PER_DATAGRAM, snapshot_.size());
+            if (snapshot_sent_ == end)
+                return false;
+            snapshot_socket_.send(&snapshot_[snapshot_sent_], (end - snapshot_sent_) * sizeof(Exchange::MDPMarketUpdate));
+            snapshot_socket_.send_and_recv();
+            snapshot_sent_ = end;
+            return snapshot_sent_ < snapshot_.size();
+        }
+
+        auto publish_snapshot() {
+            start_snapshot();
+            while (send_snapshot_datagram());
+        }
+
+        auto reference_book(Common::TickerId ticker_id) const noexcept -> const Trading::MarketOrderBook& { return *instruments_[ticker_id].book_; }
+        auto num_instruments() const noexcept { return instruments_.size(); }
+        auto next_seq_num() const noexcept { return next_seq_num_; }
+        auto snapshot_size() const noexcept { return snapshot_.size(); }
+
+    private:
+        struct Order {
+            Common::OrderId order_id_ = Common::OrderId_INVALID;
+            Common::Side side_ = Common::Side::INVALID;
+            Common::Price price_ = Common::Price_INVALID;
+            Common::Qty qty_ = 0;
+        };
+
+        struct Instrument {
+            Common::Price mid_ = 0;
+            std::vector<Order> orders_;
+            std::unique_ptr<Trading::MarketOrderBook> book_;
+        };
+
+        Common::McastSocket incremental_socket_;
+        Common::McastSocket snapshot_socket_;
+        const std::size_t depth_;
+        std::vector<Instrument> instruments_;
+        std::mt19937_64 rng_;
+
+        std::vector<Common::OrderId> free_ids_;
+        std::size_t free_ids_start_ = 0;
+        std::size_t num_free_ids_ = 0;
+
+        std::size_t next_seq_num_ = 1;
+        std::size_t pending_in_datagram_ = 0;
+
+        std::vector<Exchange::MDPMarketUpdate> snapshot_;
+        std::size_t snapshot_sent_ = 0;
+
+        static auto add_update(Common::TickerId ticker_id, const Order& order) -> Exchange::MEMarketUpdate {
+            return {Exchange::MarketUpdateType::ADD, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, order.order_id_};
+        }
+
+        // the book fills up to ORDERS_PER_LEVEL orders per level on average, then ADDs, MODIFYs and CANCELs keep it there
+        auto next_update() noexcept -> Exchange::MEMarketUpdate {
+            const auto ticker_id = static_cast<Common::TickerId>(rng_() % instruments_.size());
+            auto& instrument = instruments_[ticker_id];
+            auto& orders = instrument.orders_;
+            const auto target = 2 * depth_ * ORDERS_PER_LEVEL;
+            const auto choice = rng_() % 10;
+
+            if (orders.empty() || (orders.size() < target && choice < 5)) {
+                const auto side = (rng_() & 1) ? Common::Side::BUY : Common::Side::SELL;
+                const auto offset = static_cast<Common::Price>(1 + rng_() % depth_);
+                const Order order{free_ids_[free_ids_start_], side, side == Common::Side::BUY ? instrument.mid_ - offset : instrument.mid_ + offset,
+                                  static_cast<Common::Qty>(1 + rng_() % 100)};
+                free_ids_start_ = (free_ids_start_ + 1) % free_ids_.size();
+                --num_free_ids_;
+                orders.push_back(order);
+                return add_update(ticker_id, order);
+            }
+
+            const auto index = rng_() % orders.size();
+            auto& order = orders[index];
+            if (choice < 8) {
+                order.qty_ = static_cast<Common::Qty>(1 + rng_() % 100);
+                return {Exchange::MarketUpdateType::MODIFY, order.order_id_, ticker_id, order.side_, order.price_, order.qty_, order.order_id_};
+            }
+
+            const Exchange::MEMarketUpdate cancel{Exchange::MarketUpdateType::CANCEL, order.order_id_, ticker_id, order.side_, order.price_, 0, order.order_id_};
+            free_ids_[(free_ids_start_ + num_free_ids_++) % free_ids_.size()] = order.order_id_;
+            order = orders.back();
+            orders.pop_back();
+            return cancel;
+        }
+    };
+
+    // level by level, both sides, including the number of orders at each level
+    inline auto same_book(const Trading::MarketOrderBook& a, const Trading::MarketOrderBook& b) noexcept {
+        if (a.num_bid_levels() != b.num_bid_levels() || a.num_ask_levels() != b.num_ask_levels())
+            return false;
+        auto same_level = [](const Trading::PriceLevel* x, const Trading::PriceLevel* y) {
+            return x->price_ == y->price_ && x->qty_ == y->qty_ && x->num_orders_ == y->num_orders_;
+        };
+        for (std::size_t depth = 0; depth < a.num_bid_levels(); ++depth)
+            if (!same_level(a.bid_level(depth), b.bid_level(depth)))
+                return false;
+        for (std::size_t depth = 0; depth < a.num_ask_levels(); ++depth)
+            if (!same_level(a.ask_level(depth), b.ask_level(depth)))
+                return false;
+        return true;
+    }
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/thread_utils.h"
+#include "common/time_utils.h"
+#include "common/latency_histogram.h"
+
+#include "trading/market_data/market_order_book.h"
+#include "trading/strategy/position_keeper.h"
+#include "trading/backtest/recorded_market_data.h"
+#include "trading/backtest/simulated_order_gateway.h"
+
+namespace Trading {
+
+    struct BacktestConfig {
+        std::size_t num_workers_ = 1;
+        std::vector<int> cores_;               // worker i is pinned to cores_[i % cores_.size()], empty leaves them unpinned
+        std::size_t strategies_per_pass_ = 8;  // parameter sets fed from one pass over an instrument's updates
+        Common::Nanos order_latency_ = 0;      // see SimulatedOrderGateway
+    };
+
+    // outcome of one (instrument, parameter set) run
+    struct BacktestResult {
+        Common::TickerId ticker_id_ = Common::TickerId_INVALID;
+        std::size_t param_index_ = 0;
+        std::size_t events_ = 0;
+        std::size_t orders_ = 0;
+        std::size_t fills_ = 0;
+        PositionInfo position_; // marked against the last BBO of the recording
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "BacktestResult{ticker:" << Common::ticker_id_to_string(ticker_id_) << " params:" << param_index_ << " events:" << events_
+               << " orders:" << orders_ << " fills:" << fills_ << " " << position_.to_string() << "}";
+            return ss.str();
+        }
+    };
+
+    struct BacktestWorkerStats {
+        std::size_t passes_ = 0;
+        std::size_t steals_ = 0;
+        std::size_t events_ = 0;        // updates applied to a book
+        std::size_t strategy_events_ = 0; // updates times the strategies they were fed to
+        Common::Nanos busy_time_ = 0;   // start to running out of passes
+        Common::LatencyHistogram pass_time_;
+
+        auto events_per_sec() const noexcept { return busy_time_ ? static_cast<double>(events_) * 1e9 / static_cast<double>(busy_time_) : 0.0; }
+    };
+
+    struct BacktestStats {
+        std::size_t runs_ = 0;
+        std::size_t passes_ = 0;
+        std::size_t events_ = 0;
+        std::size_t strategy_events_ = 0;
+        Common::Nanos elapsed_ = 0;
+        Common::LatencyHistogram pass_time_;
+        std::vector<BacktestWorkerStats> workers_;
+
+        auto events_per_sec() const noexcept { return elapsed_ ? static_cast<double>(events_) * 1e9 / static_cast<double>(elapsed_) : 0.0; }
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "BacktestStats{runs:" << runs_ << " passes:" << passes_ << " events:" << events_ << " strategy_events:" << strategy_events_
+               << " elapsed_ms:" << elapsed_ / 1'000'000 << " events/s:" << static_cast<uint64_t>(events_per_sec()) << " workers:[";
+            for (std::size_t i = 0; i < workers_.size(); ++i)
+                ss << (i ? " " : "") << "{passes:" << workers_[i].passes_ << " steals:" << workers_[i].steals_
+                   << " events/s:" << static_cast<uint64_t>(workers_[i].events_per_sec()) << "}";
+            ss << "]}";
+            return ss.str();
+        }
+    };
+
+    // Runs a strategy over recorded market data for every (instrument, parameter set) on a pool of pinned worker
+    // threads, feeding it through the MarketOrderBook used live and filling its orders through a SimulatedOrderGateway.
+    //
+    // Strategy provides a Params type and is constructed as Strategy(const Params&, TickerId, SimulatedOrderGateway&),
+    // then gets the callbacks a live trading loop makes:
+    //   on_order_book_update(const MEMarketUpdate&, const MarketOrderBook&) - every update that is not a TRADE
+    //   on_trade_update(const MEMarketUpdate&, const MarketOrderBook&)
+    //   on_order_update(const MEClientResponse&)
+    //
+    // Runs for the same instrument share a pass: the worker applies each update once to its MarketOrderBook and fans
+    // it out to up to strategies_per_pass strategies, each with its own gateway and slot in a PositionKeeper. Passes are
+    // dealt out to the workers in contiguous ranges, a worker takes from the front of its own range and once that is
+    // empty steals from the back of the fullest other one. A range is one 64 bit word (begin, end), both ends are
+    // taken with a CAS and nothing is locked. Books are created by the worker that uses them, so their memory is
+    // local to its core.
+    template<typename Strategy>
+    class BacktestEngine final {
+    public:
+        using Params = typename Strategy::Params;
+
+        BacktestEngine(const RecordedMarketData& data, const BacktestConfig& config) : data_{data}, config_{config} {
+            ASSERT(config_.num_workers_ && config_.strategies_per_pass_, "BacktestEngine needs at least one worker and one strategy per pass.");
+        }
+
+        BacktestEngine() = delete;
+        BacktestEngine(const BacktestEngine&) = delete;
+        BacktestEngine(const BacktestEngine&&) = delete;
+        BacktestEngine& operator=(const BacktestEngine&) = delete;
+        BacktestEngine& operator=(const BacktestEngine&&) = delete;
+
+        // blocks until every run finished, the result of (tickers[t], params[p]) is at t * params.size() + p
+        // an empty tickers runs every instrument in the recording
+        auto run(const std::vector<Params>& params, std::vector<Common::TickerId> tickers = {}) -> std::vector<BacktestResult> {
+            if (tickers.empty())
+                tickers = data_.tickers();
+
+            params_ = &params;
+            passes_.clear();
+            for (std::size_t t = 0; t < tickers.size(); ++t) {
+                // workers index their books by ticker id
+                ASSERT(tickers[t] < Common::ME_MAX_TICKERS, "BacktestEngine ticker id out of range:" + Common::ticker_id_to_string(tickers[t]));
+                for (std::size_t first = 0; first < params.size(); first += config_.strategies_per_pass_)
+                    passes_.push_back({tickers[t], first, std::min(config_.strategies_per_pass_, params.size() - first), t * params.size() + first});
+            }
+            ASSERT(passes_.size() < std::numeric_limits<uint32_t>::max(), "BacktestEngine too many passes:" + std::to_string(passes_.size()));
+
+            std::vector<BacktestResult> results(tickers.size() * params.size());
+            results_ = &results;
+
+            const auto num_workers = config_.num_workers_;
+            ranges_ = std::make_unique<WorkRange[]>(num_workers);
+            for (std::size_t w = 0; w < num_workers; ++w)
+                ranges_[w].range_ = pack(w * passes_.size() / num_workers, (w + 1) * passes_.size() / num_workers);
+
+            stats_ = {};
+            stats_.runs_ = results.size();
+            stats_.passes_ = passes_.size();
+            stats_.workers_.resize(num_workers);
+
+            // workers wait for start_ so the clock does not include bringing the threads up
+            start_ = false;
+            std::vector<std::thread*> threads;
+            for (std::size_t w = 0; w < num_workers; ++w) {
+                const auto core = config_.cores_.empty() ? -1 : config_.cores_[w % config_.cores_.size()];
+                threads.push_back(Common::create_and_start_thread(core, "Trading/Backtest " + std::to_string(w), [this, w]() { work(w); }));
+                ASSERT(threads.back() != nullptr, "Failed to start backtest worker " + std::to_string(w));
+            }
+
+            const auto start = Common::getCurrentNanos();
+            start_ = true;
+            for (auto thread : threads) {
+                thread->join();
+                delete thread;
+            }
+            stats_.elapsed_ = Common::getCurrentNanos() - start;
+
+            for (const auto& worker : stats_.workers_) {
+                stats_.events_ += worker.events_;
+                stats_.strategy_events_ += worker.strategy_events_;
+                stats_.pass_time_.merge(worker.pass_time_);
+            }
+            results_ = nullptr;
+            params_ = nullptr;
+            return results;
+        }
+
+        auto get_stats() const noexcept -> const BacktestStats& { return stats_; }
+
+    private:
+        static constexpr std::size_t NO_PASS = std::numeric_limits<std::size_t>::max();
+
+        struct Pass {
+            Common::TickerId ticker_id_;
+            std::size_t first_param_;
+            std::size_t num_params_;
+            std::size_t first_result_;
+        };
+
+        // passes [begin, end) not taken yet, begin in the low half
+        struct alignas(CACHE_LINE_SIZE) WorkRange {
+            std::atomic<uint64_t> range_ {0};
+        };
+
+        struct Lane {
+            SimulatedOrderGateway gateway_;
+            Strategy strategy_;
+
+            Lane(const Params& params, Common::TickerId ticker_id, Common::ClientId client_id, Common::Nanos order_latency)
+                : gateway_{client_id, order_latency}, strategy_{params, ticker_id, gateway_} {
+            }
+        };
+
+        const RecordedMarketData& data_;
+        const BacktestConfig config_;
+
+        const std::vector<Params>* params_ = nullptr;
+        std::vector<BacktestResult>* results_ = nullptr;
+        std::vector<Pass> passes_;
+        std::unique_ptr<WorkRange[]> ranges_;
+        std::atomic_bool start_ {false};
+
+        BacktestStats stats_;
+
+        static auto pack(std::size_t begin, std::size_t end) noexcept { return static_cast<uint64_t>(end) << 32 | static_cast<uint64_t>(begin); }
+
+        // the owner takes from the front, thieves from the back
+        auto take(WorkRange& work_range, bool front) noexcept -> std::size_t {
+            auto range = work_range.range_.load(std::memory_order_acquire);
+            while (true) {
+                const auto begin = range & 0xffffffff;
+                const auto end = range >> 32;
+                if (begin >= end)
+                    return NO_PASS;
+                const auto next = front ? pack(begin + 1, end) : pack(begin, end - 1);
+                if (work_range.range_.compare_exchange_weak(range, next, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return front ? begin : end - 1;
+            }
+        }
+
+        auto next_pass(std::size_t worker, BacktestWorkerStats& stats) noexcept -> std::size_t {
+            if (const auto pass = take(ranges_[worker], true); pass != NO_PASS)
+                return pass;
+
+            while (true) {
+                std::size_t victim = NO_PASS;
+                uint64_t most = 0;
+                for (std::size_t w = 0; w < config_.num_workers_; ++w) {
+                    const auto range = ranges_[w].range_.load(std::memory_order_relaxed);
+                    const auto left = (range >> 32) > (range & 0xffffffff) ? (range >> 32) - (range & 0xffffffff) : 0;
+                    if (left > most) {
+                        most = left;
+                        victim = w;
+                    }
+                }
+                if (victim == NO_PASS)
+                    return NO_PASS;
+                if (const auto pass = take(ranges_[victim], false); pass != NO_PASS) {
+                    ++stats.steals_;
+                    return pass;
+                }
+            }
+        }
+
+        auto work(std::size_t worker) noexcept -> void {
+            while (!start_)
+                std::this_thread::yield();
+
+            const auto start = Common::getCurrentNanos();
+            BacktestWorkerStats stats;
+            std::array<std::unique_ptr<MarketOrderBook>, Common::ME_MAX_TICKERS> books;
+            for (auto pass = next_pass(worker, stats); pass != NO_PASS; pass = next_pass(worker, stats)) {
+                const auto& p = passes_[pass];
+                if (!books[p.ticker_id_])
+                    books[p.ticker_id_] = std::make_unique<MarketOrderBook>(p.ticker_id_);
+                const auto pass_start = Common::getCurrentNanos();
+                run_pass(p, *books[p.ticker_id_], stats);
+                stats.pass_time_.record(Common::getCurrentNanos() - pass_start);
+                ++stats.passes_;
+            }
+            stats.busy_time_ = Common::getCurrentNanos() - start;
+            stats_.workers_[worker] = stats;
+        }
+
+        auto run_pass(const Pass& pass, MarketOrderBook& book, BacktestWorkerStats& stats) noexcept -> void {
+            const auto ticker_id = pass.ticker_id_;
+            book.clear();
+            PositionKeeper keeper(ticker_id + 1, pass.num_params_);
+
+            std::vector<std::unique_ptr<Lane>> lanes;
+            for (std::size_t i = 0; i < pass.num_params_; ++i)
+                lanes.push_back(std::make_unique<Lane>((*params_)[pass.first_param_ + i], ticker_id, static_cast<Common::ClientId>(i), config_.order_latency_));
+
+            const auto& events = data_.events(ticker_id);
+            for (const auto record : events) {
+                const auto& update = record->event_;
+                book.on_market_update(&update);
+                const auto trade = update.type_ == Exchange::MarketUpdateType::TRADE;
+                if (!trade)
+                    keeper.on_bbo(ticker_id, book.get_bbo());
+
+                for (std::size_t strategy_id = 0; strategy_id < lanes.size(); ++strategy_id) {
+                    auto& lane = *lanes[strategy_id];
+                    lane.gateway_.set_time(record->time_);
+                    lane.gateway_.on_market_update(&update, book);
+                    dispatch(lane, keeper, static_cast<Common::StrategyId>(strategy_id));
+
+                    if (trade)
+                        lane.strategy_.on_trade_update(update, book);
+                    else
+                        lane.strategy_.on_order_book_update(update, book);
+
+                    // without latency whatever the strategy just sent meets the book as it is now
+                    if (lane.gateway_.has_pending()) {
+                        lane.gateway_.on_market_update(nullptr, book);
+                        dispatch(lane, keeper, static_cast<Common::StrategyId>(strategy_id));
+                    }
+                }
+            }
+
+            for (std::size_t i = 0; i < lanes.size(); ++i) {
+                auto& result = (*results_)[pass.first_result_ + i];
+                result.ticker_id_ = ticker_id;
+                result.param_index_ = pass.first_param_ + i;
+                result.events_ = events.size();
+                result.orders_ = lanes[i]->gateway_.orders_sent();
+                result.fills_ = lanes[i]->gateway_.num_fills();
+                result.position_ = keeper.get_position(static_cast<Common::StrategyId>(i), ticker_id);
+            }
+            stats.events_ += events.size();
+            stats.strategy_events_ += events.size() * lanes.size();
+        }
+
+        // the strategy may send (and get rejects) from its callback, so responses can grow while they are dispatched
+        static auto dispatch(Lane& lane, PositionKeeper& keeper, Common::StrategyId strategy_id) noexcept -> void {
+            auto& responses = lane.gateway_.responses();
+            for (std::size_t i = 0; i < responses.size(); ++i) {
+                const auto response = responses[i];
+                if (response.type_ == Exchange::ClientResponseType::FILLED)
+                    keeper.on_fill(strategy_id, response);
+                lane.strategy_.on_order_update(response);
+            }
+            responses.clear();
+        }
+    };
+}
@@ -0,0 +1,39 @@
+#include "recorded_market_data.h"
+
+#include <set>
+
+#include "common/time_utils.h"
+
+namespace Trading {
+
+    RecordedMarketData::RecordedMarketData(Common::Logger& logger, const std::string& dir, const std::string& name) : view_{dir, name} {
+        ASSERT(view_.size(), "RecordedMarketData nothing recorded in " + dir + "/" + name);
+
+        std::set<Common::TickerId> skipped_ticker_ids;
+        view_.for_each([&](const Record& record) {
+            const auto ticker_id = record.event_.ticker_id_;
+            if (ticker_id >= by_ticker_.size()) {
+                ++skipped_;
+                skipped_ticker_ids.insert(ticker_id);
+                return;
+            }
+            by_ticker_[ticker_id].push_back(&record);
+        });
+
+        // a recording with more instruments than ME_MAX_TICKERS still backtests the ones that fit, but not silently
+        if (skipped_) {
+            std::string skipped_ids, time_str;
+            for (const auto ticker_id : skipped_ticker_ids) {
+                skipped_ids += ' ';
+                skipped_ids += Common::ticker_id_to_string(ticker_id);
+            }
+            logger.log("%:% %() % % skipped % updates for ticker ids >= ME_MAX_TICKERS (%):%\n", __FILE__, __LINE__, __FUNCTION__,
+                       Common::get_current_time_str(time_str), dir + "/" + name, skipped_, Common::ME_MAX_TICKERS, skipped_ids);
+        }
+
+        for (std::size_t ticker_id = 0; ticker_id < by_ticker_.size(); ++ticker_id) {
+            if (!by_ticker_[ticker_id].empty())
+                tickers_.push_back(static_cast<Common::TickerId>(ticker_id));
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/journal.h"
+#include "common/logging.h"
+
+#include "exchange/market_data/market_update.h"
+
+namespace Trading {
+
+    // Recorded market data for backtests: a Common::Journal<MEMarketUpdate>, the same recording the exchange simulator
+    // replays, mapped once and indexed per instrument. Read only after construction, every backtest worker shares one.
+    class RecordedMarketData final {
+    public:
+        using Record = Common::JournalRecord<Exchange::MEMarketUpdate>;
+
+        RecordedMarketData(Common::Logger& logger, const std::string& dir, const std::string& name);
+
+        RecordedMarketData() = delete;
+        RecordedMarketData(const RecordedMarketData&) = delete;
+        RecordedMarketData(const RecordedMarketData&&) = delete;
+        RecordedMarketData& operator=(const RecordedMarketData&) = delete;
+        RecordedMarketData& operator=(const RecordedMarketData&&) = delete;
+
+        // ticker_id's updates in recorded order, time_ is when they were recorded
+        auto events(Common::TickerId ticker_id) const noexcept -> const std::vector<const Record*>& {
+            ASSERT(ticker_id < by_ticker_.size(), "RecordedMarketData ticker id out of range:" + Common::ticker_id_to_string(ticker_id));
+            return by_ticker_[ticker_id];
+        }
+
+        // instruments with at least one update
+        auto tickers() const noexcept -> const std::vector<Common::TickerId>& { return tickers_; }
+
+        auto size() const noexcept { return view_.size(); }
+        auto num_skipped() const noexcept { return skipped_; }
+        auto journal_result() const noexcept -> const Common::JournalReplayResult& { return view_.result(); }
+
+    private:
+        Common::JournalView<Exchange::MEMarketUpdate> view_;
+        std::array<std::vector<const Record*>, Common::ME_MAX_TICKERS> by_ticker_;
+        std::vector<Common::TickerId> tickers_;
+        std::size_t skipped_ = 0; // updates for a ticker id >= ME_MAX_TICKERS, logged once on construction
+    };
+}
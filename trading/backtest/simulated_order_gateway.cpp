@@ -0,0 +1,73 @@
+#include "simulated_order_gateway.h"
+
+namespace Trading {
+
+    SimulatedOrderGateway::SimulatedOrderGateway(Common::ClientId client_id, Common::Nanos order_latency)
+        : client_id_{client_id}, order_latency_{order_latency} {
+        orders_.reserve(64);
+        responses_.reserve(64);
+    }
+
+    void SimulatedOrderGateway::on_market_update(const Exchange::MEMarketUpdate* update, const MarketOrderBook& book) noexcept {
+        pending_ = false;
+        const auto bbo = book.get_bbo();
+
+        for (std::size_t i = 0; i < orders_.size();) {
+            auto& order = orders_[i];
+            auto& response = order.response_;
+            const bool buy = response.side_ == Common::Side::BUY;
+
+            if (response.type_ == Exchange::ClientResponseType::INVALID) {
+                if (order.live_time_ > now_) {
+                    ++i;
+                    continue;
+                }
+                response.type_ = Exchange::ClientResponseType::ACCEPTED;
+                response.exec_qty_ = 0;
+                responses_.push_back(response);
+
+                // arrives marketable, takes what is shown at the touch
+                const auto touch_price = buy ? bbo->ask_price_ : bbo->bid_price_;
+                const auto touch_qty = buy ? bbo->ask_qty_ : bbo->bid_qty_;
+                if (touch_price != Common::Price_INVALID && (buy ? touch_price <= response.price_ : touch_price >= response.price_))
+                    fill(order, touch_price, std::min(response.leaves_qty_, touch_qty));
+            } else if (update) {
+                // resting, only ever filled by the market trading or quoting through its price
+                if (update->type_ == Exchange::MarketUpdateType::TRADE &&
+                    (buy ? update->price_ < response.price_ : update->price_ > response.price_))
+                    fill(order, response.price_, std::min(response.leaves_qty_, update->qty_));
+
+                const auto opposite = buy ? bbo->ask_price_ : bbo->bid_price_;
+                if (response.leaves_qty_ && opposite != Common::Price_INVALID && (buy ? opposite < response.price_ : opposite > response.price_))
+                    fill(order, response.price_, response.leaves_qty_);
+            }
+
+            if (response.leaves_qty_ && order.cancel_time_ <= now_) {
+                response.type_ = Exchange::ClientResponseType::CANCELED;
+                response.exec_qty_ = Common::Qty_INVALID;
+                responses_.push_back(response);
+                response.leaves_qty_ = 0;
+            }
+
+            if (!response.leaves_qty_) {
+                order = orders_.back();
+                orders_.pop_back();
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    void SimulatedOrderGateway::fill(SimOrder& order, Common::Price price, Common::Qty qty) noexcept {
+        if (!qty || qty == Common::Qty_INVALID)
+            return;
+        auto& response = order.response_;
+        response.leaves_qty_ -= qty;
+        auto report = response;
+        report.type_ = Exchange::ClientResponseType::FILLED;
+        report.price_ = price;
+        report.exec_qty_ = qty;
+        responses_.push_back(report);
+        ++fills_;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/time_utils.h"
+
+#include "exchange/market_data/market_update.h"
+#include "exchange/order_server/client_response.h"
+#include "trading/market_data/market_order_book.h"
+
+namespace Trading {
+
+    // Fill model for backtests with the same send_new_order() / send_cancel() a strategy calls on the OrderGateway live,
+    // so strategy code can be written once against either.
+    //
+    // Requests reach the simulated exchange order_latency after they were sent, in recorded time. A new order that is
+    // marketable against the book's BBO on arrival takes the touch, up to the touch qty at the touch price, the rest
+    // rests. A resting order fills at its own price when a recorded TRADE prints through it (up to the trade qty) or
+    // when the opposite touch moves through it. There is no queue position: trading at the order's price alone does
+    // not fill it, which keeps the model on the pessimistic side. Our own orders never show up in the book.
+    class SimulatedOrderGateway final {
+    public:
+        explicit SimulatedOrderGateway(Common::ClientId client_id, Common::Nanos order_latency = 0);
+
+        SimulatedOrderGateway() = delete;
+        SimulatedOrderGateway(const SimulatedOrderGateway&) = delete;
+        SimulatedOrderGateway(const SimulatedOrderGateway&&) = delete;
+        SimulatedOrderGateway& operator=(const SimulatedOrderGateway&) = delete;
+        SimulatedOrderGateway& operator=(const SimulatedOrderGateway&&) = delete;
+
+        // returns the seq number the request was "sent" with, like OrderGateway. There is no journal, the strategy id is
+        // only taken for the same signature
+        auto send_new_order(Common::TickerId ticker_id, Common::Side side, Common::Price price, Common::Qty qty, Common::OrderId client_order_id,
+                            Common::StrategyId = 0) noexcept {
+            SimOrder order;
+            order.response_ = {Exchange::ClientResponseType::INVALID, client_id_, ticker_id, client_order_id, next_market_order_id_++,
+                               side, price, 0, qty};
+            order.live_time_ = now_ + order_latency_;
+            orders_.push_back(order);
+            ++orders_sent_;
+            pending_ = true;
+            return next_seq_num_++;
+        }
+
+        auto send_cancel(Common::TickerId ticker_id, Common::Side side, Common::OrderId client_order_id, Common::StrategyId = 0) noexcept {
+            for (auto& order : orders_) {
+                if (order.response_.client_order_id_ == client_order_id) {
+                    order.cancel_time_ = std::min(order.cancel_time_, now_ + order_latency_);
+                    pending_ = true;
+                    return next_seq_num_++;
+                }
+            }
+            responses_.push_back({Exchange::ClientResponseType::CANCEL_REJECTED, client_id_, ticker_id, client_order_id,
+                                  Common::OrderId_INVALID, side, Common::Price_INVALID, Common::Qty_INVALID, Common::Qty_INVALID});
+            return next_seq_num_++;
+        }
+
+        // recorded time of the update being processed, requests sent from here on are stamped with it
+        auto set_time(Common::Nanos now) noexcept { now_ = now; }
+
+        // after book applied update: requests that arrived by now take effect, then resting orders are matched against
+        // update and the BBO. update is nullptr to only apply requests sent since, e.g. right after a strategy callback
+        void on_market_update(const Exchange::MEMarketUpdate* update, const MarketOrderBook& book) noexcept;
+
+        // requests sent since the last on_market_update() that may already have arrived
+        auto has_pending() const noexcept { return pending_ && !order_latency_; }
+
+        // execution reports produced so far, the caller dispatches and clears them
+        auto responses() noexcept -> std::vector<Exchange::MEClientResponse>& { return responses_; }
+
+        auto num_live_orders() const noexcept { return orders_.size(); }
+        auto orders_sent() const noexcept { return orders_sent_; }
+        auto num_fills() const noexcept { return fills_; }
+
+    private:
+        struct SimOrder {
+            Exchange::MEClientResponse response_; // as last reported, type_ INVALID until the order arrived
+            Common::Nanos live_time_ = 0;
+            Common::Nanos cancel_time_ = std::numeric_limits<Common::Nanos>::max();
+        };
+
+        const Common::ClientId client_id_;
+        const Common::Nanos order_latency_;
+        Common::Nanos now_ = 0;
+
+        // a strategy keeps a handful of orders out, a vector scan beats any index here
+        std::vector<SimOrder> orders_;
+        std::vector<Exchange::MEClientResponse> responses_;
+        bool pending_ = false;
+
+        Common::OrderId next_market_order_id_ = 1;
+        std::size_t next_seq_num_ = 1;
+        std::size_t orders_sent_ = 0;
+        std::size_t fills_ = 0;
+
+        void fill(SimOrder& order, Common::Price price, Common::Qty qty) noexcept;
+    };
+}
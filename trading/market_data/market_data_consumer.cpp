@@ -0,0 +1,219 @@
+#include "market_data_consumer.h"
+
+namespace Trading {
+
+    MarketDataConsumer::MarketDataConsumer(Common::ClientId client_id, Exchange::MEMarketUpdateLFQueue* market_updates, const std::string& iface,
+                                           const std::string& snapshot_ip, int snapshot_port,
+                                           const std::string& incremental_ip, int incremental_port,
+                                           std::size_t max_queued_incrementals, std::size_t max_snapshot_updates)
+        : incoming_md_updates_{market_updates},
+          logger_{"trading_market_data_consumer_" + std::to_string(client_id) + ".log"},
+          incremental_mcast_socket_{logger_}, snapshot_mcast_socket_{logger_},
+          iface_{iface}, snapshot_ip_{snapshot_ip}, snapshot_port_{snapshot_port},
+          queued_incrementals_(max_queued_incrementals), queued_snapshot_(max_snapshot_updates) {
+
+        incremental_mcast_socket_.recv_callback_ = [this](auto socket) { recv_incremental_callback(socket); };
+        ASSERT(incremental_mcast_socket_.init(incremental_ip, iface, incremental_port, true) >= 0,
+            "Unable to create incremental mcast socket. error: " + std::string{strerror(errno)});
+        ASSERT(incremental_mcast_socket_.join(incremental_ip),
+            "Join failed on: " + std::to_string(incremental_mcast_socket_.socket_fd_) + " error: " + std::string{strerror(errno)});
+
+        // the snapshot socket is only created and joined when a recovery starts
+        snapshot_mcast_socket_.recv_callback_ = [this](auto socket) { recv_snapshot_callback(socket); };
+    }
+
+    MarketDataConsumer::~MarketDataConsumer() {
+        stop();
+    }
+
+    void MarketDataConsumer::start() {
+        running_ = true;
+        consumer_thread_ = Common::create_and_start_thread(-1, "Trading/MarketDataConsumer", [this]() { run(); });
+        ASSERT(consumer_thread_ != nullptr, "Failed to start MarketDataConsumer thread.");
+    }
+
+    void MarketDataConsumer::stop() {
+        running_ = false;
+        if (consumer_thread_) {
+            consumer_thread_->join();
+            delete consumer_thread_;
+            consumer_thread_ = nullptr;
+        }
+    }
+
+    void MarketDataConsumer::run() noexcept {
+        logger_.log("%:% %() %\n", __FILE__, __LINE__, __FUNCTION__, Common::get_current_time_str(time_str_));
+        while (running_)
+            poll();
+    }
+
+    // hot path, while in sync this is a single compare per update before it is forwarded
+    void MarketDataConsumer::recv_incremental_callback(Common::McastSocket* socket) noexcept {
+        std::size_t i = 0;
+        for (; i + sizeof(Exchange::MDPMarketUpdate) <= socket->next_rcv_valid_index_; i += sizeof(Exchange::MDPMarketUpdate)) {
+            auto request = reinterpret_cast<const Exchange::MDPMarketUpdate*>(socket->rcv_data_ + i);
+
+            if (LIKELY(!in_recovery_ && request->seq_num_ == next_exp_inc_seq_num_)) {
+                forward(request->me_market_update_);
+                ++next_exp_inc_seq_num_;
+                continue;
+            }
+
+            if (!in_recovery_) {
+                if (request->seq_num_ < next_exp_inc_seq_num_)
+                    continue; // duplicate of something we already forwarded
+
+                logger_.log("%:% %() % packet drops on incremental socket:% expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), socket->socket_fd_, next_exp_inc_seq_num_, request->seq_num_);
+                start_snapshot_sync();
+            }
+
+            queue_incremental(*request);
+            check_snapshot_sync();
+        }
+
+        // keep any partial update for the next read
+        memmove(socket->inbound_data_.data(), socket->rcv_data_ + i, socket->next_rcv_valid_index_ - i);
+        socket->next_rcv_valid_index_ -= i;
+    }
+
+    void MarketDataConsumer::recv_snapshot_callback(Common::McastSocket* socket) noexcept {
+        std::size_t i = 0;
+        for (; in_recovery_ && i + sizeof(Exchange::MDPMarketUpdate) <= socket->next_rcv_valid_index_; i += sizeof(Exchange::MDPMarketUpdate)) {
+            auto request = reinterpret_cast<const Exchange::MDPMarketUpdate*>(socket->rcv_data_ + i);
+            queue_snapshot(*request);
+        }
+
+        // once the sync completed whatever is left of this read is stale snapshot data
+        if (!in_recovery_) {
+            socket->next_rcv_valid_index_ = 0;
+            return;
+        }
+
+        memmove(socket->inbound_data_.data(), socket->rcv_data_ + i, socket->next_rcv_valid_index_ - i);
+        socket->next_rcv_valid_index_ -= i;
+    }
+
+    void MarketDataConsumer::start_snapshot_sync() noexcept {
+        in_recovery_ = true;
+        reset_snapshot();
+        queued_incrementals_start_ = 0;
+        num_queued_incrementals_ = 0;
+
+        ++recovery_stats_.num_recoveries_;
+        recovery_stats_.snapshot_updates_ = 0;
+        recovery_stats_.incrementals_replayed_ = 0;
+        recovery_stats_.incrementals_dropped_ = 0;
+        recovery_stats_.start_time_ = Common::getCurrentNanos();
+        recovery_stats_.end_time_ = 0;
+
+        ASSERT(snapshot_mcast_socket_.init(snapshot_ip_, iface_, snapshot_port_, true) >= 0,
+            "Unable to create snapshot mcast socket. error: " + std::string{strerror(errno)});
+        ASSERT(snapshot_mcast_socket_.join(snapshot_ip_),
+            "Join failed on: " + std::to_string(snapshot_mcast_socket_.socket_fd_) + " error: " + std::string{strerror(errno)});
+    }
+
+    void MarketDataConsumer::queue_incremental(const Exchange::MDPMarketUpdate& update) noexcept {
+        const auto capacity = queued_incrementals_.size();
+        if (UNLIKELY(num_queued_incrementals_ == capacity)) {
+            queued_incrementals_start_ = (queued_incrementals_start_ + 1) % capacity;
+            --num_queued_incrementals_;
+            ++recovery_stats_.incrementals_dropped_;
+        }
+        queued_incrementals_[(queued_incrementals_start_ + num_queued_incrementals_) % capacity] = update;
+        ++num_queued_incrementals_;
+    }
+
+    void MarketDataConsumer::queue_snapshot(const Exchange::MDPMarketUpdate& update) noexcept {
+        // a new snapshot cycle always restarts collection
+        if (update.seq_num_ == 0)
+            reset_snapshot();
+
+        // joined mid-cycle or dropped a snapshot packet, wait for the next SNAPSHOT_START
+        if (update.seq_num_ != num_queued_snapshot_ ||
+            (!num_queued_snapshot_ && update.me_market_update_.type_ != Exchange::MarketUpdateType::SNAPSHOT_START)) {
+            if (num_queued_snapshot_)
+                logger_.log("%:% %() % packet drops on snapshot socket:% expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), snapshot_mcast_socket_.socket_fd_, num_queued_snapshot_, update.seq_num_);
+            reset_snapshot();
+            return;
+        }
+
+        ASSERT(num_queued_snapshot_ < queued_snapshot_.size(), "MarketDataConsumer snapshot buffer too small: " + std::to_string(queued_snapshot_.size()));
+        queued_snapshot_[num_queued_snapshot_++] = update;
+
+        if (update.me_market_update_.type_ == Exchange::MarketUpdateType::SNAPSHOT_END) {
+            snapshot_complete_ = true;
+            check_snapshot_sync();
+        }
+    }
+
+    void MarketDataConsumer::reset_snapshot() noexcept {
+        num_queued_snapshot_ = 0;
+        snapshot_complete_ = false;
+    }
+
+    // a full snapshot is in hand, check that the queued incrementals continue from it without a gap
+    void MarketDataConsumer::check_snapshot_sync() noexcept {
+        if (!snapshot_complete_)
+            return;
+
+        const auto last_snapshot_seq = static_cast<std::size_t>(queued_snapshot_[0].me_market_update_.order_id_);
+        const auto capacity = queued_incrementals_.size();
+
+        // incrementals older than the snapshot will never be needed again, later snapshots are only newer
+        while (num_queued_incrementals_ && queued_incrementals_[queued_incrementals_start_].seq_num_ <= last_snapshot_seq) {
+            queued_incrementals_start_ = (queued_incrementals_start_ + 1) % capacity;
+            --num_queued_incrementals_;
+        }
+
+        auto expected = last_snapshot_seq + 1;
+        for (std::size_t i = 0; i < num_queued_incrementals_; ++i) {
+            const auto seq_num = queued_incrementals_[(queued_incrementals_start_ + i) % capacity].seq_num_;
+            if (seq_num < expected)
+                continue;
+            if (seq_num != expected) {
+                logger_.log("%:% %() % snapshot seq:% does not line up with incrementals, expected:% found:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), last_snapshot_seq, expected, seq_num);
+                reset_snapshot();
+                return;
+            }
+            ++expected;
+        }
+
+        finish_snapshot_sync();
+    }
+
+    void MarketDataConsumer::finish_snapshot_sync() noexcept {
+        const auto last_snapshot_seq = static_cast<std::size_t>(queued_snapshot_[0].me_market_update_.order_id_);
+        const auto capacity = queued_incrementals_.size();
+
+        // skip SNAPSHOT_START / SNAPSHOT_END, the snapshot itself starts with a CLEAR for every ticker
+        for (std::size_t i = 1; i + 1 < num_queued_snapshot_; ++i)
+            forward(queued_snapshot_[i].me_market_update_);
+
+        auto expected = last_snapshot_seq + 1;
+        for (std::size_t i = 0; i < num_queued_incrementals_; ++i) {
+            const auto& update = queued_incrementals_[(queued_incrementals_start_ + i) % capacity];
+            if (update.seq_num_ < expected)
+                continue;
+            forward(update.me_market_update_);
+            ++expected;
+        }
+
+        recovery_stats_.snapshot_updates_ = num_queued_snapshot_ - 2;
+        recovery_stats_.incrementals_replayed_ = expected - last_snapshot_seq - 1;
+        recovery_stats_.end_time_ = Common::getCurrentNanos();
+
+        logger_.log("%:% %() % recovered from snapshot seq:% snapshot updates:% replayed incrementals:% next expected:%\n", __FILE__, __LINE__, __FUNCTION__,
+            Common::get_current_time_str(time_str_), last_snapshot_seq, recovery_stats_.snapshot_updates_, recovery_stats_.incrementals_replayed_, expected);
+
+        next_exp_inc_seq_num_ = expected;
+        in_recovery_ = false;
+        reset_snapshot();
+        queued_incrementals_start_ = 0;
+        num_queued_incrementals_ = 0;
+
+        snapshot_mcast_socket_.leave(snapshot_ip_, snapshot_port_);
+    }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <functional>
+
+#include "common/thread_utils.h"
+#include "common/lock_free_queue.h"
+#include "common/macros.h"
+#include "common/mcast_socket.h"
+
+#include "exchange/market_data/market_update.h"
+
+namespace Trading {
+
+    // default sizing of the recovery buffers, both are allocated once up front
+    constexpr std::size_t MD_MAX_QUEUED_INCREMENTALS = 256 * 1024;
+    constexpr std::size_t MD_MAX_SNAPSHOT_UPDATES = 256 * 1024;
+
+    // counters for the last completed recovery, read them after the fact (not thread safe while recovering)
+    struct RecoveryStats {
+        std::size_t num_recoveries_ = 0;
+        std::size_t snapshot_updates_ = 0;
+        std::size_t incrementals_replayed_ = 0;
+        std::size_t incrementals_dropped_ = 0;
+        Common::Nanos start_time_ = 0;
+        Common::Nanos end_time_ = 0;
+    };
+
+    // Consumes the incremental market data stream and forwards updates in sequence to the trade engine.
+    // On a sequence gap (dropped packets, or joining mid-session) it joins the snapshot stream, buffers incrementals
+    // while a full snapshot is collected, replays snapshot + buffered incrementals from the right sequence number
+    // and leaves the snapshot stream again. While in sync the snapshot socket is not even polled.
+    class MarketDataConsumer final {
+    public:
+        MarketDataConsumer(Common::ClientId client_id, Exchange::MEMarketUpdateLFQueue* market_updates, const std::string& iface,
+                           const std::string& snapshot_ip, int snapshot_port,
+                           const std::string& incremental_ip, int incremental_port,
+                           std::size_t max_queued_incrementals = MD_MAX_QUEUED_INCREMENTALS,
+                           std::size_t max_snapshot_updates = MD_MAX_SNAPSHOT_UPDATES);
+
+        ~MarketDataConsumer();
+
+        MarketDataConsumer() = delete;
+        MarketDataConsumer(const MarketDataConsumer&) = delete;
+        MarketDataConsumer(const MarketDataConsumer&&) = delete;
+        MarketDataConsumer& operator=(const MarketDataConsumer&) = delete;
+        MarketDataConsumer& operator=(const MarketDataConsumer&&) = delete;
+
+        void start();
+        void stop();
+
+        // one iteration of the receive loop, exposed so the consumer can also be driven from an existing poll loop
+        auto poll() noexcept {
+            incremental_mcast_socket_.send_and_recv();
+            if (UNLIKELY(in_recovery_))
+                snapshot_mcast_socket_.send_and_recv();
+        }
+
+        auto in_recovery() const noexcept { return in_recovery_; }
+        auto next_expected_seq_num() const noexcept { return next_exp_inc_seq_num_; }
+        auto get_recovery_stats() const noexcept -> const RecoveryStats& { return recovery_stats_; }
+
+    private:
+        std::size_t next_exp_inc_seq_num_ = 1;
+
+        // output queue towards the trade engine / order book
+        Exchange::MEMarketUpdateLFQueue* incoming_md_updates_ = nullptr;
+
+        std::atomic_bool running_ {false};
+        std::thread* consumer_thread_ = nullptr;
+
+        std::string time_str_;
+        Common::Logger logger_;
+        Common::McastSocket incremental_mcast_socket_;
+        Common::McastSocket snapshot_mcast_socket_;
+
+        bool in_recovery_ = false;
+        const std::string iface_;
+        const std::string snapshot_ip_;
+        const int snapshot_port_;
+
+        // incrementals received while recovering, fixed capacity ring in arrival order, the oldest are dropped on overflow
+        // since any snapshot we can still sync against is newer than them anyway
+        std::vector<Exchange::MDPMarketUpdate> queued_incrementals_;
+        std::size_t queued_incrementals_start_ = 0;
+        std::size_t num_queued_incrementals_ = 0;
+
+        // snapshot cycle being collected, snapshot seq numbers index straight into it
+        std::vector<Exchange::MDPMarketUpdate> queued_snapshot_;
+        std::size_t num_queued_snapshot_ = 0;
+        bool snapshot_complete_ = false;
+
+        RecoveryStats recovery_stats_;
+
+        void run() noexcept;
+
+        void recv_incremental_callback(Common::McastSocket* socket) noexcept;
+        void recv_snapshot_callback(Common::McastSocket* socket) noexcept;
+
+        auto forward(const Exchange::MEMarketUpdate& update) noexcept {
+            auto next_write = incoming_md_updates_->get_next_write();
+            *next_write = update;
+            incoming_md_updates_->update_write_index();
+        }
+
+        void start_snapshot_sync() noexcept;
+        void queue_incremental(const Exchange::MDPMarketUpdate& update) noexcept;
+        void queue_snapshot(const Exchange::MDPMarketUpdate& update) noexcept;
+        void reset_snapshot() noexcept;
+        void check_snapshot_sync() noexcept;
+        void finish_snapshot_sync() noexcept;
+    };
+}
@@ -0,0 +1,128 @@
+#include "market_order_book.h"
+
+#include <algorithm>
+
+namespace Trading {
+
+    namespace {
+        // true if price a is strictly more aggressive than price b for the given side
+        inline bool is_better(Common::Side side, Common::Price a, Common::Price b) noexcept {
+            return side == Common::Side::BUY ? a > b : a < b;
+        }
+    }
+
+    MarketOrderBook::MarketOrderBook(Common::TickerId ticker_id) : ticker_id_{ticker_id}, oid_to_order_(Common::ME_MAX_ORDER_IDS) {
+        bids_.reserve(Common::ME_MAX_PRICE_LEVELS);
+        asks_.reserve(Common::ME_MAX_PRICE_LEVELS);
+    }
+
+    void MarketOrderBook::on_market_update(const Exchange::MEMarketUpdate* market_update) noexcept {
+        const auto order_id = market_update->order_id_;
+
+        switch (market_update->type_) {
+            case Exchange::MarketUpdateType::ADD: {
+                ASSERT(order_id < oid_to_order_.size(), "MarketOrderBook order id out of range: " + Common::order_id_to_string(order_id));
+                auto& order = oid_to_order_[order_id];
+                order = {market_update->price_, market_update->qty_, market_update->side_};
+                add_qty(order.side_, order.price_, order.qty_, true);
+            }
+                break;
+            case Exchange::MarketUpdateType::MODIFY: {
+                ASSERT(order_id < oid_to_order_.size(), "MarketOrderBook order id out of range: " + Common::order_id_to_string(order_id));
+                auto& order = oid_to_order_[order_id];
+                if (UNLIKELY(!order.qty_))
+                    break; // modify for an order we never saw, can only happen around a recovery
+                if (order.price_ == market_update->price_) {
+                    if (market_update->qty_ > order.qty_)
+                        add_qty(order.side_, order.price_, market_update->qty_ - order.qty_, false);
+                    else if (market_update->qty_ < order.qty_)
+                        remove_qty(order.side_, order.price_, order.qty_ - market_update->qty_, false);
+                } else {
+                    remove_qty(order.side_, order.price_, order.qty_, true);
+                    add_qty(order.side_, market_update->price_, market_update->qty_, true);
+                }
+                order.price_ = market_update->price_;
+                order.qty_ = market_update->qty_;
+            }
+                break;
+            case Exchange::MarketUpdateType::CANCEL: {
+                ASSERT(order_id < oid_to_order_.size(), "MarketOrderBook order id out of range: " + Common::order_id_to_string(order_id));
+                auto& order = oid_to_order_[order_id];
+                if (UNLIKELY(!order.qty_))
+                    break;
+                remove_qty(order.side_, order.price_, order.qty_, true);
+                order = {};
+            }
+                break;
+            case Exchange::MarketUpdateType::TRADE:
+                last_trade_ = *market_update; // the exchange follows up with MODIFY / CANCEL for the passive order
+                return;
+            case Exchange::MarketUpdateType::CLEAR:
+                clear();
+                return;
+            case Exchange::MarketUpdateType::INVALID:
+            case Exchange::MarketUpdateType::SNAPSHOT_START:
+            case Exchange::MarketUpdateType::SNAPSHOT_END:
+                return;
+        }
+
+        update_bbo();
+    }
+
+    void MarketOrderBook::add_qty(Common::Side side, Common::Price price, Common::Qty qty, bool add_order) noexcept {
+        auto& levels = (side == Common::Side::BUY) ? bids_ : asks_;
+
+        // walk in from the best level, skipping everything more aggressive than price
+        auto i = levels.size();
+        while (i > 0 && is_better(side, levels[i - 1].price_, price))
+            --i;
+
+        if (i > 0 && levels[i - 1].price_ == price) {
+            levels[i - 1].qty_ += qty;
+            levels[i - 1].num_orders_ += add_order;
+            return;
+        }
+
+        ASSERT(levels.size() < levels.capacity(), "MarketOrderBook out of price levels for ticker: " + Common::ticker_id_to_string(ticker_id_));
+        levels.insert(levels.begin() + i, PriceLevel{price, qty, 1});
+    }
+
+    void MarketOrderBook::remove_qty(Common::Side side, Common::Price price, Common::Qty qty, bool remove_order) noexcept {
+        auto& levels = (side == Common::Side::BUY) ? bids_ : asks_;
+
+        auto i = levels.size();
+        while (i > 0 && levels[i - 1].price_ != price)
+            --i;
+        ASSERT(i > 0, "MarketOrderBook missing price level:" + Common::price_to_string(price) + " ticker: " + Common::ticker_id_to_string(ticker_id_));
+
+        auto& level = levels[i - 1];
+        level.qty_ -= qty;
+        if (remove_order && !--level.num_orders_)
+            levels.erase(levels.begin() + (i - 1));
+    }
+
+    void MarketOrderBook::update_bbo() noexcept {
+        bbo_.bid_price_ = bids_.empty() ? Common::Price_INVALID : bids_.back().price_;
+        bbo_.bid_qty_ = bids_.empty() ? Common::Qty_INVALID : bids_.back().qty_;
+        bbo_.ask_price_ = asks_.empty() ? Common::Price_INVALID : asks_.back().price_;
+        bbo_.ask_qty_ = asks_.empty() ? Common::Qty_INVALID : asks_.back().qty_;
+    }
+
+    void MarketOrderBook::clear() noexcept {
+        std::fill(oid_to_order_.begin(), oid_to_order_.end(), MarketOrder{});
+        bids_.clear();
+        asks_.clear();
+        last_trade_ = {};
+        update_bbo();
+    }
+
+    std::string MarketOrderBook::to_string() const {
+        std::stringstream ss;
+        ss << "MarketOrderBook[ticker:" << Common::ticker_id_to_string(ticker_id_) << " " << bbo_.to_string() << "]\n";
+        for (auto i = asks_.begin(); i != asks_.end(); ++i)
+            ss << "  ASK " << i->qty_ << "@" << i->price_ << " (" << i->num_orders_ << ")\n";
+        for (auto i = bids_.rbegin(); i != bids_.rend(); ++i)
+            ss << "  BID " << i->qty_ << "@" << i->price_ << " (" << i->num_orders_ << ")\n";
+        return ss.str();
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <sstream>
+
+#include "common/types.h"
+#include "common/macros.h"
+#include "exchange/market_data/market_update.h"
+
+namespace Trading {
+
+    // live order as seen through the public market data feed, indexed by its exchange order id
+    struct MarketOrder {
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty qty_ = 0;
+        Common::Side side_ = Common::Side::INVALID;
+    };
+
+    // aggregated quantity at a single price
+    struct PriceLevel {
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty qty_ = 0;
+        uint32_t num_orders_ = 0;
+    };
+
+    // best bid and offer, this is what most strategies actually look at
+    struct BBO {
+        Common::Price bid_price_ = Common::Price_INVALID;
+        Common::Price ask_price_ = Common::Price_INVALID;
+        Common::Qty bid_qty_ = Common::Qty_INVALID;
+        Common::Qty ask_qty_ = Common::Qty_INVALID;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "BBO{" << Common::qty_to_string(bid_qty_) << "@" << Common::price_to_string(bid_price_) << "X"
+               << Common::price_to_string(ask_price_) << "@" << Common::qty_to_string(ask_qty_) << "}";
+            return ss.str();
+        }
+    };
+
+    class MarketOrderBook final {
+    public:
+        explicit MarketOrderBook(Common::TickerId ticker_id);
+
+        MarketOrderBook() = delete;
+        MarketOrderBook(const MarketOrderBook&) = delete;
+        MarketOrderBook(const MarketOrderBook&&) = delete;
+        MarketOrderBook& operator=(const MarketOrderBook&) = delete;
+        MarketOrderBook& operator=(const MarketOrderBook&&) = delete;
+
+        // apply a single update from the market data consumer, CLEAR wipes the book (sent ahead of a snapshot)
+        void on_market_update(const Exchange::MEMarketUpdate* market_update) noexcept;
+
+        auto get_bbo() const noexcept -> const BBO* { return &bbo_; }
+        auto get_last_trade() const noexcept -> const Exchange::MEMarketUpdate* { return &last_trade_; }
+        auto get_ticker_id() const noexcept { return ticker_id_; }
+
+        // number of price levels on each side, levels are stored worst to best
+        auto num_bid_levels() const noexcept { return bids_.size(); }
+        auto num_ask_levels() const noexcept { return asks_.size(); }
+        auto bid_level(std::size_t depth) const noexcept -> const PriceLevel* { return depth < bids_.size() ? &bids_[bids_.size() - 1 - depth] : nullptr; }
+        auto ask_level(std::size_t depth) const noexcept -> const PriceLevel* { return depth < asks_.size() ? &asks_[asks_.size() - 1 - depth] : nullptr; }
+
+        void clear() noexcept;
+        std::string to_string() const;
+
+    private:
+        const Common::TickerId ticker_id_;
+
+        // direct index by exchange order id, no hashing on the hot path
+        std::vector<MarketOrder> oid_to_order_;
+
+        // one vector per side, sorted so that the best level is at back(), most updates happen near the inside
+        // of the book so the linear search from the back is short and predictable (see docs/notes/order_book.txt)
+        std::vector<PriceLevel> bids_;
+        std::vector<PriceLevel> asks_;
+
+        BBO bbo_;
+        Exchange::MEMarketUpdate last_trade_;
+
+        void add_qty(Common::Side side, Common::Price price, Common::Qty qty, bool add_order) noexcept;
+        void remove_qty(Common::Side side, Common::Price price, Common::Qty qty, bool remove_order) noexcept;
+        void update_bbo() noexcept;
+    };
+
+    using MarketOrderBookHashMap = std::array<MarketOrderBook*, Common::ME_MAX_TICKERS>;
+}
@@ -0,0 +1,32 @@
+#include "top_of_book_broadcast.h"
+
+namespace Trading {
+
+    TopOfBookBroadcast::TopOfBookBroadcast(std::size_t num_instruments, std::size_t max_readers)
+        : num_instruments_{num_instruments}, max_readers_{max_readers}, num_words_{(num_instruments + 63) / 64},
+          bitmap_stride_{(num_words_ * sizeof(uint64_t) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE / sizeof(uint64_t)},
+          slots_(num_instruments), latest_(num_instruments), changed_(max_readers * bitmap_stride_) {
+        ASSERT(num_instruments, "TopOfBookBroadcast needs at least one instrument.");
+    }
+
+    TopOfBookReaderId TopOfBookBroadcast::add_reader() noexcept {
+        // slots are taken in order, the writer only looks at bitmaps below num_readers_
+        auto reader_id = num_readers_.load(std::memory_order_relaxed);
+        do {
+            ASSERT(reader_id < max_readers_, "TopOfBookBroadcast out of reader slots, max_readers:" + std::to_string(max_readers_));
+        } while (!num_readers_.compare_exchange_weak(reader_id, reader_id + 1, std::memory_order_acq_rel));
+        return reader_id;
+    }
+
+    std::string TopOfBookBroadcast::to_string() const {
+        std::stringstream ss;
+        ss << "TopOfBookBroadcast instruments:" << num_instruments_ << " readers:" << num_readers() << "/" << max_readers_ << "\n";
+        for (std::size_t ticker_id = 0; ticker_id < num_instruments_; ++ticker_id) {
+            uint64_t seq;
+            const auto top_of_book = read(static_cast<Common::TickerId>(ticker_id), seq);
+            if (seq)
+                ss << " ticker:" << ticker_id << " seq:" << seq << " " << top_of_book.to_string() << "\n";
+        }
+        return ss.str();
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/time_utils.h"
+#include "common/seqlock.h"
+
+#include "market_order_book.h"
+
+namespace Trading {
+
+    // latest BBO and last trade of one instrument
+    struct TopOfBook {
+        Common::Price bid_price_ = Common::Price_INVALID;
+        Common::Price ask_price_ = Common::Price_INVALID;
+        Common::Qty bid_qty_ = Common::Qty_INVALID;
+        Common::Qty ask_qty_ = Common::Qty_INVALID;
+
+        Common::Price last_trade_price_ = Common::Price_INVALID;
+        Common::Qty last_trade_qty_ = Common::Qty_INVALID;
+        Common::Side last_trade_side_ = Common::Side::INVALID;
+
+        Common::Nanos update_time_ = 0; // as passed by the writer, lets readers measure how stale their view is
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "TopOfBook{" << Common::qty_to_string(bid_qty_) << "@" << Common::price_to_string(bid_price_) << "X"
+               << Common::price_to_string(ask_price_) << "@" << Common::qty_to_string(ask_qty_)
+               << " last:" << Common::side_to_string(last_trade_side_) << " " << Common::qty_to_string(last_trade_qty_)
+               << "@" << Common::price_to_string(last_trade_price_) << " time:" << update_time_ << "}";
+            return ss.str();
+        }
+    };
+
+    using TopOfBookReaderId = std::size_t;
+
+    // Conflating broadcast of TopOfBook from one market data thread to any number of reader threads. Every instrument
+    // has its own cache line sized slot behind its own seqlock, the writer overwrites it in place and never waits on
+    // anybody, readers always get the latest consistent value and never see the intermediate ones they were too slow
+    // for. A reader only retries when its copy overlapped a write to that same instrument.
+    // Readers that want to know what moved register with add_reader() and get a bitmap of the instruments published
+    // since they last asked, the writer pays one check (and an atomic or while the bit is clear) per registered reader.
+    class TopOfBookBroadcast final {
+    public:
+        explicit TopOfBookBroadcast(std::size_t num_instruments = Common::ME_MAX_TICKERS, std::size_t max_readers = 0);
+
+        TopOfBookBroadcast() = delete;
+        TopOfBookBroadcast(const TopOfBookBroadcast&) = delete;
+        TopOfBookBroadcast(const TopOfBookBroadcast&&) = delete;
+        TopOfBookBroadcast& operator=(const TopOfBookBroadcast&) = delete;
+        TopOfBookBroadcast& operator=(const TopOfBookBroadcast&&) = delete;
+
+        // writer thread only
+
+        auto publish(Common::TickerId ticker_id, const TopOfBook& top_of_book) noexcept {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast publish out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            auto& slot = slots_[ticker_id];
+            slot.lock_.write_begin();
+            slot.data_.store(top_of_book);
+            slot.lock_.write_end();
+            latest_[ticker_id] = top_of_book;
+            mark_changed(ticker_id);
+        }
+
+        auto publish_bbo(Common::TickerId ticker_id, const BBO& bbo, Common::Nanos time) noexcept {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast publish_bbo out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            auto top_of_book = latest_[ticker_id];
+            top_of_book.bid_price_ = bbo.bid_price_;
+            top_of_book.ask_price_ = bbo.ask_price_;
+            top_of_book.bid_qty_ = bbo.bid_qty_;
+            top_of_book.ask_qty_ = bbo.ask_qty_;
+            top_of_book.update_time_ = time;
+            publish(ticker_id, top_of_book);
+        }
+
+        auto publish_trade(Common::TickerId ticker_id, Common::Side side, Common::Price price, Common::Qty qty, Common::Nanos time) noexcept {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast publish_trade out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            auto top_of_book = latest_[ticker_id];
+            top_of_book.last_trade_side_ = side;
+            top_of_book.last_trade_price_ = price;
+            top_of_book.last_trade_qty_ = qty;
+            top_of_book.update_time_ = time;
+            publish(ticker_id, top_of_book);
+        }
+
+        // BBO and last trade of the book in one go, call it after MarketOrderBook::on_market_update()
+        auto publish(const MarketOrderBook& book, Common::Nanos time) noexcept {
+            const auto bbo = book.get_bbo();
+            const auto trade = book.get_last_trade();
+            publish(book.get_ticker_id(), TopOfBook{bbo->bid_price_, bbo->ask_price_, bbo->bid_qty_, bbo->ask_qty_,
+                                                    trade->price_, trade->qty_, trade->side_, time});
+        }
+
+        // any thread
+
+        // blocks only while a write to this instrument is in progress, i.e. for a few stores
+        auto read(Common::TickerId ticker_id) const noexcept {
+            uint64_t seq;
+            return read(ticker_id, seq);
+        }
+
+        // also hands back the instrument's sequence, unchanged sequence means unchanged value
+        auto read(Common::TickerId ticker_id, uint64_t& seq_out) const noexcept -> TopOfBook {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast read out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            const auto& slot = slots_[ticker_id];
+            while (true) {
+                const auto seq = slot.lock_.read_begin();
+                const auto top_of_book = slot.data_.load();
+                if (LIKELY(!slot.lock_.read_retry(seq))) {
+                    seq_out = seq;
+                    return top_of_book;
+                }
+            }
+        }
+
+        // wait-free variant, a single attempt that returns false if it raced with the writer
+        auto try_read(Common::TickerId ticker_id, TopOfBook& top_of_book) const noexcept {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast try_read out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            const auto& slot = slots_[ticker_id];
+            const auto seq = slot.lock_.sequence();
+            if (seq & 1)
+                return false;
+            top_of_book = slot.data_.load();
+            return !slot.lock_.read_retry(seq);
+        }
+
+        auto sequence(Common::TickerId ticker_id) const noexcept {
+            ASSERT(ticker_id < num_instruments_, "TopOfBookBroadcast sequence out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+            return slots_[ticker_id].lock_.sequence();
+        }
+
+        // registers a reader for for_each_changed(), at most max_readers from the constructor. The reader
+        // sees every instrument published from now on, read everything once after registering to catch up.
+        TopOfBookReaderId add_reader() noexcept;
+
+        // calls f(ticker_id) once for every instrument published since the last call by this reader and clears them,
+        // returns how many there were. Only the reader that owns reader_id may call it.
+        template<typename F>
+        auto for_each_changed(TopOfBookReaderId reader_id, F&& f) noexcept {
+            auto words = &changed_[reader_id * bitmap_stride_];
+            std::size_t num_changed = 0;
+            for (std::size_t word = 0; word < num_words_; ++word) {
+                if (!words[word].load(std::memory_order_relaxed))
+                    continue;
+                // clear before reading so a publish racing with us leaves its bit set for the next call
+                auto bits = words[word].exchange(0, std::memory_order_acquire);
+                while (bits) {
+                    const auto bit = static_cast<std::size_t>(__builtin_ctzll(bits));
+                    bits &= bits - 1;
+                    f(static_cast<Common::TickerId>(word * 64 + bit));
+                    ++num_changed;
+                }
+            }
+            return num_changed;
+        }
+
+        auto num_instruments() const noexcept { return num_instruments_; }
+        auto num_readers() const noexcept { return num_readers_.load(std::memory_order_acquire); }
+
+        std::string to_string() const;
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) Slot {
+            Common::SeqLock lock_;
+            Common::SeqLockSlot<TopOfBook> data_;
+        };
+        static_assert(sizeof(Slot) == CACHE_LINE_SIZE, "TopOfBook has to fit a single cache line with its sequence.");
+
+        const std::size_t num_instruments_;
+        const std::size_t max_readers_;
+        const std::size_t num_words_;     // bitmap words per reader
+        const std::size_t bitmap_stride_; // num_words_ rounded up to whole cache lines, readers never share a line
+
+        std::vector<Slot> slots_;
+        std::vector<TopOfBook> latest_;   // writer's own copy, partial updates never read back the shared slots
+
+        std::atomic<std::size_t> num_readers_ {0};
+        std::vector<std::atomic<uint64_t>> changed_;
+
+        void mark_changed(Common::TickerId ticker_id) noexcept {
+            const auto num_readers = num_readers_.load(std::memory_order_acquire);
+            const auto word = ticker_id / 64;
+            const auto bit = uint64_t{1} << (ticker_id % 64);
+            for (std::size_t reader_id = 0; reader_id < num_readers; ++reader_id) {
+                auto& bits = changed_[reader_id * bitmap_stride_ + word];
+                // already marked and not yet consumed, the reader will pick up this value too
+                if (!(bits.load(std::memory_order_relaxed) & bit))
+                    bits.fetch_or(bit, std::memory_order_release);
+            }
+        }
+    };
+}
@@ -0,0 +1,154 @@
+#include "order_gateway.h"
+
+namespace Trading {
+
+    OrderGateway::OrderGateway(Common::ClientId client_id, Exchange::ClientResponseLFQueue* client_responses,
+                               const std::string& ip, const std::string& iface, int port,
+                               Common::Nanos heartbeat_interval, std::size_t resend_store_size, OrderJournal* journal)
+        : client_id_{client_id}, incoming_responses_{client_responses},
+          logger_{"trading_order_gateway_" + std::to_string(client_id) + ".log"}, tcp_socket_{logger_},
+          ip_{ip}, iface_{iface}, port_{port},
+          resend_store_(resend_store_size), resend_store_mask_{resend_store_size - 1},
+          journal_{journal}, heartbeat_interval_{heartbeat_interval} {
+        ASSERT(resend_store_size && !(resend_store_size & resend_store_mask_), "OrderGateway resend store size must be a power of two.");
+
+        for (std::size_t ticker_id = 0; ticker_id < Common::ME_MAX_TICKERS; ++ticker_id) {
+            for (auto side : {Common::Side::BUY, Common::Side::SELL}) {
+                new_order_templates_[ticker_id][side_index(side)] = {0, {Exchange::ClientRequestType::NEW, client_id_, static_cast<Common::TickerId>(ticker_id),
+                    Common::OrderId_INVALID, side, Common::Price_INVALID, Common::Qty_INVALID}};
+                cancel_templates_[ticker_id][side_index(side)] = {0, {Exchange::ClientRequestType::CANCEL, client_id_, static_cast<Common::TickerId>(ticker_id),
+                    Common::OrderId_INVALID, side, Common::Price_INVALID, Common::Qty_INVALID}};
+            }
+        }
+
+        tcp_socket_.recv_callback_ = [this](auto socket, auto rx_time) { recv_callback(socket, rx_time); };
+    }
+
+    OrderGateway::~OrderGateway() {
+        if (tcp_socket_.socket_fd_ >= 0)
+            close(tcp_socket_.socket_fd_);
+    }
+
+    void OrderGateway::connect() {
+        if (tcp_socket_.socket_fd_ >= 0) {
+            logger_.log("%:% %() % closing socket:% for reconnect\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::get_current_time_str(time_str_), tcp_socket_.socket_fd_);
+            close(tcp_socket_.socket_fd_);
+        }
+
+        // anything half written or half read belonged to the old connection, responses are sequenced per connection
+        tcp_socket_.next_send_valid_index_ = 0;
+        tcp_socket_.next_recv_valid_index_ = 0;
+        next_exp_seq_num_ = 1;
+
+        ASSERT(tcp_socket_.connect(ip_, iface_, port_, false) >= 0,
+            "Unable to connect to ip:" + ip_ + " port:" + std::to_string(port_) + " on iface:" + iface_ + " error:" + std::string{strerror(errno)});
+
+        last_recv_time_ = last_heartbeat_check_ = Common::getCurrentNanos();
+    }
+
+    void OrderGateway::poll(Common::Nanos now) noexcept {
+        if (now - last_heartbeat_check_ >= heartbeat_interval_) {
+            if (!sent_since_heartbeat_check_)
+                send_heartbeat();
+            sent_since_heartbeat_check_ = false;
+            last_heartbeat_check_ = now;
+        }
+
+        tcp_socket_.send_and_recv();
+    }
+
+    void OrderGateway::recover(const OrderEvent& event) noexcept {
+        if (event.type_ != OrderEventType::NEW_SENT && event.type_ != OrderEventType::CANCEL_SENT)
+            return;
+
+        check_template(event.ticker_id_, event.side_);
+        const auto& templates = (event.type_ == OrderEventType::NEW_SENT ? new_order_templates_ : cancel_templates_);
+        auto& request = resend_store_[event.seq_num_ & resend_store_mask_];
+        request = templates[event.ticker_id_][side_index(event.side_)];
+        request.seq_num_ = event.seq_num_;
+        request.me_client_request_.order_id_ = event.client_order_id_;
+        if (event.type_ == OrderEventType::NEW_SENT) {
+            request.me_client_request_.price_ = event.price_;
+            request.me_client_request_.qty_ = event.qty_;
+        }
+
+        next_outgoing_seq_num_ = std::max(next_outgoing_seq_num_, event.seq_num_ + 1);
+    }
+
+    bool OrderGateway::replay_from(std::size_t seq_num) noexcept {
+        if (seq_num >= next_outgoing_seq_num_)
+            return true;
+
+        if (!seq_num || next_outgoing_seq_num_ - seq_num > resend_store_.size()) {
+            logger_.log("%:% %() % cannot replay from seq:% next seq:% store size:%\n", __FILE__, __LINE__, __FUNCTION__,
+                Common::get_current_time_str(time_str_), seq_num, next_outgoing_seq_num_, resend_store_.size());
+            return false;
+        }
+
+        logger_.log("%:% %() % replaying seq:% to seq:%\n", __FILE__, __LINE__, __FUNCTION__,
+            Common::get_current_time_str(time_str_), seq_num, next_outgoing_seq_num_ - 1);
+
+        for (auto i = seq_num; i < next_outgoing_seq_num_; ++i)
+            tcp_socket_.send(&resend_store_[i & resend_store_mask_], sizeof(Exchange::OMClientRequest));
+        tcp_socket_.flush();
+
+        return true;
+    }
+
+    void OrderGateway::send_heartbeat() noexcept {
+        const Exchange::OMClientRequest heartbeat{next_outgoing_seq_num_ - 1, {Exchange::ClientRequestType::HEARTBEAT, client_id_}};
+        tcp_socket_.send(&heartbeat, sizeof(heartbeat));
+    }
+
+    void OrderGateway::recv_callback(Common::TCPSocket* socket, Common::Nanos rx_time) noexcept {
+        logger_.log("%:% %() % received socket:% len:% rx:%\n", __FILE__, __LINE__, __FUNCTION__,
+            Common::get_current_time_str(time_str_), socket->socket_fd_, socket->next_recv_valid_index_, rx_time);
+
+        last_recv_time_ = Common::getCurrentNanos();
+
+        std::size_t i = 0;
+        for (; i + sizeof(Exchange::OMClientResponse) <= socket->next_recv_valid_index_; i += sizeof(Exchange::OMClientResponse)) {
+            auto response = reinterpret_cast<const Exchange::OMClientResponse*>(socket->inbound_data_.data() + i);
+
+            if (response->me_client_response_.type_ == Exchange::ClientResponseType::HEARTBEAT)
+                continue;
+
+            if (UNLIKELY(response->me_client_response_.client_id_ != client_id_)) {
+                logger_.log("%:% %() % ERROR incorrect client id. client id expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), client_id_, response->me_client_response_.client_id_);
+                continue;
+            }
+
+            // already seen, e.g. resent by the exchange, drop it
+            if (UNLIKELY(response->seq_num_ < next_exp_seq_num_)) {
+                logger_.log("%:% %() % ERROR duplicate sequence number. expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), next_exp_seq_num_, response->seq_num_);
+                continue;
+            }
+
+            // the skipped responses are gone, waiting for them would drop everything after as well. Resync and count the
+            // gap, the caller decides whether to reconcile (or reconnect) from num_response_gaps()
+            if (UNLIKELY(response->seq_num_ > next_exp_seq_num_)) {
+                logger_.log("%:% %() % ERROR sequence gap, resyncing. expected:% received:%\n", __FILE__, __LINE__, __FUNCTION__,
+                    Common::get_current_time_str(time_str_), next_exp_seq_num_, response->seq_num_);
+                ++num_response_gaps_;
+                num_missed_responses_ += response->seq_num_ - next_exp_seq_num_;
+                next_exp_seq_num_ = response->seq_num_;
+            }
+
+            ++next_exp_seq_num_;
+
+            if (journal_)
+                journal_->append(order_event_from_response(response->me_client_response_), rx_time ? rx_time : last_recv_time_);
+
+            auto next_write = incoming_responses_->get_next_write();
+            *next_write = response->me_client_response_;
+            incoming_responses_->update_write_index();
+        }
+
+        // the partial response left over can overlap the bytes it moves onto
+        memmove(socket->inbound_data_.data(), socket->inbound_data_.data() + i, socket->next_recv_valid_index_ - i);
+        socket->next_recv_valid_index_ -= i;
+    }
+}
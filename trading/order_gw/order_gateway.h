@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+#include "common/macros.h"
+#include "common/time_utils.h"
+#include "common/tcp_socket.h"
+
+#include "exchange/order_server/client_request.h"
+#include "exchange/order_server/client_response.h"
+
+#include "trading/order_gw/order_journal.h"
+
+namespace Trading {
+
+    // number of sent requests kept for replay after a reconnect, must be a power of two
+    constexpr std::size_t OG_RESEND_STORE_SIZE = 64 * 1024;
+    constexpr Common::Nanos OG_HEARTBEAT_INTERVAL = 1'000'000'000;
+
+    // Client side of the order gateway TCP session, driven entirely from the caller's loop (no thread of its own).
+    // Requests are pre-encoded per ticker and side, sending an order copies the template straight into the socket's
+    // outbound buffer, patches price / qty / client order id / seq in place, commits and flushes. Every sequenced request
+    // is kept in a bounded resend store so it can be replayed after a reconnect.
+    // With a journal every request sent and every response received is also appended to it, so a restarted process can
+    // recover() its outgoing seq numbers and resend store before connecting again.
+    class OrderGateway final {
+    public:
+        OrderGateway(Common::ClientId client_id, Exchange::ClientResponseLFQueue* client_responses,
+                     const std::string& ip, const std::string& iface, int port,
+                     Common::Nanos heartbeat_interval = OG_HEARTBEAT_INTERVAL, std::size_t resend_store_size = OG_RESEND_STORE_SIZE,
+                     OrderJournal* journal = nullptr);
+
+        ~OrderGateway();
+
+        OrderGateway() = delete;
+        OrderGateway(const OrderGateway&) = delete;
+        OrderGateway(const OrderGateway&&) = delete;
+        OrderGateway& operator=(const OrderGateway&) = delete;
+        OrderGateway& operator=(const OrderGateway&&) = delete;
+
+        // (re)establish the TCP session, outgoing seq numbers carry on across reconnects
+        // the caller replays with replay_from() once it knows the last seq number the exchange processed
+        void connect();
+
+        // hot path, returns the seq number the request was sent with. strategy_id only goes into the journal
+        auto send_new_order(Common::TickerId ticker_id, Common::Side side, Common::Price price, Common::Qty qty, Common::OrderId client_order_id,
+                            Common::StrategyId strategy_id = 0) noexcept {
+            check_template(ticker_id, side);
+            auto request = reinterpret_cast<Exchange::OMClientRequest*>(tcp_socket_.get_next_write());
+            memcpy(request, &new_order_templates_[ticker_id][side_index(side)], sizeof(Exchange::OMClientRequest));
+            request->me_client_request_.order_id_ = client_order_id;
+            request->me_client_request_.price_ = price;
+            request->me_client_request_.qty_ = qty;
+            const auto seq_num = commit(request);
+            if (journal_)
+                journal_->append({OrderEventType::NEW_SENT, ticker_id, client_order_id, Common::OrderId_INVALID, side, price, qty, qty, seq_num,
+                                  strategy_id}, Common::getCurrentNanos());
+            return seq_num;
+        }
+
+        auto send_cancel(Common::TickerId ticker_id, Common::Side side, Common::OrderId client_order_id, Common::StrategyId strategy_id = 0) noexcept {
+            check_template(ticker_id, side);
+            auto request = reinterpret_cast<Exchange::OMClientRequest*>(tcp_socket_.get_next_write());
+            memcpy(request, &cancel_templates_[ticker_id][side_index(side)], sizeof(Exchange::OMClientRequest));
+            request->me_client_request_.order_id_ = client_order_id;
+            const auto seq_num = commit(request);
+            if (journal_)
+                journal_->append({OrderEventType::CANCEL_SENT, ticker_id, client_order_id, Common::OrderId_INVALID, side,
+                                  Common::Price_INVALID, Common::Qty_INVALID, Common::Qty_INVALID, seq_num, strategy_id}, Common::getCurrentNanos());
+            return seq_num;
+        }
+
+        // call from the owning loop, sends a heartbeat if the session was idle for an interval, dispatches
+        // responses and pushes out anything a previous flush could not
+        void poll(Common::Nanos now) noexcept;
+
+        // feed every replayed journal event through this before connect(), rebuilds the resend store and carries the
+        // outgoing seq numbers on from where the previous process stopped
+        void recover(const OrderEvent& event) noexcept;
+
+        // resend every stored request from seq_num onwards, false if part of that range already left the store
+        bool replay_from(std::size_t seq_num) noexcept;
+
+        auto next_outgoing_seq_num() const noexcept { return next_outgoing_seq_num_; }
+        auto next_expected_seq_num() const noexcept { return next_exp_seq_num_; }
+        auto last_recv_time() const noexcept { return last_recv_time_; }
+
+        // responses arriving ahead of the expected seq number, the session resyncs to them, and how many were skipped
+        auto num_response_gaps() const noexcept { return num_response_gaps_; }
+        auto num_missed_responses() const noexcept { return num_missed_responses_; }
+
+        // nothing, not even a heartbeat, heard from the exchange for more than two intervals
+        auto is_peer_stale(Common::Nanos now) const noexcept { return now - last_recv_time_ > 2 * heartbeat_interval_; }
+
+    private:
+        const Common::ClientId client_id_;
+
+        std::size_t next_outgoing_seq_num_ = 1;
+        std::size_t next_exp_seq_num_ = 1;
+
+        Exchange::ClientResponseLFQueue* incoming_responses_ = nullptr;
+
+        std::string time_str_;
+        Common::Logger logger_;
+        Common::TCPSocket tcp_socket_;
+
+        const std::string ip_;
+        const std::string iface_;
+        const int port_;
+
+        // pre-encoded requests, only the per order fields get patched when sending
+        std::array<std::array<Exchange::OMClientRequest, 2>, Common::ME_MAX_TICKERS> new_order_templates_;
+        std::array<std::array<Exchange::OMClientRequest, 2>, Common::ME_MAX_TICKERS> cancel_templates_;
+
+        // sent requests indexed by seq num & mask, oldest entries get overwritten
+        std::vector<Exchange::OMClientRequest> resend_store_;
+        const std::size_t resend_store_mask_;
+
+        OrderJournal* journal_ = nullptr;
+
+        const Common::Nanos heartbeat_interval_;
+        Common::Nanos last_heartbeat_check_ = 0;
+        Common::Nanos last_recv_time_ = 0;
+        bool sent_since_heartbeat_check_ = false;
+
+        std::size_t num_response_gaps_ = 0;
+        std::size_t num_missed_responses_ = 0;
+
+        static constexpr auto side_index(Common::Side side) noexcept -> std::size_t { return side == Common::Side::BUY ? 0 : 1; }
+
+        // the templates only exist for ME_MAX_TICKERS instruments and BUY / SELL, side_index() would send anything else as a SELL
+        static auto check_template(Common::TickerId ticker_id, Common::Side side) noexcept -> void {
+            ASSERT(ticker_id < Common::ME_MAX_TICKERS && (side == Common::Side::BUY || side == Common::Side::SELL),
+                   "OrderGateway no request template for ticker:" + Common::ticker_id_to_string(ticker_id) + " side:" + Common::side_to_string(side));
+        }
+
+        // sequence, keep a copy for replay and hand the bytes to the kernel
+        // the copy has to happen first, a partial send moves the outbound buffer contents
+        auto commit(Exchange::OMClientRequest* request) noexcept -> std::size_t {
+            const auto seq_num = next_outgoing_seq_num_++;
+            request->seq_num_ = seq_num;
+            resend_store_[seq_num & resend_store_mask_] = *request;
+
+            tcp_socket_.update_write_index(sizeof(Exchange::OMClientRequest));
+            tcp_socket_.flush();
+
+            sent_since_heartbeat_check_ = true;
+            return seq_num;
+        }
+
+        void send_heartbeat() noexcept;
+        void recv_callback(Common::TCPSocket* socket, Common::Nanos rx_time) noexcept;
+    };
+}
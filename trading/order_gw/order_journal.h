@@ -0,0 +1,106 @@
+#pragma once
+
+#include <sstream>
+
+#include "common/types.h"
+#include "common/journal.h"
+
+#include "exchange/order_server/client_request.h"
+#include "exchange/order_server/client_response.h"
+
+namespace Trading {
+
+    enum class OrderEventType : uint8_t {
+        INVALID = 0,
+        NEW_SENT = 1,
+        CANCEL_SENT = 2,
+        ACCEPTED = 3,
+        CANCELED = 4,
+        FILLED = 5,
+        CANCEL_REJECTED = 6
+    };
+
+    inline std::string order_event_type_to_string(OrderEventType type) {
+        switch (type) {
+            case OrderEventType::NEW_SENT:
+                return "NEW_SENT";
+            case OrderEventType::CANCEL_SENT:
+                return "CANCEL_SENT";
+            case OrderEventType::ACCEPTED:
+                return "ACCEPTED";
+            case OrderEventType::CANCELED:
+                return "CANCELED";
+            case OrderEventType::FILLED:
+                return "FILLED";
+            case OrderEventType::CANCEL_REJECTED:
+                return "CANCEL_REJECTED";
+            case OrderEventType::INVALID:
+                return "INVALID";
+        }
+        return "UNKNOWN";
+    }
+
+#pragma pack(push, 1)
+
+    // one journal entry per order request sent and per (non heartbeat) response received
+    struct OrderEvent {
+        OrderEventType type_ = OrderEventType::INVALID;
+
+        Common::TickerId ticker_id_ = Common::TickerId_INVALID;
+        Common::OrderId client_order_id_ = Common::OrderId_INVALID;
+        Common::OrderId market_order_id_ = Common::OrderId_INVALID;
+        Common::Side side_ = Common::Side::INVALID;
+        Common::Price price_ = Common::Price_INVALID;
+        Common::Qty qty_ = Common::Qty_INVALID;        // order qty when sent, exec qty on fills
+        Common::Qty leaves_qty_ = Common::Qty_INVALID;
+        std::size_t seq_num_ = 0;                      // order gateway seq the request went out with, 0 for responses
+        // strategy that sent the request, responses do not know it, PositionKeeper::replay() attributes them by client order id
+        Common::StrategyId strategy_id_ = Common::StrategyId_INVALID;
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "OrderEvent ["
+               << "type:" << order_event_type_to_string(type_)
+               << " ticker:" << Common::ticker_id_to_string(ticker_id_)
+               << " coid:" << Common::order_id_to_string(client_order_id_)
+               << " moid:" << Common::order_id_to_string(market_order_id_)
+               << " side:" << Common::side_to_string(side_)
+               << " qty:" << Common::qty_to_string(qty_)
+               << " leaves_qty:" << Common::qty_to_string(leaves_qty_)
+               << " price:" << Common::price_to_string(price_)
+               << " seq:" << seq_num_
+               << " strategy:" << Common::strategy_id_to_string(strategy_id_)
+               << "]";
+            return ss.str();
+        }
+    };
+
+#pragma pack(pop)
+
+    inline auto order_event_from_response(const Exchange::MEClientResponse& response) noexcept {
+        OrderEventType type = OrderEventType::INVALID;
+        switch (response.type_) {
+            case Exchange::ClientResponseType::ACCEPTED:
+                type = OrderEventType::ACCEPTED;
+                break;
+            case Exchange::ClientResponseType::CANCELED:
+                type = OrderEventType::CANCELED;
+                break;
+            case Exchange::ClientResponseType::FILLED:
+                type = OrderEventType::FILLED;
+                break;
+            case Exchange::ClientResponseType::CANCEL_REJECTED:
+                type = OrderEventType::CANCEL_REJECTED;
+                break;
+            case Exchange::ClientResponseType::HEARTBEAT:
+            case Exchange::ClientResponseType::INVALID:
+                break;
+        }
+        return OrderEvent{type, response.ticker_id_, response.client_order_id_, response.market_order_id_, response.side_,
+                          response.price_, response.exec_qty_, response.leaves_qty_, 0};
+    }
+
+    // After a restart the same journal is replayed twice: OrderGateway::recover() rebuilds the session side (outgoing seq
+    // numbers, resend store), PositionKeeper::replay() the positions from the fills.
+    using OrderJournal = Common::Journal<OrderEvent>;
+}
@@ -0,0 +1,96 @@
+#include "position_keeper.h"
+
+#include <unordered_map>
+
+namespace Trading {
+
+    PositionKeeper::PositionKeeper(std::size_t num_instruments, std::size_t num_strategies)
+        : num_instruments_{num_instruments}, num_strategies_{num_strategies},
+          positions_(num_instruments * num_strategies), marks_(num_instruments, 0), strategy_totals_(num_strategies),
+          published_positions_(num_instruments * num_strategies), published_strategy_totals_(num_strategies) {
+        ASSERT(num_instruments && num_strategies, "PositionKeeper needs at least one instrument and one strategy.");
+    }
+
+    auto PositionKeeper::replay(const std::string& dir, const std::string& name) -> PositionReplayResult {
+        PositionReplayResult result;
+        std::unordered_map<Common::OrderId, Common::StrategyId> strategy_of;
+        result.journal_ = OrderJournal::replay(dir, name, [&](const OrderJournal::Record& record) {
+            const auto& event = record.event_;
+            if (event.type_ == OrderEventType::NEW_SENT) {
+                strategy_of[event.client_order_id_] = event.strategy_id_;
+                return;
+            }
+            if (event.type_ != OrderEventType::FILLED)
+                return;
+
+            const auto it = strategy_of.find(event.client_order_id_);
+            if (it == strategy_of.end()) {
+                ++result.unattributed_fills_;
+                return;
+            }
+            on_fill(it->second, event.ticker_id_, event.side_, event.price_, event.qty_);
+            ++result.fills_;
+        });
+        return result;
+    }
+
+    void PositionKeeper::on_bbo(Common::TickerId ticker_id, Common::Price bid_price, Common::Price ask_price) noexcept {
+        ASSERT(ticker_id < num_instruments_, "PositionKeeper BBO out of range ticker:" + Common::ticker_id_to_string(ticker_id));
+
+        const bool has_bid = bid_price != Common::Price_INVALID;
+        const bool has_ask = ask_price != Common::Price_INVALID;
+        const int64_t mark2 = has_bid && has_ask ? bid_price + ask_price : has_bid ? 2 * bid_price : has_ask ? 2 * ask_price : 0;
+
+        // an empty book keeps the last mark rather than dropping unrealized pnl to 0
+        if (!mark2 || mark2 == marks_[ticker_id])
+            return;
+        marks_[ticker_id] = mark2;
+
+        const auto first = ticker_id * num_strategies_;
+        lock_.write_begin();
+        for (std::size_t strategy_id = 0; strategy_id < num_strategies_; ++strategy_id) {
+            auto& info = positions_[first + strategy_id];
+            if (!info.position_)
+                continue; // flat, nothing to re-mark
+
+            const auto before = info;
+            mark(info, mark2);
+            apply_delta(strategy_totals_[strategy_id], before, info);
+            apply_delta(aggregate_totals_, before, info);
+
+            published_positions_[first + strategy_id].store(info);
+            published_strategy_totals_[strategy_id].store(strategy_totals_[strategy_id]);
+        }
+        published_aggregate_totals_.store(aggregate_totals_);
+        lock_.write_end();
+    }
+
+    void PositionKeeper::get_all_totals(PnlTotals* strategy_totals, PnlTotals& aggregate_totals) const noexcept {
+        while (true) {
+            const auto seq = lock_.read_begin();
+            for (std::size_t strategy_id = 0; strategy_id < num_strategies_; ++strategy_id)
+                strategy_totals[strategy_id] = published_strategy_totals_[strategy_id].load();
+            aggregate_totals = published_aggregate_totals_.load();
+            if (LIKELY(!lock_.read_retry(seq)))
+                return;
+        }
+    }
+
+    std::string PositionKeeper::to_string() const {
+        std::stringstream ss;
+        std::vector<PnlTotals> strategy_totals(num_strategies_);
+        PnlTotals aggregate_totals;
+        get_all_totals(strategy_totals.data(), aggregate_totals);
+
+        ss << "PositionKeeper aggregate " << aggregate_totals.to_string() << "\n";
+        for (std::size_t strategy_id = 0; strategy_id < num_strategies_; ++strategy_id) {
+            ss << " strategy:" << strategy_id << " " << strategy_totals[strategy_id].to_string() << "\n";
+            for (std::size_t ticker_id = 0; ticker_id < num_instruments_; ++ticker_id) {
+                const auto info = get_position(strategy_id, ticker_id);
+                if (info.position_ || info.volume_)
+                    ss << "  ticker:" << ticker_id << " " << info.to_string() << "\n";
+            }
+        }
+        return ss.str();
+    }
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <sstream>
+#include <vector>
+
+#include "common/macros.h"
+#include "common/types.h"
+#include "common/seqlock.h"
+
+#include "exchange/order_server/client_response.h"
+#include "trading/market_data/market_order_book.h"
+#include "trading/order_gw/order_journal.h"
+
+namespace Trading {
+
+    // All pnl and exposure values are fixed point in price ticks * qty, converting to currency needs the instrument's
+    // tick value and is left to whoever displays them.
+    struct PositionInfo {
+        int64_t position_ = 0;       // signed, long > 0
+        int64_t open_cost_ = 0;      // sum of price * signed qty of the open position, average price = open_cost_ / position_
+        int64_t realized_pnl_ = 0;
+        int64_t unrealized_pnl_ = 0; // against the mid of the last BBO, 0 until there is one
+        int64_t net_exposure_ = 0;   // position_ * mid
+        uint64_t volume_ = 0;        // qty traded
+
+        auto total_pnl() const noexcept { return realized_pnl_ + unrealized_pnl_; }
+        auto avg_open_price() const noexcept { return position_ ? static_cast<double>(open_cost_) / static_cast<double>(position_) : 0.0; }
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "Position{pos:" << position_ << " avg:" << avg_open_price() << " real:" << realized_pnl_
+               << " unreal:" << unrealized_pnl_ << " total:" << total_pnl() << " exposure:" << net_exposure_ << " vol:" << volume_ << "}";
+            return ss.str();
+        }
+    };
+
+    struct PnlTotals {
+        int64_t realized_pnl_ = 0;
+        int64_t unrealized_pnl_ = 0;
+        int64_t net_exposure_ = 0;
+        int64_t gross_exposure_ = 0; // sum of |net exposure| over positions, strategies are not netted against each other
+        uint64_t volume_ = 0;
+
+        auto total_pnl() const noexcept { return realized_pnl_ + unrealized_pnl_; }
+
+        auto to_string() const {
+            std::stringstream ss;
+            ss << "PnlTotals{real:" << realized_pnl_ << " unreal:" << unrealized_pnl_ << " total:" << total_pnl()
+               << " net:" << net_exposure_ << " gross:" << gross_exposure_ << " vol:" << volume_ << "}";
+            return ss.str();
+        }
+    };
+
+    struct PositionReplayResult {
+        std::size_t fills_ = 0;
+        std::size_t unattributed_fills_ = 0; // FILLED without the NEW_SENT naming its strategy, skipped
+        Common::JournalReplayResult journal_;
+    };
+
+    // Position, pnl and exposure per (strategy, instrument) with per strategy and aggregate totals, instruments are
+    // dense ticker ids in [0, num_instruments). Updated by one thread: on_fill() is O(1), on_bbo() is O(strategies)
+    // for that instrument, totals are maintained by applying each position's change to them, nothing is ever rescanned.
+    // Every update is published through a seqlock, any other thread can read a consistent position or set of totals
+    // without locks and without slowing the writer down. replay() rebuilds the positions from the OrderJournal after a
+    // restart.
+    class PositionKeeper final {
+    public:
+        PositionKeeper(std::size_t num_instruments = Common::ME_MAX_TICKERS, std::size_t num_strategies = 1);
+
+        PositionKeeper() = delete;
+        PositionKeeper(const PositionKeeper&) = delete;
+        PositionKeeper(const PositionKeeper&&) = delete;
+        PositionKeeper& operator=(const PositionKeeper&) = delete;
+        PositionKeeper& operator=(const PositionKeeper&&) = delete;
+
+        // writer thread only
+
+        auto on_fill(Common::StrategyId strategy_id, Common::TickerId ticker_id, Common::Side side, Common::Price price, Common::Qty qty) noexcept {
+            ASSERT(strategy_id < num_strategies_ && ticker_id < num_instruments_,
+                "PositionKeeper fill out of range strategy:" + Common::strategy_id_to_string(strategy_id) + " ticker:" + Common::ticker_id_to_string(ticker_id));
+
+            const auto index = ticker_id * num_strategies_ + strategy_id;
+            auto& info = positions_[index];
+            const auto before = info;
+
+            apply_fill(info, side_to_value(side) * static_cast<int64_t>(qty), price);
+            mark(info, marks_[ticker_id]);
+
+            auto& totals = strategy_totals_[strategy_id];
+            apply_delta(totals, before, info);
+            apply_delta(aggregate_totals_, before, info);
+
+            lock_.write_begin();
+            published_positions_[index].store(info);
+            published_strategy_totals_[strategy_id].store(totals);
+            published_aggregate_totals_.store(aggregate_totals_);
+            lock_.write_end();
+        }
+
+        auto on_fill(Common::StrategyId strategy_id, const Exchange::MEClientResponse& response) noexcept {
+            on_fill(strategy_id, response.ticker_id_, response.side_, response.price_, response.exec_qty_);
+        }
+
+        // applies every FILLED event in the OrderJournal dir/name through on_fill(), for the strategy whose NEW_SENT carried
+        // the same client order id (fills themselves do not know their strategy). Meant for a fresh keeper before the
+        // first live fill, unrealized pnl and exposure come back with the next BBO
+        auto replay(const std::string& dir, const std::string& name) -> PositionReplayResult;
+
+        // re-marks every strategy's position in ticker_id, a side that is missing from the book falls back to the other one
+        void on_bbo(Common::TickerId ticker_id, Common::Price bid_price, Common::Price ask_price) noexcept;
+
+        auto on_bbo(Common::TickerId ticker_id, const BBO* bbo) noexcept {
+            on_bbo(ticker_id, bbo->bid_price_, bbo->ask_price_);
+        }
+
+        // any thread, consistent snapshots
+
+        auto get_position(Common::StrategyId strategy_id, Common::TickerId ticker_id) const noexcept {
+            return read([&]() { return published_positions_[ticker_id * num_strategies_ + strategy_id].load(); });
+        }
+
+        auto get_strategy_totals(Common::StrategyId strategy_id) const noexcept {
+            return read([&]() { return published_strategy_totals_[strategy_id].load(); });
+        }
+
+        auto get_aggregate_totals() const noexcept {
+            return read([&]() { return published_aggregate_totals_.load(); });
+        }
+
+        // every strategy's totals plus the aggregate as of the same update, strategy_totals needs num_strategies() entries
+        void get_all_totals(PnlTotals* strategy_totals, PnlTotals& aggregate_totals) const noexcept;
+
+        // changes on every update, cheap way for a reader to tell whether anything moved since it last looked
+        auto sequence() const noexcept { return lock_.sequence(); }
+
+        auto num_instruments() const noexcept { return num_instruments_; }
+        auto num_strategies() const noexcept { return num_strategies_; }
+
+        std::string to_string() const;
+
+    private:
+        const std::size_t num_instruments_;
+        const std::size_t num_strategies_;
+
+        // writer side state, positions_ is [ticker][strategy] so on_bbo() walks one contiguous run
+        std::vector<PositionInfo> positions_;
+        std::vector<int64_t> marks_; // bid + ask, i.e. twice the mid so it stays an integer, 0 without a BBO
+        std::vector<PnlTotals> strategy_totals_;
+        PnlTotals aggregate_totals_;
+
+        // what readers see
+        Common::SeqLock lock_;
+        std::vector<Common::SeqLockSlot<PositionInfo>> published_positions_;
+        std::vector<Common::SeqLockSlot<PnlTotals>> published_strategy_totals_;
+        Common::SeqLockSlot<PnlTotals> published_aggregate_totals_;
+
+        template<typename F>
+        auto read(F&& f) const noexcept -> decltype(f()) {
+            while (true) {
+                const auto seq = lock_.read_begin();
+                const auto value = f();
+                if (LIKELY(!lock_.read_retry(seq)))
+                    return value;
+            }
+        }
+
+        static int64_t side_to_value(Common::Side side) noexcept { return static_cast<int64_t>(Common::side_to_value(side)); }
+
+        // signed_qty > 0 buys. A fill against the open position realizes pnl on the closed part against the average open
+        // price, the cost taken out is proportional so a fully closed position always ends up with open_cost_ == 0
+        static void apply_fill(PositionInfo& info, int64_t signed_qty, Common::Price price) noexcept {
+            info.volume_ += static_cast<uint64_t>(signed_qty < 0 ? -signed_qty : signed_qty);
+
+            if (info.position_ && (info.position_ > 0) != (signed_qty > 0)) {
+                const auto open_qty = info.position_ > 0 ? info.position_ : -info.position_;
+                const auto fill_qty = signed_qty > 0 ? signed_qty : -signed_qty;
+                const auto closed_qty = fill_qty < open_qty ? fill_qty : open_qty;
+
+                const auto closed_cost = static_cast<int64_t>(static_cast<__int128>(info.open_cost_) * closed_qty / open_qty);
+                const auto direction = info.position_ > 0 ? 1 : -1;
+                info.realized_pnl_ += direction * price * closed_qty - closed_cost;
+                info.open_cost_ -= closed_cost;
+                info.position_ -= direction * closed_qty;
+
+                signed_qty += direction * closed_qty; // whatever is left flips the position
+            }
+
+            info.position_ += signed_qty;
+            info.open_cost_ += price * signed_qty;
+        }
+
+        static void mark(PositionInfo& info, int64_t mark2) noexcept {
+            if (!mark2) {
+                info.unrealized_pnl_ = 0;
+                info.net_exposure_ = 0;
+                return;
+            }
+            info.net_exposure_ = info.position_ * mark2 / 2;
+            info.unrealized_pnl_ = (info.position_ * mark2 - 2 * info.open_cost_) / 2;
+        }
+
+        static void apply_delta(PnlTotals& totals, const PositionInfo& before, const PositionInfo& after) noexcept {
+            totals.realized_pnl_ += after.realized_pnl_ - before.realized_pnl_;
+            totals.unrealized_pnl_ += after.unrealized_pnl_ - before.unrealized_pnl_;
+            totals.net_exposure_ += after.net_exposure_ - before.net_exposure_;
+            totals.gross_exposure_ += (after.net_exposure_ < 0 ? -after.net_exposure_ : after.net_exposure_) -
+                                      (before.net_exposure_ < 0 ? -before.net_exposure_ : before.net_exposure_);
+            totals.volume_ += after.volume_ - before.volume_;
+        }
+    };
+}